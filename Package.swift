@@ -1,6 +1,12 @@
 // swift-tools-version:5.3
+import Foundation
 import PackageDescription
 
+var cSettings: [CSetting] = [.headerSearchPath("src")]
+if ProcessInfo.processInfo.environment["TSTLAPLUS_OPTIMIZED_PARSER"] != nil {
+    cSettings.append(.define("TSTLAPLUS_OPTIMIZED_PARSER"))
+}
+
 let package = Package(
     name: "TreeSitterTlaplus",
     platforms: [.macOS(.v10_13), .iOS(.v11)],
@@ -26,6 +32,7 @@ let package = Package(
                     "package-lock.json",
                     "pyproject.toml",
                     "setup.py",
+                    "script",
                     "test",
                     "examples",
                     ".editorconfig",
@@ -37,12 +44,13 @@ let package = Package(
                 sources: [
                     "src/parser.c",
                     "src/scanner.c",
+                    "src/outline.c",
                 ],
                 resources: [
                     .copy("queries")
                 ],
                 publicHeadersPath: "bindings/swift",
-                cSettings: [.headerSearchPath("src")])
+                cSettings: cSettings)
     ],
     cLanguageStandard: .c11
 )
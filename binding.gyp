@@ -1,4 +1,8 @@
 {
+  "variables": {
+    "tstlaplus_optimized_parser%": "<!(node -p \"process.env.TSTLAPLUS_OPTIMIZED_PARSER || ''\")",
+    "tree_sitter_lib_dir%": "<!(node bindings/node/runtime-dir.js)",
+  },
   "targets": [
     {
       "target_name": "tree_sitter_tlaplus_binding",
@@ -12,10 +16,45 @@
         "bindings/node/binding.cc",
         "src/parser.c",
         "src/scanner.c",
+        "src/outline.c",
       ],
       "cflags_c": [
         "-std=c11",
       ],
+      "conditions": [
+        ["tstlaplus_optimized_parser!=''", {
+          "defines": ["TSTLAPLUS_OPTIMIZED_PARSER"],
+        }],
+      ],
     }
-  ]
+  ],
+  "conditions": [
+    # parseAsync is an optional addon of its own, built only if a
+    # tree-sitter runtime is found, so the grammar addon needs none
+    ["tree_sitter_lib_dir!=''", {
+      "targets": [
+        {
+          "target_name": "tree_sitter_tlaplus_parse_async",
+          "dependencies": [
+            "<!(node -p \"require('node-addon-api').targets\"):node_addon_api_except",
+          ],
+          "include_dirs": [
+            "bindings/c",
+            "<(tree_sitter_lib_dir)/include",
+            "<(tree_sitter_lib_dir)/src",
+          ],
+          "sources": [
+            "bindings/node/parse_async.cc",
+            "bindings/c/tree-sitter-tlaplus-pool.c",
+            "<(tree_sitter_lib_dir)/src/lib.c",
+          ],
+          "cflags_c": [
+            "-std=c11",
+            "-D_POSIX_C_SOURCE=200112L",
+            "-D_DEFAULT_SOURCE",
+          ],
+        }
+      ],
+    }],
+  ],
 }
@@ -0,0 +1,978 @@
+// Definition & reference index; see tree-sitter-tlaplus.h. Built with the
+// tree-sitter runtime, as it walks trees through its API.
+//
+// Definitions and references are kept per unit, a child of a top-level
+// module, with byte offsets relative to the start of the unit. Units after
+// the last edit are placed by their distance back from the end of the
+// indexed text, so typing in one place shifts them all at once, and an
+// update only visits the children of the tree around the changed bytes.
+// Definitions scoped by the module itself are also listed in a table
+// sorted by name hash so references can find them in any unit.
+
+#define TREE_SITTER_TLAPLUS_INDEX
+#include "tree-sitter-tlaplus.h"
+#include "../../src/tree_sitter/array.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Node types the index distinguishes, mapped from the language's symbols.
+typedef enum {
+  Kind_NONE,
+
+  // Scopes, as captured by @local.scope
+  Kind_BOUNDED_QUANTIFICATION,
+  Kind_CHOOSE,
+  Kind_FUNCTION_DEFINITION,
+  Kind_FUNCTION_LITERAL,
+  Kind_LAMBDA,
+  Kind_LET_IN,
+  Kind_MODULE,
+  Kind_MODULE_DEFINITION,
+  Kind_OPERATOR_DEFINITION,
+  Kind_SET_FILTER,
+  Kind_SET_MAP,
+  Kind_UNBOUNDED_QUANTIFICATION,
+  Kind_NON_TERMINAL_PROOF,
+  Kind_SUFFICES_PROOF_STEP,
+  Kind_THEOREM,
+  Kind_PCAL_ALGORITHM,
+  Kind_PCAL_MACRO,
+  Kind_PCAL_PROCEDURE,
+  Kind_PCAL_WITH,
+  Kind_LAST_SCOPE = Kind_PCAL_WITH,
+
+  // Parents of definitions
+  Kind_ASSUME_PROVE,
+  Kind_ASSUMPTION,
+  Kind_CONSTANT_DECLARATION,
+  Kind_NEW,
+  Kind_OPERATOR_DECLARATION,
+  Kind_PCAL_MACRO_DECL,
+  Kind_PCAL_PROC_VAR_DECL,
+  Kind_PCAL_VAR_DECL,
+  Kind_PICK_PROOF_STEP,
+  Kind_PROOF_STEP,
+  Kind_QED_STEP,
+  Kind_QUANTIFIER_BOUND,
+  Kind_TAKE_PROOF_STEP,
+  Kind_TUPLE_OF_IDENTIFIERS,
+  Kind_VARIABLE_DECLARATION,
+
+  // Definitions & references
+  Kind_IDENTIFIER,
+  Kind_IDENTIFIER_REF,
+  Kind_PREFIX_OP_SYMBOL,
+  Kind_INFIX_OP_SYMBOL,
+  Kind_POSTFIX_OP_SYMBOL,
+  Kind_BOUND_PREFIX_OP,
+  Kind_BOUND_INFIX_OP,
+  Kind_BOUND_POSTFIX_OP,
+  Kind_BOUND_NONFIX_OP,
+  Kind_PROOF_STEP_ID,
+  Kind_PROOF_STEP_REF,
+  Kind_LEVEL,
+  Kind_NAME,
+
+  Kind_COUNT
+} Kind;
+
+// Names of the node types, indexed by kind.
+static const char *const kind_names[Kind_COUNT] = {
+  [Kind_NONE] = "",
+  [Kind_BOUNDED_QUANTIFICATION] = "bounded_quantification",
+  [Kind_CHOOSE] = "choose",
+  [Kind_FUNCTION_DEFINITION] = "function_definition",
+  [Kind_FUNCTION_LITERAL] = "function_literal",
+  [Kind_LAMBDA] = "lambda",
+  [Kind_LET_IN] = "let_in",
+  [Kind_MODULE] = "module",
+  [Kind_MODULE_DEFINITION] = "module_definition",
+  [Kind_OPERATOR_DEFINITION] = "operator_definition",
+  [Kind_SET_FILTER] = "set_filter",
+  [Kind_SET_MAP] = "set_map",
+  [Kind_UNBOUNDED_QUANTIFICATION] = "unbounded_quantification",
+  [Kind_NON_TERMINAL_PROOF] = "non_terminal_proof",
+  [Kind_SUFFICES_PROOF_STEP] = "suffices_proof_step",
+  [Kind_THEOREM] = "theorem",
+  [Kind_PCAL_ALGORITHM] = "pcal_algorithm",
+  [Kind_PCAL_MACRO] = "pcal_macro",
+  [Kind_PCAL_PROCEDURE] = "pcal_procedure",
+  [Kind_PCAL_WITH] = "pcal_with",
+  [Kind_ASSUME_PROVE] = "assume_prove",
+  [Kind_ASSUMPTION] = "assumption",
+  [Kind_CONSTANT_DECLARATION] = "constant_declaration",
+  [Kind_NEW] = "new",
+  [Kind_OPERATOR_DECLARATION] = "operator_declaration",
+  [Kind_PCAL_MACRO_DECL] = "pcal_macro_decl",
+  [Kind_PCAL_PROC_VAR_DECL] = "pcal_proc_var_decl",
+  [Kind_PCAL_VAR_DECL] = "pcal_var_decl",
+  [Kind_PICK_PROOF_STEP] = "pick_proof_step",
+  [Kind_PROOF_STEP] = "proof_step",
+  [Kind_QED_STEP] = "qed_step",
+  [Kind_QUANTIFIER_BOUND] = "quantifier_bound",
+  [Kind_TAKE_PROOF_STEP] = "take_proof_step",
+  [Kind_TUPLE_OF_IDENTIFIERS] = "tuple_of_identifiers",
+  [Kind_VARIABLE_DECLARATION] = "variable_declaration",
+  [Kind_IDENTIFIER] = "identifier",
+  [Kind_IDENTIFIER_REF] = "identifier_ref",
+  [Kind_PREFIX_OP_SYMBOL] = "prefix_op_symbol",
+  [Kind_INFIX_OP_SYMBOL] = "infix_op_symbol",
+  [Kind_POSTFIX_OP_SYMBOL] = "postfix_op_symbol",
+  [Kind_BOUND_PREFIX_OP] = "bound_prefix_op",
+  [Kind_BOUND_INFIX_OP] = "bound_infix_op",
+  [Kind_BOUND_POSTFIX_OP] = "bound_postfix_op",
+  [Kind_BOUND_NONFIX_OP] = "bound_nonfix_op",
+  [Kind_PROOF_STEP_ID] = "proof_step_id",
+  [Kind_PROOF_STEP_REF] = "proof_step_ref",
+  [Kind_LEVEL] = "level",
+  [Kind_NAME] = "name",
+};
+
+// Scope of a definition that is the enclosing top-level module.
+#define MODULE_SCOPE UINT32_MAX
+
+// A name defined in a unit; offsets are relative to the unit start.
+typedef struct {
+  uint32_t start_byte;
+  uint32_t end_byte;
+  uint32_t scope_start; // MODULE_SCOPE if scoped by the top-level module
+  uint32_t scope_end;
+  uint32_t hash;
+  uint32_t name_offset; // Into the unit's names
+  uint32_t name_length;
+} Definition;
+
+// A name referred to in a unit; offsets are relative to the unit start.
+typedef struct {
+  uint32_t start_byte;
+  uint32_t end_byte;
+  uint32_t hash;
+  uint32_t name_offset;
+  uint32_t name_length;
+} Reference;
+
+typedef struct {
+  uint32_t start_byte;
+  uint32_t end_byte;
+} Span;
+
+typedef struct {
+  uint32_t start_byte;      // Kept up to date by edits; see unit_start
+  uint32_t end_byte;
+  uint32_t container;       // Index of the enclosing top-level module
+  bool from_end;            // Placed back from the end of the text
+  bool changed;             // Overlapped by an edit since it was built
+  bool removed;             // Not in the tree of the current update
+  Array(Definition) definitions;        // Sorted by hash, then start
+  Array(Definition) module_definitions; // In source order
+  Array(Reference) references;          // Sorted by start
+  Array(char) names;
+} Unit;
+
+// A definition scoped by a top-level module.
+typedef struct {
+  uint32_t hash;
+  Unit *unit;
+  uint32_t definition; // Into the unit's module definitions
+} ModuleName;
+
+typedef Array(Unit *) UnitArray;
+typedef Array(ModuleName) ModuleNameArray;
+
+struct TSTlaplusIndex {
+  const TSLanguage *language;
+  Array(uint8_t) kinds; // Kind of each symbol of the language
+  TSFieldId name_field;
+  TSFieldId parameter_field;
+  TSFieldId symbol_field;
+  UnitArray units;              // Sorted by start
+  uint32_t gap;                 // Index of the first unit placed from the end
+  uint32_t end_byte;            // End of the text, kept up to date by edits
+  bool has_changes;             // Edited since the last update
+  Span changes;                 // Bytes edited, and the units they overlap
+  Array(Span) containers;       // Top-level modules, or the root of a snippet
+  ModuleNameArray module_names; // Sorted by hash
+  uint32_t rebuilt_units;
+};
+
+// A node being walked, and the field it is in.
+typedef struct {
+  Kind kind;
+  TSFieldId field;
+} Frame;
+
+// Walk state while building a unit.
+typedef struct {
+  const TSTlaplusIndex *index;
+  const char *source;
+  Unit *unit;
+  Array(Frame) frames;
+  Array(Span) scopes; // Relative to the unit start
+} Walk;
+
+// FNV-1a hash of a name.
+static uint32_t hash_name(const char *name, uint32_t length) {
+  uint32_t hash = 2166136261u;
+  for (uint32_t i = 0; i < length; i++) {
+    hash = (hash ^ (uint8_t)name[i]) * 16777619u;
+  }
+  return hash;
+}
+
+static void set_language(TSTlaplusIndex *index, const TSLanguage *language) {
+  index->language = language;
+  uint32_t const symbol_count = ts_language_symbol_count(language);
+  array_clear(&index->kinds);
+  array_grow_by(&index->kinds, symbol_count);
+  for (uint32_t symbol = 0; symbol < symbol_count; symbol++) {
+    if (TSSymbolTypeRegular != ts_language_symbol_type(language, (TSSymbol)symbol)) continue;
+    const char *name = ts_language_symbol_name(language, (TSSymbol)symbol);
+    for (int kind = Kind_NONE + 1; kind < Kind_COUNT; kind++) {
+      if (0 == strcmp(name, kind_names[kind])) {
+        index->kinds.contents[symbol] = (uint8_t)kind;
+        break;
+      }
+    }
+  }
+  index->name_field = ts_language_field_id_for_name(language, "name", 4);
+  index->parameter_field = ts_language_field_id_for_name(language, "parameter", 9);
+  index->symbol_field = ts_language_field_id_for_name(language, "symbol", 6);
+}
+
+static Kind kind_of(const TSTlaplusIndex *index, TSNode node) {
+  TSSymbol const symbol = ts_node_symbol(node);
+  return symbol < index->kinds.size ? (Kind)index->kinds.contents[symbol] : Kind_NONE;
+}
+
+static bool is_scope(Kind kind) {
+  return Kind_NONE < kind && kind <= Kind_LAST_SCOPE;
+}
+
+// Start of the unit in the text.
+static uint32_t unit_start(const TSTlaplusIndex *index, const Unit *unit) {
+  return unit->from_end ? index->end_byte - unit->start_byte : unit->start_byte;
+}
+
+// End of the unit in the text.
+static uint32_t unit_end(const TSTlaplusIndex *index, const Unit *unit) {
+  return unit->from_end ? index->end_byte - unit->end_byte : unit->end_byte;
+}
+
+// Places the unit back from the end of the text, or from its start.
+static void unit_place(TSTlaplusIndex *index, Unit *unit, bool from_end) {
+  if (unit->from_end == from_end) return;
+  uint32_t const start = index->end_byte - unit->start_byte;
+  uint32_t const end = index->end_byte - unit->end_byte;
+  unit->start_byte = start;
+  unit->end_byte = end;
+  unit->from_end = from_end;
+}
+
+// Moves the gap so the units from the given index on are placed from the
+// end of the text, and those before it from the start.
+static void move_gap(TSTlaplusIndex *index, uint32_t gap) {
+  for (; index->gap < gap; index->gap++) {
+    unit_place(index, index->units.contents[index->gap], false);
+  }
+  for (; index->gap > gap; index->gap--) {
+    unit_place(index, index->units.contents[index->gap - 1], true);
+  }
+}
+
+// Index of the first unit whose end is at least the byte.
+static uint32_t find_unit_ending(const TSTlaplusIndex *index, uint32_t byte) {
+  uint32_t low = 0, high = index->units.size;
+  while (low < high) {
+    uint32_t const middle = low + (high - low) / 2;
+    if (unit_end(index, index->units.contents[middle]) < byte) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+// Shifts a span by an edit the way units are: moved if it starts after
+// the edit, or else stretched over the bytes the edit inserted.
+static void edit_span(Span *span, const TSInputEdit *edit) {
+  if (span->end_byte < edit->start_byte) return;
+  if (span->start_byte >= edit->old_end_byte && span->start_byte > edit->start_byte) {
+    span->start_byte = span->start_byte - edit->old_end_byte + edit->new_end_byte;
+    span->end_byte = span->end_byte - edit->old_end_byte + edit->new_end_byte;
+  } else {
+    if (span->start_byte > edit->new_end_byte) span->start_byte = edit->new_end_byte;
+    span->end_byte = span->end_byte >= edit->old_end_byte
+      ? span->end_byte - edit->old_end_byte + edit->new_end_byte
+      : edit->new_end_byte;
+  }
+}
+
+static void unit_delete(Unit *unit) {
+  array_delete(&unit->definitions);
+  array_delete(&unit->module_definitions);
+  array_delete(&unit->references);
+  array_delete(&unit->names);
+  free(unit);
+}
+
+// Appends the name of the node to the unit's names; proof step IDs and
+// references are named <level>name so trailing dots are ignored.
+static void add_name(Walk *walk, TSNode node, Kind kind, uint32_t *offset, uint32_t *length) {
+  Unit *unit = walk->unit;
+  *offset = unit->names.size;
+  if (Kind_PROOF_STEP_ID == kind || Kind_PROOF_STEP_REF == kind) {
+    TSNode level = {0}, name = {0};
+    uint32_t const child_count = ts_node_named_child_count(node);
+    for (uint32_t i = 0; i < child_count; i++) {
+      TSNode const child = ts_node_named_child(node, i);
+      Kind const child_kind = kind_of(walk->index, child);
+      if (Kind_LEVEL == child_kind) level = child;
+      if (Kind_NAME == child_kind) name = child;
+    }
+    array_push(&unit->names, '<');
+    if (!ts_node_is_null(level)) {
+      uint32_t const start = ts_node_start_byte(level);
+      array_extend(&unit->names, ts_node_end_byte(level) - start, walk->source + start);
+    }
+    array_push(&unit->names, '>');
+    if (!ts_node_is_null(name)) {
+      uint32_t const start = ts_node_start_byte(name);
+      array_extend(&unit->names, ts_node_end_byte(name) - start, walk->source + start);
+    }
+  } else {
+    uint32_t const start = ts_node_start_byte(node);
+    array_extend(&unit->names, ts_node_end_byte(node) - start, walk->source + start);
+  }
+  *length = unit->names.size - *offset;
+}
+
+static void add_definition(Walk *walk, TSNode node, Kind kind, bool parent_scope) {
+  Unit *unit = walk->unit;
+  Definition definition;
+  definition.start_byte = ts_node_start_byte(node) - unit->start_byte;
+  definition.end_byte = ts_node_end_byte(node) - unit->start_byte;
+  add_name(walk, node, kind, &definition.name_offset, &definition.name_length);
+  definition.hash = hash_name(unit->names.contents + definition.name_offset, definition.name_length);
+
+  // Names of definitions that are scopes themselves belong to the scope
+  // around them, as with definition.*.scope "parent" in the nvim queries
+  uint32_t scope_count = walk->scopes.size;
+  if (parent_scope && scope_count > 0) scope_count--;
+  if (0 == scope_count) {
+    definition.scope_start = definition.scope_end = MODULE_SCOPE;
+    array_push(&unit->module_definitions, definition);
+  } else {
+    definition.scope_start = walk->scopes.contents[scope_count - 1].start_byte;
+    definition.scope_end = walk->scopes.contents[scope_count - 1].end_byte;
+    array_push(&unit->definitions, definition);
+  }
+}
+
+static void add_reference(Walk *walk, TSNode node, Kind kind) {
+  Unit *unit = walk->unit;
+  Reference reference;
+  reference.start_byte = ts_node_start_byte(node) - unit->start_byte;
+  reference.end_byte = ts_node_end_byte(node) - unit->start_byte;
+  add_name(walk, node, kind, &reference.name_offset, &reference.name_length);
+  reference.hash = hash_name(unit->names.contents + reference.name_offset, reference.name_length);
+  array_push(&unit->references, reference);
+}
+
+// Records the current node if it is a definition or reference, following
+// the captures of queries/locals.scm; returns whether it was recorded.
+static bool visit(Walk *walk, TSNode node) {
+  const TSTlaplusIndex *index = walk->index;
+  uint32_t const depth = walk->frames.size;
+  Frame const frame = walk->frames.contents[depth - 1];
+  Frame const parent = depth > 1 ? walk->frames.contents[depth - 2] : (Frame){Kind_NONE, 0};
+  Frame const grandparent = depth > 2 ? walk->frames.contents[depth - 3] : (Frame){Kind_NONE, 0};
+  bool const is_name = index->name_field == frame.field;
+  bool const is_parameter = index->parameter_field == frame.field;
+  if (!ts_node_is_named(node)) return false;
+
+  switch (frame.kind) {
+    case Kind_IDENTIFIER:
+      switch (parent.kind) {
+        case Kind_CHOOSE:
+        case Kind_CONSTANT_DECLARATION:
+        case Kind_LAMBDA:
+        case Kind_PCAL_PROC_VAR_DECL:
+        case Kind_PCAL_VAR_DECL:
+        case Kind_PCAL_WITH:
+        case Kind_PICK_PROOF_STEP:
+        case Kind_QUANTIFIER_BOUND:
+        case Kind_TAKE_PROOF_STEP:
+        case Kind_UNBOUNDED_QUANTIFICATION:
+        case Kind_VARIABLE_DECLARATION:
+          add_definition(walk, node, frame.kind, false);
+          return true;
+        case Kind_TUPLE_OF_IDENTIFIERS:
+          if (Kind_CHOOSE != grandparent.kind && Kind_QUANTIFIER_BOUND != grandparent.kind) break;
+          add_definition(walk, node, frame.kind, false);
+          return true;
+        case Kind_NEW:
+          if (Kind_ASSUME_PROVE != grandparent.kind) break;
+          add_definition(walk, node, frame.kind, false);
+          return true;
+        case Kind_MODULE_DEFINITION:
+        case Kind_OPERATOR_DEFINITION:
+        case Kind_PCAL_MACRO_DECL:
+          if (!is_parameter) break;
+          add_definition(walk, node, frame.kind, false);
+          return true;
+        case Kind_ASSUMPTION:
+          if (!is_name) break;
+          add_definition(walk, node, frame.kind, false);
+          return true;
+        case Kind_FUNCTION_DEFINITION:
+        case Kind_THEOREM:
+          if (!is_name) break;
+          add_definition(walk, node, frame.kind, true);
+          return true;
+        default:
+          break;
+      }
+      break;
+    case Kind_PROOF_STEP_ID:
+      if (Kind_PROOF_STEP != parent.kind && Kind_QED_STEP != parent.kind) break;
+      add_definition(walk, node, frame.kind, false);
+      return true;
+    case Kind_PROOF_STEP_REF:
+    case Kind_IDENTIFIER_REF:
+      add_reference(walk, node, frame.kind);
+      return true;
+    default:
+      break;
+  }
+
+  if (is_name && (Kind_MODULE_DEFINITION == parent.kind || Kind_OPERATOR_DEFINITION == parent.kind)) {
+    add_definition(walk, node, frame.kind, true);
+    return true;
+  }
+  if (is_name && Kind_OPERATOR_DECLARATION == parent.kind) {
+    // A declared operator is a definition as a constant, a NEW in an
+    // ASSUME/PROVE, or a parameter
+    bool const is_declared = Kind_CONSTANT_DECLARATION == grandparent.kind
+      || (Kind_NEW == grandparent.kind && depth > 3
+        && Kind_ASSUME_PROVE == walk->frames.contents[depth - 4].kind)
+      || ((Kind_OPERATOR_DEFINITION == grandparent.kind || Kind_MODULE_DEFINITION == grandparent.kind)
+        && index->parameter_field == parent.field);
+    if (is_declared) {
+      add_definition(walk, node, frame.kind, false);
+      return true;
+    }
+  }
+
+  bool const is_symbol_field = index->symbol_field == frame.field
+    && (Kind_BOUND_PREFIX_OP == parent.kind || Kind_BOUND_INFIX_OP == parent.kind
+      || Kind_BOUND_POSTFIX_OP == parent.kind || Kind_BOUND_NONFIX_OP == parent.kind);
+  if (is_symbol_field || Kind_PREFIX_OP_SYMBOL == frame.kind
+      || Kind_INFIX_OP_SYMBOL == frame.kind || Kind_POSTFIX_OP_SYMBOL == frame.kind) {
+    add_reference(walk, node, frame.kind);
+    return true;
+  }
+  return false;
+}
+
+static void enter(Walk *walk, TSTreeCursor *cursor) {
+  TSNode const node = ts_tree_cursor_current_node(cursor);
+  Frame frame;
+  frame.kind = kind_of(walk->index, node);
+  frame.field = ts_tree_cursor_current_field_id(cursor);
+  array_push(&walk->frames, frame);
+  if (is_scope(frame.kind)) {
+    Span scope;
+    scope.start_byte = ts_node_start_byte(node) - walk->unit->start_byte;
+    scope.end_byte = ts_node_end_byte(node) - walk->unit->start_byte;
+    array_push(&walk->scopes, scope);
+  }
+}
+
+static void leave(Walk *walk) {
+  Frame const frame = array_pop(&walk->frames);
+  if (is_scope(frame.kind)) walk->scopes.size--;
+}
+
+static int compare_definitions(const void *a, const void *b) {
+  const Definition *left = a, *right = b;
+  if (left->hash != right->hash) return left->hash < right->hash ? -1 : 1;
+  if (left->start_byte != right->start_byte) return left->start_byte < right->start_byte ? -1 : 1;
+  return 0;
+}
+
+// Indexes the subtree of the node as a new unit, or returns NULL if it
+// cannot be allocated.
+static Unit *build_unit(TSTlaplusIndex *index, TSNode node, const char *source, Walk *walk) {
+  Unit *unit = calloc(1, sizeof(Unit));
+  if (NULL == unit) return NULL;
+  unit->start_byte = ts_node_start_byte(node);
+  unit->end_byte = ts_node_end_byte(node);
+  walk->unit = unit;
+  walk->source = source;
+  array_clear(&walk->frames);
+  array_clear(&walk->scopes);
+
+  TSTreeCursor cursor = ts_tree_cursor_new(node);
+  enter(walk, &cursor);
+  for (;;) {
+    bool const recorded = visit(walk, ts_tree_cursor_current_node(&cursor));
+    if (!recorded && ts_tree_cursor_goto_first_child(&cursor)) {
+      enter(walk, &cursor);
+      continue;
+    }
+    for (;;) {
+      leave(walk);
+      if (ts_tree_cursor_goto_next_sibling(&cursor)) {
+        enter(walk, &cursor);
+        break;
+      }
+      if (!ts_tree_cursor_goto_parent(&cursor)) {
+        ts_tree_cursor_delete(&cursor);
+        if (unit->definitions.size > 1) {
+          qsort(unit->definitions.contents, unit->definitions.size, sizeof(Definition), compare_definitions);
+        }
+        index->rebuilt_units++;
+        return unit;
+      }
+    }
+  }
+}
+
+static int compare_module_names(const void *a, const void *b) {
+  const ModuleName *left = a, *right = b;
+  if (left->hash != right->hash) return left->hash < right->hash ? -1 : 1;
+  return 0;
+}
+
+// Appends the module names of the unit.
+static void push_module_names(ModuleNameArray *names, Unit *unit) {
+  for (uint32_t i = 0; i < unit->module_definitions.size; i++) {
+    ModuleName name = {unit->module_definitions.contents[i].hash, unit, i};
+    array_push(names, name);
+  }
+}
+
+// Finds the entry of the module name table for the name of the same unit
+// and definition, or returns NULL if there is none.
+static ModuleName *find_module_name(TSTlaplusIndex *index, ModuleName const *old_name) {
+  uint32_t low = 0, high = index->module_names.size;
+  while (low < high) {
+    uint32_t const middle = low + (high - low) / 2;
+    if (index->module_names.contents[middle].hash < old_name->hash) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  for (uint32_t i = low; i < index->module_names.size && index->module_names.contents[i].hash == old_name->hash; i++) {
+    ModuleName *name = &index->module_names.contents[i];
+    if (name->unit == old_name->unit && name->definition == old_name->definition) return name;
+  }
+  return NULL;
+}
+
+// Replaces the module names of removed units with those of new units. If
+// the new units define names of the same hashes, as when a unit is edited
+// without renaming what it defines, their entries are overwritten where
+// they are; otherwise the table is merged afresh.
+static void update_module_names(TSTlaplusIndex *index, ModuleNameArray *added, ModuleNameArray *removed) {
+  if (added->size > 1) {
+    qsort(added->contents, added->size, sizeof(ModuleName), compare_module_names);
+  }
+  if (removed->size > 1) {
+    qsort(removed->contents, removed->size, sizeof(ModuleName), compare_module_names);
+  }
+  bool same_hashes = added->size == removed->size;
+  for (uint32_t i = 0; same_hashes && i < added->size; i++) {
+    same_hashes = added->contents[i].hash == removed->contents[i].hash;
+  }
+
+  // Every removed name is looked up before any is overwritten, so that a
+  // name missing from the table falls back to the merge below
+  for (uint32_t i = 0; same_hashes && i < removed->size; i++) {
+    same_hashes = NULL != find_module_name(index, &removed->contents[i]);
+  }
+  if (same_hashes) {
+    for (uint32_t i = 0; i < removed->size; i++) {
+      *find_module_name(index, &removed->contents[i]) = added->contents[i];
+    }
+    return;
+  }
+
+  ModuleNameArray merged = array_new();
+  array_reserve(&merged, index->module_names.size + added->size);
+  uint32_t i = 0, j = 0;
+  while (i < index->module_names.size || j < added->size) {
+    ModuleName const *old_name = i < index->module_names.size ? &index->module_names.contents[i] : NULL;
+    if (NULL != old_name && old_name->unit->removed) {
+      i++;
+    } else if (NULL != old_name && (j == added->size || old_name->hash <= added->contents[j].hash)) {
+      array_push(&merged, *old_name);
+      i++;
+    } else {
+      array_push(&merged, added->contents[j]);
+      j++;
+    }
+  }
+  array_delete(&index->module_names);
+  index->module_names = merged;
+}
+
+TSTlaplusIndex *tree_sitter_tlaplus_index_new(void) {
+  return calloc(1, sizeof(TSTlaplusIndex));
+}
+
+void tree_sitter_tlaplus_index_delete(TSTlaplusIndex *index) {
+  for (uint32_t i = 0; i < index->units.size; i++) {
+    unit_delete(index->units.contents[i]);
+  }
+  array_delete(&index->units);
+  array_delete(&index->kinds);
+  array_delete(&index->containers);
+  array_delete(&index->module_names);
+  free(index);
+}
+
+void tree_sitter_tlaplus_index_edit(TSTlaplusIndex *index, const TSInputEdit *edit) {
+  // Units overlapping the edit, from first to shifted, are marked to be
+  // rebuilt; those after it only need the gap moved in front of them
+  uint32_t const first = find_unit_ending(index, edit->start_byte);
+  uint32_t const after = edit->old_end_byte > edit->start_byte ? edit->old_end_byte : edit->start_byte + 1;
+  uint32_t shifted = first;
+  while (shifted < index->units.size && unit_start(index, index->units.contents[shifted]) < after) {
+    shifted++;
+  }
+  move_gap(index, shifted);
+
+  // The next update visits the children around the edit and the units it
+  // overlapped
+  Span changes = {edit->start_byte, edit->new_end_byte};
+  if (index->has_changes) {
+    edit_span(&index->changes, edit);
+    if (index->changes.start_byte < changes.start_byte) changes.start_byte = index->changes.start_byte;
+    if (index->changes.end_byte > changes.end_byte) changes.end_byte = index->changes.end_byte;
+  }
+  for (uint32_t i = first; i < shifted; i++) {
+    // Overlapped units are rebuilt, so their range only has to stay
+    // ordered among the others
+    Unit *unit = index->units.contents[i];
+    Span span = {unit->start_byte, unit->end_byte};
+    edit_span(&span, edit);
+    unit->start_byte = span.start_byte;
+    unit->end_byte = span.end_byte;
+    unit->changed = true;
+    if (span.start_byte < changes.start_byte) changes.start_byte = span.start_byte;
+    if (span.end_byte > changes.end_byte) changes.end_byte = span.end_byte;
+  }
+  index->changes = changes;
+  index->has_changes = true;
+
+  Span end = {index->end_byte, index->end_byte};
+  edit_span(&end, edit);
+  index->end_byte = end.end_byte;
+}
+
+bool tree_sitter_tlaplus_index_update(
+  TSTlaplusIndex *index,
+  const TSTree *old_tree,
+  const TSTree *new_tree,
+  const char *source
+) {
+  const TSLanguage *language = ts_tree_language(new_tree);
+  if (language != index->language) {
+    set_language(index, language);
+    old_tree = NULL;
+  }
+  index->rebuilt_units = 0;
+
+  uint32_t range_count = 0;
+  TSRange *ranges = NULL != old_tree ? ts_tree_get_changed_ranges(old_tree, new_tree, &range_count) : NULL;
+  uint32_t next_range = 0;
+
+  // Containers are the top-level modules, or the root of a snippet
+  TSNode const root = ts_tree_root_node(new_tree);
+  uint32_t const old_container_count = index->containers.size;
+  array_clear(&index->containers);
+  TSTreeCursor cursor = ts_tree_cursor_new(root);
+  if (ts_tree_cursor_goto_first_child(&cursor)) {
+    do {
+      TSNode const child = ts_tree_cursor_current_node(&cursor);
+      if (Kind_MODULE == kind_of(index, child)) {
+        Span container = {ts_node_start_byte(child), ts_node_end_byte(child)};
+        array_push(&index->containers, container);
+      }
+    } while (ts_tree_cursor_goto_next_sibling(&cursor));
+  }
+  bool const is_snippet = 0 == index->containers.size;
+  if (is_snippet) {
+    Span container = {ts_node_start_byte(root), ts_node_end_byte(root)};
+    array_push(&index->containers, container);
+  }
+
+  // Only children around the bytes edited or changed since the last update
+  // are visited, unless modules came or went; touching counts as overlap
+  Span window = {0, UINT32_MAX};
+  if (NULL != old_tree && index->containers.size == old_container_count) {
+    if (index->has_changes) {
+      window = index->changes;
+    } else if (range_count > 0) {
+      window = (Span){ranges[0].start_byte, ranges[0].end_byte};
+    } else {
+      window = (Span){UINT32_MAX, 0};
+    }
+    for (uint32_t i = 0; i < range_count; i++) {
+      if (ranges[i].start_byte < window.start_byte) window.start_byte = ranges[i].start_byte;
+      if (ranges[i].end_byte > window.end_byte) window.end_byte = ranges[i].end_byte;
+    }
+  }
+  index->has_changes = false;
+
+  // Units are merged with the new children of the containers by position;
+  // a unit is kept if it was not edited, still spans exactly its node, and
+  // the node is outside all changed ranges. Past the window, the first
+  // child kept ends the walk, as the units after it are unchanged.
+  Walk walk = {.index = index};
+  UnitArray units = array_new();
+  ModuleNameArray added = array_new();
+  ModuleNameArray removed = array_new();
+  uint32_t first_unit = UINT32_MAX;
+  uint32_t next_unit = 0;
+  bool out_of_memory = false;
+  bool done = window.start_byte > window.end_byte;
+  ts_tree_cursor_reset(&cursor, root);
+  bool has_container = !done && (is_snippet || ts_tree_cursor_goto_first_child(&cursor));
+  for (uint32_t container = 0; has_container && container < index->containers.size; ) {
+    TSNode const container_node = ts_tree_cursor_current_node(&cursor);
+    if (!is_snippet && Kind_MODULE != kind_of(index, container_node)) {
+      has_container = ts_tree_cursor_goto_next_sibling(&cursor);
+      continue;
+    }
+
+    TSTreeCursor children = ts_tree_cursor_new(container_node);
+    bool has_child = index->containers.contents[container].end_byte < window.start_byte ? false
+      : window.start_byte > 0 ? ts_tree_cursor_goto_first_child_for_byte(&children, window.start_byte - 1) >= 0
+      : ts_tree_cursor_goto_first_child(&children);
+    for (; has_child; has_child = ts_tree_cursor_goto_next_sibling(&children)) {
+      TSNode const child = ts_tree_cursor_current_node(&children);
+      uint32_t const start = ts_node_start_byte(child);
+      uint32_t const end = ts_node_end_byte(child);
+      if (UINT32_MAX == first_unit) {
+        // Units ending before the window match the children before this
+        // one, so they stay as they are, placed from the start of the text
+        first_unit = find_unit_ending(index, window.start_byte);
+        if (index->gap < first_unit) move_gap(index, first_unit);
+        next_unit = first_unit;
+      }
+      while (next_unit < index->units.size && unit_start(index, index->units.contents[next_unit]) < start) {
+        Unit *unit = index->units.contents[next_unit++];
+        unit->removed = true;
+        push_module_names(&removed, unit);
+      }
+      while (next_range < range_count && ranges[next_range].end_byte < start) next_range++;
+      bool const is_changed = next_range < range_count && ranges[next_range].start_byte <= end;
+
+      Unit *unit = next_unit < index->units.size ? index->units.contents[next_unit] : NULL;
+      bool const is_kept = NULL != old_tree && NULL != unit && !unit->changed && !is_changed
+        && unit_start(index, unit) == start && unit_end(index, unit) == end;
+      if (is_kept) {
+        unit_place(index, unit, false);
+        next_unit++;
+      } else {
+        unit = build_unit(index, child, source, &walk);
+        if (NULL == unit) {
+          out_of_memory = true;
+          break;
+        }
+        push_module_names(&added, unit);
+      }
+      unit->container = container;
+      array_push(&units, unit);
+      if (is_kept && start > window.end_byte) {
+        done = true;
+        break;
+      }
+    }
+    ts_tree_cursor_delete(&children);
+    if (done || out_of_memory) break;
+
+    container++;
+    has_container = !is_snippet && ts_tree_cursor_goto_next_sibling(&cursor);
+  }
+  ts_tree_cursor_delete(&cursor);
+  free(ranges);
+  if (out_of_memory) {
+    // The units built so far are the ones not yet in the index; all are
+    // deleted, leaving the index empty
+    for (uint32_t i = 0; i < index->units.size; i++) index->units.contents[i]->removed = true;
+    for (uint32_t i = 0; i < units.size; i++) {
+      if (!units.contents[i]->removed) unit_delete(units.contents[i]);
+    }
+    for (uint32_t i = 0; i < index->units.size; i++) unit_delete(index->units.contents[i]);
+    array_clear(&index->units);
+    array_clear(&index->module_names);
+    index->gap = 0;
+    index->end_byte = 0;
+    index->language = NULL;
+    array_delete(&units);
+    array_delete(&added);
+    array_delete(&removed);
+    array_delete(&walk.frames);
+    array_delete(&walk.scopes);
+    return false;
+  }
+  if (UINT32_MAX == first_unit) {
+    // No child was visited: either nothing changed, or the units from the
+    // window on are gone
+    first_unit = done ? index->gap : find_unit_ending(index, window.start_byte);
+    if (index->gap < first_unit) move_gap(index, first_unit);
+    next_unit = first_unit;
+  }
+  if (!done) {
+    while (next_unit < index->units.size) {
+      Unit *unit = index->units.contents[next_unit++];
+      unit->removed = true;
+      push_module_names(&removed, unit);
+    }
+  }
+
+  // The units visited replace those they were merged with
+  update_module_names(index, &added, &removed);
+  for (uint32_t i = first_unit; i < next_unit; i++) {
+    if (index->units.contents[i]->removed) unit_delete(index->units.contents[i]);
+  }
+  uint32_t const gap = index->gap > next_unit ? index->gap - next_unit : 0;
+  array_splice(&index->units, first_unit, next_unit - first_unit, units.size, units.contents);
+  index->gap = first_unit + units.size + gap;
+  if (index->gap == index->units.size) {
+    index->end_byte = index->units.size > 0 ? unit_end(index, *array_back(&index->units)) : 0;
+  }
+  array_delete(&units);
+  array_delete(&added);
+  array_delete(&removed);
+  array_delete(&walk.frames);
+  array_delete(&walk.scopes);
+  return true;
+}
+
+static bool has_name(const Unit *unit, uint32_t offset, uint32_t length, const Unit *other_unit,
+                     uint32_t other_offset, uint32_t other_length) {
+  return length == other_length
+    && 0 == memcmp(unit->names.contents + offset, other_unit->names.contents + other_offset, length);
+}
+
+bool tree_sitter_tlaplus_index_find_definition(
+  const TSTlaplusIndex *index,
+  uint32_t byte,
+  TSTlaplusIndexRange *definition
+) {
+  // The unit, then the reference, at the byte
+  uint32_t low = 0, high = index->units.size;
+  while (low < high) {
+    uint32_t const middle = low + (high - low) / 2;
+    if (unit_start(index, index->units.contents[middle]) <= byte) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  if (0 == low || byte >= unit_end(index, index->units.contents[low - 1])) return false;
+  const Unit *unit = index->units.contents[low - 1];
+  uint32_t const unit_start_byte = unit_start(index, unit);
+  uint32_t const offset = byte - unit_start_byte;
+
+  low = 0;
+  high = unit->references.size;
+  while (low < high) {
+    uint32_t const middle = low + (high - low) / 2;
+    if (unit->references.contents[middle].start_byte <= offset) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  if (0 == low || offset >= unit->references.contents[low - 1].end_byte) return false;
+  const Reference *reference = &unit->references.contents[low - 1];
+
+  // Definitions in scopes of the unit: the innermost scope around the
+  // reference wins, then the closest definition before the reference
+  low = 0;
+  high = unit->definitions.size;
+  while (low < high) {
+    uint32_t const middle = low + (high - low) / 2;
+    if (unit->definitions.contents[middle].hash < reference->hash) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  const Definition *best = NULL;
+  for (uint32_t i = low; i < unit->definitions.size && unit->definitions.contents[i].hash == reference->hash; i++) {
+    const Definition *candidate = &unit->definitions.contents[i];
+    bool const is_visible = candidate->scope_start <= reference->start_byte
+      && reference->end_byte <= candidate->scope_end
+      && has_name(unit, candidate->name_offset, candidate->name_length,
+                  unit, reference->name_offset, reference->name_length);
+    if (!is_visible) continue;
+    bool const is_better = NULL == best
+      || candidate->scope_start > best->scope_start
+      || (candidate->scope_start == best->scope_start && candidate->scope_end < best->scope_end)
+      || (candidate->scope_start == best->scope_start && candidate->scope_end == best->scope_end
+        && candidate->start_byte <= reference->start_byte);
+    if (is_better) best = candidate;
+  }
+  if (NULL != best) {
+    definition->start_byte = unit_start_byte + best->start_byte;
+    definition->end_byte = unit_start_byte + best->end_byte;
+    return true;
+  }
+
+  // Definitions scoped by the same top-level module
+  low = 0;
+  high = index->module_names.size;
+  while (low < high) {
+    uint32_t const middle = low + (high - low) / 2;
+    if (index->module_names.contents[middle].hash < reference->hash) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  uint32_t const reference_start = unit_start_byte + reference->start_byte;
+  const Unit *best_unit = NULL;
+  uint32_t best_start = 0;
+  for (uint32_t i = low; i < index->module_names.size && index->module_names.contents[i].hash == reference->hash; i++) {
+    const ModuleName *name = &index->module_names.contents[i];
+    const Definition *candidate = &name->unit->module_definitions.contents[name->definition];
+    bool const is_visible = name->unit->container == unit->container
+      && has_name(name->unit, candidate->name_offset, candidate->name_length,
+                  unit, reference->name_offset, reference->name_length);
+    if (!is_visible) continue;
+    uint32_t const start = unit_start(index, name->unit) + candidate->start_byte;
+    bool const is_better = NULL == best_unit
+      || (start <= reference_start && (best_start > reference_start || start > best_start))
+      || (start > reference_start && best_start > reference_start && start < best_start);
+    if (is_better) {
+      best_unit = name->unit;
+      best_start = start;
+      best = candidate;
+    }
+  }
+  if (NULL == best) return false;
+  definition->start_byte = best_start;
+  definition->end_byte = unit_start(index, best_unit) + best->end_byte;
+  return true;
+}
+
+TSTlaplusIndexStats tree_sitter_tlaplus_index_stats(const TSTlaplusIndex *index) {
+  TSTlaplusIndexStats stats = {0};
+  stats.units = index->units.size;
+  stats.rebuilt_units = index->rebuilt_units;
+  for (uint32_t i = 0; i < index->units.size; i++) {
+    const Unit *unit = index->units.contents[i];
+    stats.definitions += unit->definitions.size + unit->module_definitions.size;
+    stats.references += unit->references.size;
+  }
+  return stats;
+}
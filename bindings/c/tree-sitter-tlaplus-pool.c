@@ -0,0 +1,144 @@
+// Parser pool; see tree-sitter-tlaplus.h. Built with the tree-sitter
+// runtime, as it creates and resets parsers through its API.
+//
+// Idle parsers are kept on a stack guarded by a lock, so the parser most
+// recently released, whose parse stack is still warm in the cache, is the
+// next handed out.
+
+#define TREE_SITTER_TLAPLUS_POOL
+#include "tree-sitter-tlaplus.h"
+#include "../../src/tree_sitter/array.h"
+
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+struct TSTlaplusParserPool {
+  Array(TSParser *) idle;
+  uint32_t max_idle;
+  uint32_t created;
+  uint32_t reused;
+  uint32_t in_use;
+#ifdef _WIN32
+  CRITICAL_SECTION lock;
+#else
+  pthread_mutex_t lock;
+#endif
+};
+
+static void pool_lock(TSTlaplusParserPool *pool) {
+#ifdef _WIN32
+  EnterCriticalSection(&pool->lock);
+#else
+  pthread_mutex_lock(&pool->lock);
+#endif
+}
+
+static void pool_unlock(TSTlaplusParserPool *pool) {
+#ifdef _WIN32
+  LeaveCriticalSection(&pool->lock);
+#else
+  pthread_mutex_unlock(&pool->lock);
+#endif
+}
+
+// Creates a parser with the language set, or NULL if it cannot be set.
+static TSParser *new_parser(void) {
+  TSParser *parser = ts_parser_new();
+  if (!ts_parser_set_language(parser, tree_sitter_tlaplus())) {
+    ts_parser_delete(parser);
+    return NULL;
+  }
+  return parser;
+}
+
+TSTlaplusParserPool *tree_sitter_tlaplus_parser_pool_new(uint32_t prewarm, uint32_t max_idle) {
+  TSTlaplusParserPool *pool = calloc(1, sizeof(TSTlaplusParserPool));
+  if (NULL == pool) return NULL;
+#ifdef _WIN32
+  InitializeCriticalSection(&pool->lock);
+#else
+  pthread_mutex_init(&pool->lock, NULL);
+#endif
+  pool->max_idle = max_idle;
+
+  if (prewarm > max_idle) prewarm = max_idle;
+  array_reserve(&pool->idle, prewarm);
+  for (uint32_t i = 0; i < prewarm; i++) {
+    TSParser *parser = new_parser();
+    if (NULL == parser) break;
+    array_push(&pool->idle, parser);
+    pool->created++;
+  }
+  return pool;
+}
+
+void tree_sitter_tlaplus_parser_pool_delete(TSTlaplusParserPool *pool) {
+  for (uint32_t i = 0; i < pool->idle.size; i++) {
+    ts_parser_delete(pool->idle.contents[i]);
+  }
+  array_delete(&pool->idle);
+#ifdef _WIN32
+  DeleteCriticalSection(&pool->lock);
+#else
+  pthread_mutex_destroy(&pool->lock);
+#endif
+  free(pool);
+}
+
+TSParser *tree_sitter_tlaplus_parser_pool_acquire(TSTlaplusParserPool *pool) {
+  TSParser *parser = NULL;
+  pool_lock(pool);
+  if (pool->idle.size > 0) {
+    parser = *array_back(&pool->idle);
+    pool->idle.size--;
+    pool->reused++;
+    pool->in_use++;
+  }
+  pool_unlock(pool);
+  if (NULL != parser) return parser;
+
+  // Created outside the lock, as setting the language copies and checks it
+  parser = new_parser();
+  if (NULL != parser) {
+    pool_lock(pool);
+    pool->created++;
+    pool->in_use++;
+    pool_unlock(pool);
+  }
+  return parser;
+}
+
+void tree_sitter_tlaplus_parser_pool_release(TSTlaplusParserPool *pool, TSParser *parser) {
+  // Resetting drops any unfinished parse along with its scanner, which the
+  // next parse creates afresh; the options a caller may have set are
+  // restored too
+  ts_parser_reset(parser);
+  ts_parser_set_included_ranges(parser, NULL, 0);
+  ts_parser_set_timeout_micros(parser, 0);
+  ts_parser_set_cancellation_flag(parser, NULL);
+  ts_parser_set_logger(parser, (TSLogger){NULL, NULL});
+
+  pool_lock(pool);
+  pool->in_use--;
+  bool keep = pool->idle.size < pool->max_idle;
+  if (keep) array_push(&pool->idle, parser);
+  pool_unlock(pool);
+  if (!keep) ts_parser_delete(parser);
+}
+
+TSTlaplusParserPoolStats tree_sitter_tlaplus_parser_pool_stats(TSTlaplusParserPool *pool) {
+  pool_lock(pool);
+  TSTlaplusParserPoolStats stats = {
+    .created = pool->created,
+    .reused = pool->reused,
+    .in_use = pool->in_use,
+    .idle = pool->idle.size,
+  };
+  pool_unlock(pool);
+  return stats;
+}
@@ -1,6 +1,10 @@
 #ifndef TREE_SITTER_TLAPLUS_H_
 #define TREE_SITTER_TLAPLUS_H_
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
 typedef struct TSLanguage TSLanguage;
 
 #ifdef __cplusplus
@@ -9,8 +13,310 @@ extern "C" {
 
 const TSLanguage *tree_sitter_tlaplus(void);
 
+// External scanner statistics, collected only if the scanner was built with
+// TLAPLUS_SCANNER_STATS defined. Counters are kept per thread and cover all
+// parsers used on the calling thread. Counter names are stable; the
+// max_*_depth counters hold maximums while all others hold running totals.
+
+// Number of counters; zero if statistics were not enabled at build time.
+size_t tree_sitter_tlaplus_scanner_stat_count(void);
+
+// Name of the counter at the given index, or NULL if out of range.
+const char *tree_sitter_tlaplus_scanner_stat_name(size_t index);
+
+// Value of the counter at the given index on the calling thread.
+uint64_t tree_sitter_tlaplus_scanner_stat_value(size_t index);
+
+// Resets all counters on the calling thread to zero.
+void tree_sitter_tlaplus_scanner_stats_reset(void);
+
+// Sets the allocator of external scanner memory: the scanner itself, and
+// an arena for its stacks once they outgrow the scanner, which is rewound
+// whenever the runtime restores scanner state and freed with the scanner.
+// The runtime creates a scanner as each fresh parse begins, on the thread
+// calling ts_parser_parse, and destroys it as the parser is reset, so
+// every parse allocates a new scanner and any arena blocks its stacks
+// need. Scanners created on the calling thread from now on allocate
+// through the given functions and keep them until destroyed, possibly on
+// another thread; a NULL allocate function restores ts_malloc and ts_free.
+// Giving each worker thread an allocator of its own keeps their scanners
+// from contending on a shared heap.
+void tree_sitter_tlaplus_scanner_set_allocator(
+  void *(*allocate)(void *payload, size_t size),
+  void (*deallocate)(void *payload, void *pointer),
+  void *payload
+);
+
+// Outline of a spec for symbol indexing, found without a full parse by a
+// single pass over the source. Entries name each module, the modules it
+// extends or instantiates, and the operators, named theorems, constants
+// and variables its units declare; definitions inside LET, proofs, and
+// function definitions are left out. Entries are reported in source
+// order, each module's own name first.
+
+// Kinds of outline entries.
+typedef enum {
+  TSTlaplusOutlineModule,   // Name of a module.
+  TSTlaplusOutlineExtends,  // Module named by EXTENDS.
+  TSTlaplusOutlineInstance, // Module named by INSTANCE, which may be
+                            // part of a module definition.
+  TSTlaplusOutlineOperator, // Name or symbol of an operator definition.
+  TSTlaplusOutlineTheorem,  // Name of a theorem or its synonyms.
+  TSTlaplusOutlineConstant, // Name or symbol of a declared constant.
+  TSTlaplusOutlineVariable  // Name of a declared variable.
+} TSTlaplusOutlineKind;
+
+// An outline entry; its name is the given byte range of the source.
+typedef struct {
+  TSTlaplusOutlineKind kind;
+  uint32_t module_depth; // Modules enclosing the entry's module.
+  bool local;            // Operator or instance declared LOCAL.
+  uint32_t start_byte;
+  uint32_t end_byte;
+} TSTlaplusOutlineEntry;
+
+// Called once for every entry of the outline.
+typedef void (*TSTlaplusOutlineCallback)(void *payload, const TSTlaplusOutlineEntry *entry);
+
+// Finds the outline of the UTF-8 source.
+void tree_sitter_tlaplus_outline(
+  const char *source,
+  uint32_t length,
+  TSTlaplusOutlineCallback callback,
+  void *payload
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+// Memory-mapped input, defined only if TREE_SITTER_TLAPLUS_MMAP_INPUT is
+// defined before including this header since it needs the tree-sitter API
+// header. Specs are parsed straight from the mapped file through a TSInput,
+// so they are never copied into memory as a whole; TSInput byte offsets
+// are 32 bits, so files of 4 GiB or more cannot be mapped.
+#ifdef TREE_SITTER_TLAPLUS_MMAP_INPUT
+
+#include <stdbool.h>
+#include <string.h>
+#include <tree_sitter/api.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Largest chunk of the mapped file handed to the parser per read.
+#ifndef TREE_SITTER_TLAPLUS_MMAP_CHUNK_SIZE
+#define TREE_SITTER_TLAPLUS_MMAP_CHUNK_SIZE (64 * 1024)
+#endif
+
+// A file mapped read-only into memory.
+typedef struct {
+  const char *data;
+  uint32_t length;
+} TSTlaplusMappedFile;
+
+// Maps the file at the given path; returns false if it cannot be mapped.
+static inline bool tree_sitter_tlaplus_mapped_file_open(TSTlaplusMappedFile *file, const char *path) {
+  file->data = "";
+  file->length = 0;
+#ifdef _WIN32
+  HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (INVALID_HANDLE_VALUE == handle) return false;
+  LARGE_INTEGER size;
+  bool ok = GetFileSizeEx(handle, &size) && size.QuadPart <= UINT32_MAX;
+  if (ok && size.QuadPart > 0) {
+    HANDLE mapping = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+    const void *data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (mapping) CloseHandle(mapping);
+    ok = NULL != data;
+    if (ok) {
+      file->data = (const char *)data;
+      file->length = (uint32_t)size.QuadPart;
+    }
+  }
+  CloseHandle(handle);
+  return ok;
+#else
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return false;
+  struct stat info;
+  bool ok = 0 == fstat(fd, &info) && (uint64_t)info.st_size <= UINT32_MAX;
+  if (ok && info.st_size > 0) {
+    void *data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ok = MAP_FAILED != data;
+    if (ok) {
+      file->data = (const char *)data;
+      file->length = (uint32_t)info.st_size;
+    }
+  }
+  close(fd);
+  return ok;
+#endif
+}
+
+// Unmaps the file; it must not be read by any parse afterward.
+static inline void tree_sitter_tlaplus_mapped_file_close(TSTlaplusMappedFile *file) {
+  if (file->length > 0) {
+#ifdef _WIN32
+    UnmapViewOfFile(file->data);
+#else
+    munmap((void *)file->data, file->length);
+#endif
+  }
+  file->data = "";
+  file->length = 0;
+}
+
+// TSInput read callback returning the mapped bytes at the offset.
+static inline const char *tree_sitter_tlaplus_mapped_file_read(
+  void *payload, uint32_t byte_index, TSPoint position, uint32_t *bytes_read
+) {
+  const TSTlaplusMappedFile *file = (const TSTlaplusMappedFile *)payload;
+  (void)position;
+  if (byte_index >= file->length) {
+    *bytes_read = 0;
+    return "";
+  }
+  uint32_t remaining = file->length - byte_index;
+  *bytes_read = remaining < TREE_SITTER_TLAPLUS_MMAP_CHUNK_SIZE ? remaining : TREE_SITTER_TLAPLUS_MMAP_CHUNK_SIZE;
+  return file->data + byte_index;
+}
+
+// UTF-8 input for ts_parser_parse reading the mapped file without copying.
+static inline TSInput tree_sitter_tlaplus_mapped_file_input(TSTlaplusMappedFile *file) {
+  // Zeroed in case the runtime's TSInput has fields added after these
+  TSInput input;
+  memset(&input, 0, sizeof(input));
+  input.payload = file;
+  input.read = tree_sitter_tlaplus_mapped_file_read;
+  input.encoding = TSInputEncodingUTF8;
+  return input;
+}
+
+#endif // TREE_SITTER_TLAPLUS_MMAP_INPUT
+
+// Definition & reference index, declared only if TREE_SITTER_TLAPLUS_INDEX
+// is defined before including this header since it needs the tree-sitter
+// API header; defined in tree-sitter-tlaplus-index.c, which is built along
+// with the tree-sitter runtime. The index follows queries/locals.scm: names
+// defined in each scope, and the references to them. It is kept up to date
+// with the tree, so an edit only reindexes the changed units of a module
+// without walking the others, and finding the definition of a reference
+// takes O(log n) time.
+#ifdef TREE_SITTER_TLAPLUS_INDEX
+
+#include <tree_sitter/api.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct TSTlaplusIndex TSTlaplusIndex;
+
+typedef struct {
+  uint32_t start_byte;
+  uint32_t end_byte;
+} TSTlaplusIndexRange;
+
+typedef struct {
+  uint32_t units;         // Units of the top-level modules, or the snippet.
+  uint32_t definitions;
+  uint32_t references;
+  uint32_t rebuilt_units; // Units reindexed by the last update.
+} TSTlaplusIndexStats;
+
+// Creates an empty index.
+TSTlaplusIndex *tree_sitter_tlaplus_index_new(void);
+
+// Deletes the index.
+void tree_sitter_tlaplus_index_delete(TSTlaplusIndex *index);
+
+// Applies an edit to the index, along with ts_tree_edit on the old tree.
+void tree_sitter_tlaplus_index_edit(TSTlaplusIndex *index, const TSInputEdit *edit);
+
+// Updates the index to the new tree and its UTF-8 source. The old tree is
+// the one the index was last updated to, with all edits since applied; if
+// it is NULL the whole tree is indexed. Returns false if memory ran out,
+// leaving the index empty so that the next update indexes the whole tree.
+bool tree_sitter_tlaplus_index_update(
+  TSTlaplusIndex *index,
+  const TSTree *old_tree,
+  const TSTree *new_tree,
+  const char *source
+);
+
+// Finds the definition of the reference at the byte offset, if any.
+bool tree_sitter_tlaplus_index_find_definition(
+  const TSTlaplusIndex *index,
+  uint32_t byte,
+  TSTlaplusIndexRange *definition
+);
+
+// Counts the contents of the index.
+TSTlaplusIndexStats tree_sitter_tlaplus_index_stats(const TSTlaplusIndex *index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TREE_SITTER_TLAPLUS_INDEX
+
+// Parser pool, declared only if TREE_SITTER_TLAPLUS_POOL is defined before
+// including this header since it needs the tree-sitter API header; defined
+// in tree-sitter-tlaplus-pool.c, which is built along with the tree-sitter
+// runtime. The pool hands out parsers with the language already set, so
+// services parsing many small specs skip creating a parser and setting its
+// language for each one; the external scanner is still created as each
+// parse begins and destroyed as the parser is reset, so it is not kept
+// between parses. Parsers are reset as they are released, and the pool may
+// be used from any number of threads at once.
+#ifdef TREE_SITTER_TLAPLUS_POOL
+
+#include <tree_sitter/api.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct TSTlaplusParserPool TSTlaplusParserPool;
+
+typedef struct {
+  uint32_t created; // Parsers created by the pool.
+  uint32_t reused;  // Parsers handed out again after being released.
+  uint32_t in_use;  // Parsers acquired and not yet released.
+  uint32_t idle;    // Parsers ready to hand out.
+} TSTlaplusParserPoolStats;
+
+// Creates a pool with the given number of parsers made ready up front,
+// keeping at most max_idle released parsers for reuse.
+TSTlaplusParserPool *tree_sitter_tlaplus_parser_pool_new(uint32_t prewarm, uint32_t max_idle);
+
+// Deletes the pool and its idle parsers; all parsers acquired from it must
+// have been released.
+void tree_sitter_tlaplus_parser_pool_delete(TSTlaplusParserPool *pool);
+
+// Hands out an idle parser, or a new one if none are idle; returns NULL
+// if the language is incompatible with the runtime.
+TSParser *tree_sitter_tlaplus_parser_pool_acquire(TSTlaplusParserPool *pool);
+
+// Returns the parser to the pool, resetting it along with its included
+// ranges, timeout, cancellation flag and logger; it is deleted instead if
+// max_idle parsers are already idle.
+void tree_sitter_tlaplus_parser_pool_release(TSTlaplusParserPool *pool, TSParser *parser);
+
+// Counts the parsers of the pool.
+TSTlaplusParserPoolStats tree_sitter_tlaplus_parser_pool_stats(TSTlaplusParserPool *pool);
+
 #ifdef __cplusplus
 }
 #endif
 
+#endif // TREE_SITTER_TLAPLUS_POOL
+
 #endif // TREE_SITTER_TLAPLUS_H_
@@ -0,0 +1,117 @@
+// Package batch parses many TLA+ specs in a single cgo call.
+//
+// It calls into the tree-sitter runtime, which it links in by importing
+// github.com/smacker/go-tree-sitter, so a program using this package gets
+// that binding's copy of the runtime; linking another copy of the runtime
+// as well, such as through another Go tree-sitter binding, fails with
+// duplicate symbols.
+package batch
+
+// #include "tree_sitter_api.h"
+//
+// typedef struct {
+//   const char *data;
+//   uint32_t length;
+// } TSTlaplusSource;
+//
+// typedef struct {
+//   bool has_error;
+//   uint32_t error_byte;
+// } TSTlaplusParseResult;
+//
+// // Start of the first error in the tree, found by descending into the
+// // first child containing an error until none of the children do.
+// static uint32_t first_error_byte(TSNode node) {
+//   for (;;) {
+//     uint32_t const count = ts_node_child_count(node);
+//     uint32_t i = 0;
+//     while (i < count && !ts_node_has_error(ts_node_child(node, i))) i++;
+//     if (i == count) return ts_node_start_byte(node);
+//     node = ts_node_child(node, i);
+//   }
+// }
+//
+// // Parses each source with one parser, writing whether it has errors and
+// // where the first one starts; false if the language could not be set.
+// static bool tree_sitter_tlaplus_parse_batch(
+//   const TSLanguage *language,
+//   const TSTlaplusSource *sources,
+//   uint32_t count,
+//   TSTlaplusParseResult *results
+// ) {
+//   TSParser *parser = ts_parser_new();
+//   if (!ts_parser_set_language(parser, language)) {
+//     ts_parser_delete(parser);
+//     return false;
+//   }
+//   for (uint32_t i = 0; i < count; i++) {
+//     TSTree *tree = ts_parser_parse_string(parser, NULL, sources[i].data, sources[i].length);
+//     TSNode root = ts_tree_root_node(tree);
+//     results[i].has_error = ts_node_has_error(root);
+//     results[i].error_byte = results[i].has_error ? first_error_byte(root) : 0;
+//     ts_tree_delete(tree);
+//   }
+//   ts_parser_delete(parser);
+//   return true;
+// }
+import "C"
+
+import (
+	"errors"
+	"reflect"
+	"runtime"
+	"unsafe"
+
+	// Links in the runtime called by the C code above
+	_ "github.com/smacker/go-tree-sitter"
+	"github.com/tree-sitter/tree-sitter-tlaplus"
+)
+
+// The TSNode of tree_sitter_api.h, which TestNodeLayout checks against the
+// one that go-tree-sitter declares for the runtime it links in; a node is
+// passed by value, so the two must agree field for field.
+func apiNodeType() reflect.Type {
+	return reflect.TypeOf(C.TSNode{})
+}
+
+// Result summarizes the parse of one source given to Parse.
+type Result struct {
+	// Whether the parse tree has errors or missing nodes.
+	HasError bool
+	// Byte offset of the first error or missing node; zero if there are none.
+	ErrorByte uint32
+}
+
+// Parse parses each source with a parser of this grammar, in a single
+// cgo call rather than several for each source, and returns whether each
+// parsed with errors. Trees are not kept, so this suits validating many
+// specs at once; parse with a tree-sitter binding to inspect trees. Calls
+// from separate goroutines each use a parser of their own.
+func Parse(sources [][]byte) ([]Result, error) {
+	if len(sources) == 0 {
+		return nil, nil
+	}
+
+	// Sources are pinned rather than copied to be read by C
+	var pinner runtime.Pinner
+	defer pinner.Unpin()
+	inputs := make([]C.TSTlaplusSource, len(sources))
+	for i, source := range sources {
+		if len(source) > 0 {
+			pinner.Pin(&source[0])
+			inputs[i].data = (*C.char)(unsafe.Pointer(&source[0]))
+			inputs[i].length = C.uint32_t(len(source))
+		}
+	}
+
+	outputs := make([]C.TSTlaplusParseResult, len(sources))
+	if !C.tree_sitter_tlaplus_parse_batch((*C.TSLanguage)(tree_sitter_tlaplus.Language()), &inputs[0], C.uint32_t(len(inputs)), &outputs[0]) {
+		return nil, errors.New("tree-sitter runtime is incompatible with the tlaplus grammar")
+	}
+
+	results := make([]Result, len(outputs))
+	for i, output := range outputs {
+		results[i] = Result{HasError: bool(output.has_error), ErrorByte: uint32(output.error_byte)}
+	}
+	return results, nil
+}
@@ -0,0 +1,104 @@
+package batch_test
+
+import (
+	"context"
+	"io/fs"
+	"os"
+	"path/filepath"
+	"strings"
+	"testing"
+
+	tree_sitter "github.com/smacker/go-tree-sitter"
+	"github.com/tree-sitter/tree-sitter-tlaplus"
+	"github.com/tree-sitter/tree-sitter-tlaplus/batch"
+)
+
+func TestParse(t *testing.T) {
+	sources := [][]byte{
+		[]byte("---- MODULE Test ----\nop == TRUE\n===="),
+		[]byte("---- MODULE Test ----\nop == (TRUE\n===="),
+		{},
+	}
+	results, err := batch.Parse(sources)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if len(results) != len(sources) {
+		t.Fatalf("Got %d results for %d sources", len(results), len(sources))
+	}
+	if results[0].HasError || results[0].ErrorByte != 0 {
+		t.Errorf("Valid spec parsed with error at byte %d", results[0].ErrorByte)
+	}
+	if !results[1].HasError || results[1].ErrorByte < uint32(strings.Index(string(sources[1]), "(")) {
+		t.Errorf("Unbalanced parenthesis gave %+v", results[1])
+	}
+
+	// Matches parsing one source at a time through the Go binding
+	parser := tree_sitter.NewParser()
+	parser.SetLanguage(tree_sitter.NewLanguage(tree_sitter_tlaplus.Language()))
+	for i, source := range sources {
+		tree, err := parser.ParseCtx(context.Background(), nil, source)
+		if err != nil {
+			t.Fatal(err)
+		}
+		if tree.RootNode().HasError() != results[i].HasError {
+			t.Errorf("Source %d parsed differently in a batch", i)
+		}
+	}
+}
+
+// Specs in test/examples, including the tlaplus/examples submodule if cloned
+func loadSpecs(b *testing.B) [][]byte {
+	var specs [][]byte
+	err := filepath.WalkDir("../../../test/examples", func(path string, entry fs.DirEntry, err error) error {
+		if err != nil || entry.IsDir() || !strings.HasSuffix(path, ".tla") {
+			return err
+		}
+		spec, err := os.ReadFile(path)
+		specs = append(specs, spec)
+		return err
+	})
+	if err != nil {
+		b.Fatal(err)
+	}
+	return specs
+}
+
+func reportBytes(b *testing.B, specs [][]byte) {
+	size := 0
+	for _, spec := range specs {
+		size += len(spec)
+	}
+	b.SetBytes(int64(size))
+	b.ReportMetric(float64(b.Elapsed().Nanoseconds())/float64(b.N*len(specs)), "ns/spec")
+}
+
+// Validates every spec through the Go binding, with cgo calls for each
+func BenchmarkValidatePerSpec(b *testing.B) {
+	specs := loadSpecs(b)
+	parser := tree_sitter.NewParser()
+	parser.SetLanguage(tree_sitter.NewLanguage(tree_sitter_tlaplus.Language()))
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		for _, spec := range specs {
+			tree, err := parser.ParseCtx(context.Background(), nil, spec)
+			if err != nil {
+				b.Fatal(err)
+			}
+			_ = tree.RootNode().HasError()
+		}
+	}
+	reportBytes(b, specs)
+}
+
+// Validates every spec in a single cgo call through Parse
+func BenchmarkValidateBatch(b *testing.B) {
+	specs := loadSpecs(b)
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		if _, err := batch.Parse(specs); err != nil {
+			b.Fatal(err)
+		}
+	}
+	reportBytes(b, specs)
+}
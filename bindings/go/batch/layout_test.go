@@ -0,0 +1,31 @@
+package batch
+
+import (
+	"reflect"
+	"testing"
+
+	tree_sitter "github.com/smacker/go-tree-sitter"
+)
+
+// TSNode is copied into tree_sitter_api.h rather than included from
+// go-tree-sitter, so it must keep the layout of the binding's declaration
+func TestNodeLayout(t *testing.T) {
+	field, ok := reflect.TypeOf(tree_sitter.Node{}).FieldByName("c")
+	if !ok {
+		t.Fatal("go-tree-sitter's Node no longer holds its TSNode in field c")
+	}
+	want, got := field.Type, apiNodeType()
+	if got.Size() != want.Size() || got.Align() != want.Align() || got.NumField() != want.NumField() {
+		t.Fatalf("TSNode is %d bytes in %d fields, but %d bytes in %d fields in go-tree-sitter",
+			got.Size(), got.NumField(), want.Size(), want.NumField())
+	}
+	for i := 0; i < want.NumField(); i++ {
+		wantField, gotField := want.Field(i), got.Field(i)
+		if gotField.Name != wantField.Name || gotField.Offset != wantField.Offset ||
+			gotField.Type.Size() != wantField.Type.Size() || gotField.Type.Kind() != wantField.Type.Kind() {
+			t.Errorf("TSNode field %d is %s %s at offset %d, but %s %s at offset %d in go-tree-sitter",
+				i, gotField.Name, gotField.Type.Kind(), gotField.Offset,
+				wantField.Name, wantField.Type.Kind(), wantField.Offset)
+		}
+	}
+}
@@ -2,7 +2,6 @@ package tree_sitter_tlaplus
 
 // #cgo CFLAGS: -std=c11 -fPIC
 // #include "../../src/parser.c"
-// // NOTE: if your language has an external scanner, add it here.
 import "C"
 
 import "unsafe"
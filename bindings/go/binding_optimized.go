@@ -0,0 +1,6 @@
+//go:build tstlaplus_optimized_parser
+
+package tree_sitter_tlaplus
+
+// #cgo CFLAGS: -DTSTLAPLUS_OPTIMIZED_PARSER
+import "C"
@@ -0,0 +1,9 @@
+package tree_sitter_tlaplus
+
+// The external scanner is compiled apart from parser.c, whose pragmas
+// disabling optimization (unless built with the tstlaplus_optimized_parser
+// tag) would otherwise apply to it too; cgo compiles it with CGO_CFLAGS,
+// -O2 by default.
+
+// #include "../../src/scanner.c"
+import "C"
@@ -18,10 +18,54 @@ type NodeInfo =
       children: ChildNode[];
     });
 
+type Point = {
+  row: number;
+  column: number;
+};
+
+type Edit = {
+  startIndex: number;
+  oldEndIndex: number;
+  newEndIndex: number;
+  startPosition: Point;
+  oldEndPosition: Point;
+  newEndPosition: Point;
+};
+
+declare class ParserPool {
+  constructor(size?: number);
+}
+
+declare class Tree {
+  private constructor();
+  edit(edit: Edit): Tree;
+}
+
+type Unit = {
+  type: string;
+  name: string | null;
+  startIndex: number;
+  endIndex: number;
+  startPosition: Point;
+};
+
+type ParseSummary = {
+  hasError: boolean;
+  units: Unit[];
+  tree: Tree;
+};
+
+type ParseOptions = {
+  pool?: ParserPool;
+  signal?: AbortSignal;
+};
+
 type Language = {
   name: string;
   language: unknown;
   nodeTypeInfo: NodeInfo[];
+  ParserPool: typeof ParserPool;
+  parseAsync(source: string | Buffer, oldTree?: Tree | null, options?: ParseOptions): Promise<ParseSummary>;
 };
 
 declare const language: Language;
@@ -1,7 +1,70 @@
-const root = require("path").join(__dirname, "..", "..");
+const path = require("path");
+const root = path.join(__dirname, "..", "..");
 
 module.exports = require("node-gyp-build")(root);
 
 try {
   module.exports.nodeTypeInfo = require("../../src/node-types.json");
 } catch (_) {}
+
+// The optional parseAsync addon, built only if a tree-sitter runtime was
+// found when installing; see bindings/node/runtime-dir.js
+let asyncBinding = null;
+for (const build of ["Release", "Debug"]) {
+  try {
+    asyncBinding = require(path.join(root, "build", build, "tree_sitter_tlaplus_parse_async.node"));
+    break;
+  } catch (_) {}
+}
+if (asyncBinding) {
+  asyncBinding.init(module.exports.language);
+}
+
+function missingAsyncBinding() {
+  return new Error(
+    "parseAsync was not built, as no tree-sitter runtime was found; install the tree-sitter " +
+    "package or set TREE_SITTER_LIB_DIR, then build this package from source with `node-gyp rebuild`");
+}
+
+module.exports.ParserPool = asyncBinding ? asyncBinding.ParserPool : class ParserPool {
+  constructor() {
+    throw missingAsyncBinding();
+  }
+};
+
+let defaultPool = null;
+
+/**
+ * Parses the source on the libuv thread pool, resolving to a summary of
+ * its units along with a tree which can be edited and passed back as the
+ * old tree of a later parse. Parsers are taken from options.pool, or a
+ * shared pool if none is given; aborting options.signal cancels the parse.
+ */
+function parseAsync(source, oldTree, options = {}) {
+  const { pool, signal } = options;
+  return new Promise((resolve, reject) => {
+    if (!asyncBinding) {
+      reject(missingAsyncBinding());
+      return;
+    }
+    if (signal?.aborted) {
+      reject(signal.reason);
+      return;
+    }
+    const onAbort = () => cancel();
+    const cancel = asyncBinding.startParse(
+      source, oldTree ?? null, pool ?? (defaultPool ??= new asyncBinding.ParserPool()), (error, result) => {
+        signal?.removeEventListener("abort", onAbort);
+        if (signal?.aborted) {
+          reject(signal.reason);
+        } else if (error) {
+          reject(error);
+        } else {
+          resolve(result);
+        }
+      });
+    signal?.addEventListener("abort", onAbort, { once: true });
+  });
+}
+
+module.exports.parseAsync = parseAsync;
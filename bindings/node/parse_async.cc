@@ -0,0 +1,401 @@
+#include <napi.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#define TREE_SITTER_TLAPLUS_POOL
+#include "tree-sitter-tlaplus.h"
+
+// The parseAsync addon, built apart from the grammar addon so that only
+// this one needs the tree-sitter runtime. The grammar is not linked in:
+// init() is given the language exported by the grammar addon, whose
+// parse tables and external scanner are reached through it.
+
+// "tree-sitter", "language" hashed with BLAKE2
+const napi_type_tag LANGUAGE_TYPE_TAG = {
+  0x8AF2E5212AD58ABF, 0xD5006CAD83ABBA16
+};
+
+// The runtime polls the cancellation flag as a plain size_t
+static_assert(sizeof(std::atomic<size_t>) == sizeof(size_t), "atomic size_t must be lock-free");
+
+struct AddonData {
+    const TSLanguage *language = nullptr;
+    Napi::FunctionReference parser_pool_constructor;
+    Napi::FunctionReference tree_constructor;
+};
+
+// The language given to init(), shared by every instance of the addon as
+// they all load the same grammar addon
+static std::atomic<const TSLanguage *> addon_language{nullptr};
+
+// Gives the parser pool the language given to init()
+extern "C" const TSLanguage *tree_sitter_tlaplus(void) {
+    return addon_language.load();
+}
+
+// The number of libuv threads, which bounds how many parsers of a pool
+// are in use at once
+static uint32_t ThreadPoolSize() {
+    const char *size = std::getenv("UV_THREADPOOL_SIZE");
+    long threads = size != nullptr ? std::strtol(size, nullptr, 10) : 0;
+    return threads > 0 ? static_cast<uint32_t>(std::min(threads, 1024L)) : 4;
+}
+
+/**
+ * Parsers which have already had the language set, shared between parse
+ * workers; a TSTlaplusParserPool from bindings/c. Parsers are created on
+ * demand when none are idle, so the number in use is bounded by the size
+ * of the libuv thread pool, and no more than that many are kept idle
+ * unless more were made ready up front.
+ */
+class ParserPool : public Napi::ObjectWrap<ParserPool> {
+  public:
+    static Napi::Function Init(Napi::Env env) {
+        return DefineClass(env, "ParserPool", {});
+    }
+
+    ParserPool(const Napi::CallbackInfo &info) : Napi::ObjectWrap<ParserPool>(info) {
+        uint32_t size = 0;
+        if (info.Length() > 0 && !info[0].IsUndefined()) {
+            if (!info[0].IsNumber()) {
+                throw Napi::TypeError::New(info.Env(), "Pool size must be a number");
+            }
+            size = info[0].As<Napi::Number>().Uint32Value();
+        }
+        if (info.Env().GetInstanceData<AddonData>()->language == nullptr) {
+            throw Napi::Error::New(info.Env(), "The language has not been given to init()");
+        }
+        pool = tree_sitter_tlaplus_parser_pool_new(size, std::max(size, ThreadPoolSize()));
+        if (pool == nullptr) {
+            throw Napi::Error::New(info.Env(), "Could not allocate the parser pool");
+        }
+    }
+
+    ~ParserPool() {
+        if (pool != nullptr) {
+            tree_sitter_tlaplus_parser_pool_delete(pool);
+        }
+    }
+
+    // Returns a parser with the language set, or nullptr if it could not be
+    // set
+    TSParser *Acquire() {
+        return tree_sitter_tlaplus_parser_pool_acquire(pool);
+    }
+
+    // Resets the parser, along with its cancellation flag, and keeps it for
+    // reuse unless enough parsers are already idle
+    void Release(TSParser *parser) {
+        tree_sitter_tlaplus_parser_pool_release(pool, parser);
+    }
+
+  private:
+    TSTlaplusParserPool *pool = nullptr;
+};
+
+/**
+ * A tree returned by parseAsync, which can be edited and passed back as
+ * the old tree of a later parse. Offsets are in the units of the source
+ * it was parsed from: UTF-16 code units for strings, bytes for buffers.
+ */
+class Tree : public Napi::ObjectWrap<Tree> {
+  public:
+    static Napi::Function Init(Napi::Env env) {
+        return DefineClass(env, "Tree", {InstanceMethod("edit", &Tree::Edit)});
+    }
+
+    Tree(const Napi::CallbackInfo &info) : Napi::ObjectWrap<Tree>(info) {
+        if (info.Length() < 2 || !info[0].IsExternal()) {
+            throw Napi::TypeError::New(info.Env(), "Trees are only created by parseAsync");
+        }
+        tree = info[0].As<Napi::External<TSTree>>().Data();
+        unit_size = info[1].As<Napi::Number>().Uint32Value();
+    }
+
+    ~Tree() {
+        ts_tree_delete(tree);
+    }
+
+    // Copies the tree for use on another thread
+    TSTree *Copy() const {
+        return ts_tree_copy(tree);
+    }
+
+    uint32_t UnitSize() const {
+        return unit_size;
+    }
+
+  private:
+    static uint32_t GetNumber(Napi::Object edit, const char *key) {
+        Napi::Value value = edit.Get(key);
+        if (!value.IsNumber()) {
+            throw Napi::TypeError::New(edit.Env(), std::string("Edit is missing ") + key);
+        }
+        return value.As<Napi::Number>().Uint32Value();
+    }
+
+    uint32_t GetOffset(Napi::Object edit, const char *key) {
+        return GetNumber(edit, key) * unit_size;
+    }
+
+    TSPoint GetPoint(Napi::Object edit, const char *key) {
+        Napi::Value value = edit.Get(key);
+        if (!value.IsObject()) {
+            throw Napi::TypeError::New(edit.Env(), std::string("Edit is missing ") + key);
+        }
+        Napi::Object point = value.As<Napi::Object>();
+        return {GetNumber(point, "row"), GetOffset(point, "column")};
+    }
+
+    Napi::Value Edit(const Napi::CallbackInfo &info) {
+        if (info.Length() < 1 || !info[0].IsObject()) {
+            throw Napi::TypeError::New(info.Env(), "Edit must be an object");
+        }
+        Napi::Object edit = info[0].As<Napi::Object>();
+        TSInputEdit input = {
+            GetOffset(edit, "startIndex"),
+            GetOffset(edit, "oldEndIndex"),
+            GetOffset(edit, "newEndIndex"),
+            GetPoint(edit, "startPosition"),
+            GetPoint(edit, "oldEndPosition"),
+            GetPoint(edit, "newEndPosition"),
+        };
+        ts_tree_edit(tree, &input);
+        return info.This();
+    }
+
+    TSTree *tree;
+    uint32_t unit_size;
+};
+
+// A unit directly inside a top-level module, or inside a snippet
+struct Unit {
+    const char *type;
+    uint32_t name_start;
+    uint32_t name_end;
+    bool has_name;
+    uint32_t start_byte;
+    uint32_t end_byte;
+    TSPoint start_point;
+};
+
+static bool IsType(TSNode node, const char *type) {
+    return std::strcmp(ts_node_type(node), type) == 0;
+}
+
+// Records the named children of the node which are units, skipping the
+// module name, its delimiting lines, and comments
+static void AddUnits(std::vector<Unit> &units, TSNode node) {
+    TSNode node_name = ts_node_child_by_field_name(node, "name", 4);
+    uint32_t child_count = ts_node_named_child_count(node);
+    for (uint32_t i = 0; i < child_count; i++) {
+        TSNode child = ts_node_named_child(node, i);
+        if (ts_node_is_extra(child) || ts_node_eq(child, node_name) || IsType(child, "header_line") ||
+            IsType(child, "double_line") || IsType(child, "single_line")) {
+            continue;
+        }
+
+        // LOCAL definitions are named by the definition they wrap
+        TSNode name = ts_node_child_by_field_name(child, "name", 4);
+        if (ts_node_is_null(name) && IsType(child, "local_definition") && ts_node_named_child_count(child) > 0) {
+            name = ts_node_child_by_field_name(ts_node_named_child(child, 0), "name", 4);
+        }
+        bool has_name = !ts_node_is_null(name);
+        units.push_back({
+            ts_node_type(child),
+            has_name ? ts_node_start_byte(name) : 0,
+            has_name ? ts_node_end_byte(name) : 0,
+            has_name,
+            ts_node_start_byte(child),
+            ts_node_end_byte(child),
+            ts_node_start_point(child),
+        });
+    }
+}
+
+/**
+ * Parses one source on the libuv thread pool and summarizes its units
+ * there, so the event loop only builds the result objects.
+ */
+class ParseWorker : public Napi::AsyncWorker {
+  public:
+    ParseWorker(
+        Napi::Function callback,
+        Napi::Value source,
+        Napi::Value old_tree,
+        Napi::Object pool,
+        std::shared_ptr<std::atomic<size_t>> cancellation_flag
+    ) : Napi::AsyncWorker(callback, "tree-sitter-tlaplus:parse"),
+        pool(Napi::ObjectWrap<ParserPool>::Unwrap(pool)),
+        pool_reference(Napi::Persistent(pool)),
+        cancellation_flag(cancellation_flag) {
+        if (source.IsString()) {
+            utf16_source = source.As<Napi::String>().Utf16Value();
+            unit_size = 2;
+        } else {
+            Napi::Buffer<char> buffer = source.As<Napi::Buffer<char>>();
+            utf8_source.assign(buffer.Data(), buffer.Length());
+            unit_size = 1;
+        }
+        if (old_tree.IsObject()) {
+            this->old_tree = Napi::ObjectWrap<Tree>::Unwrap(old_tree.As<Napi::Object>())->Copy();
+        }
+    }
+
+    ~ParseWorker() {
+        ts_tree_delete(old_tree);
+        ts_tree_delete(tree);
+    }
+
+    void Execute() override {
+        TSParser *parser = pool->Acquire();
+        if (parser == nullptr) {
+            SetError("The language is incompatible with this tree-sitter runtime");
+            return;
+        }
+        ts_parser_set_cancellation_flag(parser, reinterpret_cast<const size_t *>(cancellation_flag.get()));
+        if (unit_size == 2) {
+            tree = ts_parser_parse_string_encoding(
+                parser, old_tree, reinterpret_cast<const char *>(utf16_source.data()),
+                utf16_source.size() * 2, TSInputEncodingUTF16);
+        } else {
+            tree = ts_parser_parse_string(parser, old_tree, utf8_source.data(), utf8_source.size());
+        }
+        // Releasing resets the parser, so a cancelled one does not resume
+        // the cancelled parse
+        pool->Release(parser);
+        if (tree == nullptr) {
+            SetError("The parse was cancelled");
+            return;
+        }
+
+        TSNode root = ts_tree_root_node(tree);
+        has_error = ts_node_has_error(root);
+        bool has_module = false;
+        uint32_t child_count = ts_node_named_child_count(root);
+        for (uint32_t i = 0; i < child_count; i++) {
+            TSNode child = ts_node_named_child(root, i);
+            if (IsType(child, "module")) {
+                has_module = true;
+                AddUnits(units, child);
+            }
+        }
+        if (!has_module) {
+            AddUnits(units, root);
+        }
+    }
+
+    void OnOK() override {
+        Napi::Env env = Env();
+        Napi::Array unit_array = Napi::Array::New(env, units.size());
+        for (size_t i = 0; i < units.size(); i++) {
+            const Unit &unit = units[i];
+            Napi::Object item = Napi::Object::New(env);
+            item["type"] = Napi::String::New(env, unit.type);
+            item["name"] = unit.has_name ? Text(unit.name_start, unit.name_end) : env.Null();
+            item["startIndex"] = Napi::Number::New(env, unit.start_byte / unit_size);
+            item["endIndex"] = Napi::Number::New(env, unit.end_byte / unit_size);
+            Napi::Object position = Napi::Object::New(env);
+            position["row"] = Napi::Number::New(env, unit.start_point.row);
+            position["column"] = Napi::Number::New(env, unit.start_point.column / unit_size);
+            item["startPosition"] = position;
+            unit_array[static_cast<uint32_t>(i)] = item;
+        }
+
+        Napi::Object result = Napi::Object::New(env);
+        result["hasError"] = Napi::Boolean::New(env, has_error);
+        result["units"] = unit_array;
+        result["tree"] = env.GetInstanceData<AddonData>()->tree_constructor.New({
+            Napi::External<TSTree>::New(env, tree),
+            Napi::Number::New(env, unit_size),
+        });
+        tree = nullptr;
+        Callback().Call({env.Null(), result});
+    }
+
+  private:
+    Napi::Value Text(uint32_t start_byte, uint32_t end_byte) {
+        if (unit_size == 2) {
+            return Napi::String::New(Env(), utf16_source.data() + start_byte / 2, (end_byte - start_byte) / 2);
+        }
+        return Napi::String::New(Env(), utf8_source.data() + start_byte, end_byte - start_byte);
+    }
+
+    ParserPool *pool;
+    Napi::ObjectReference pool_reference;
+    std::shared_ptr<std::atomic<size_t>> cancellation_flag;
+    std::u16string utf16_source;
+    std::string utf8_source;
+    uint32_t unit_size;
+    TSTree *old_tree = nullptr;
+    TSTree *tree = nullptr;
+    bool has_error = false;
+    std::vector<Unit> units;
+};
+
+// startParse(source, oldTree, pool, callback) queues a parse and returns
+// a function which cancels it
+static Napi::Value StartParse(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 4 || !(info[0].IsString() || info[0].IsBuffer())) {
+        throw Napi::TypeError::New(env, "Source must be a string or a Buffer");
+    }
+    if (!info[1].IsNull() && !info[1].IsUndefined()) {
+        if (!info[1].IsObject() || !info[1].As<Napi::Object>().InstanceOf(
+                env.GetInstanceData<AddonData>()->tree_constructor.Value())) {
+            throw Napi::TypeError::New(env, "Old tree must be a tree returned by parseAsync");
+        }
+        uint32_t unit_size = info[0].IsString() ? 2 : 1;
+        if (Napi::ObjectWrap<Tree>::Unwrap(info[1].As<Napi::Object>())->UnitSize() != unit_size) {
+            throw Napi::TypeError::New(env, "Old tree was parsed from a source of a different encoding");
+        }
+    }
+    if (!info[2].IsObject() || !info[3].IsFunction() || !info[2].As<Napi::Object>().InstanceOf(
+            env.GetInstanceData<AddonData>()->parser_pool_constructor.Value())) {
+        throw Napi::TypeError::New(env, "Expected a parser pool and a callback");
+    }
+
+    auto cancellation_flag = std::make_shared<std::atomic<size_t>>(0);
+    ParseWorker *worker = new ParseWorker(
+        info[3].As<Napi::Function>(), info[0], info[1], info[2].As<Napi::Object>(), cancellation_flag);
+    worker->Queue();
+    return Napi::Function::New(env, [cancellation_flag](const Napi::CallbackInfo &info) {
+        cancellation_flag->store(1);
+        return info.Env().Undefined();
+    }, "cancel");
+}
+
+// init(language) takes the language exported by the grammar addon
+static Napi::Value InitLanguage(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsExternal() ||
+            !info[0].As<Napi::External<TSLanguage>>().CheckTypeTag(&LANGUAGE_TYPE_TAG)) {
+        throw Napi::TypeError::New(env, "Expected the language of the grammar addon");
+    }
+    const TSLanguage *language = info[0].As<Napi::External<TSLanguage>>().Data();
+    if (ts_language_version(language) < TREE_SITTER_MIN_COMPATIBLE_LANGUAGE_VERSION ||
+            ts_language_version(language) > TREE_SITTER_LANGUAGE_VERSION) {
+        throw Napi::Error::New(env, "The language is incompatible with this tree-sitter runtime");
+    }
+    env.GetInstanceData<AddonData>()->language = language;
+    addon_language.store(language);
+    return env.Undefined();
+}
+
+Napi::Object Init(Napi::Env env, Napi::Object exports) {
+    AddonData *data = new AddonData();
+    data->parser_pool_constructor = Napi::Persistent(ParserPool::Init(env));
+    data->tree_constructor = Napi::Persistent(Tree::Init(env));
+    env.SetInstanceData(data);
+    exports["init"] = Napi::Function::New(env, InitLanguage, "init");
+    exports["ParserPool"] = data->parser_pool_constructor.Value();
+    exports["startParse"] = Napi::Function::New(env, StartParse, "startParse");
+    return exports;
+}
+
+NODE_API_MODULE(tree_sitter_tlaplus_parse_async, Init)
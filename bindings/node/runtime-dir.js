@@ -0,0 +1,21 @@
+// Prints the lib directory of the tree-sitter runtime to build the
+// parseAsync addon against, or nothing if none is found, in which case
+// only the grammar addon is built. Looks in TREE_SITTER_LIB_DIR, then in
+// the sources vendored by the tree-sitter package, then in the
+// test/dependencies/tree-sitter submodule.
+
+const fs = require("fs");
+const path = require("path");
+
+const candidates = [];
+if (process.env.TREE_SITTER_LIB_DIR) {
+  candidates.push(process.env.TREE_SITTER_LIB_DIR);
+}
+try {
+  const treeSitter = path.dirname(require.resolve("tree-sitter/package.json"));
+  candidates.push(path.join(treeSitter, "vendor", "tree-sitter", "lib"));
+} catch (_) {}
+candidates.push(path.join(__dirname, "..", "..", "test", "dependencies", "tree-sitter", "lib"));
+
+const found = candidates.find((dir) => fs.existsSync(path.join(dir, "src", "lib.c")));
+process.stdout.write(found ? path.resolve(found) : "");
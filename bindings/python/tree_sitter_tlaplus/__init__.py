@@ -2,4 +2,19 @@
 
 from ._binding import language
 
-__all__ = ["language"]
+try:
+    from ._parse_many import parse_many, parser_pool_stats
+except ImportError as error:
+    # Built only where a tree-sitter runtime was found; see setup.py
+    _parse_many_error = error
+
+    def parse_many(sources, threads=0):
+        raise ImportError(
+            "parse_many was not built, as no tree-sitter runtime was found; set "
+            "TREE_SITTER_LIB_DIR to the lib directory of a tree-sitter checkout and reinstall"
+        ) from _parse_many_error
+
+    def parser_pool_stats():
+        return parse_many(())
+
+__all__ = ["language", "parse_many", "parser_pool_stats"]
@@ -1 +1,20 @@
+from os import PathLike
+from typing import Iterable, List, Optional, Tuple, TypedDict, Union
+
+Unit = Tuple[str, Optional[str], int, int, Tuple[int, int]]
+
+class PoolStats(TypedDict):
+    created: int
+    reused: int
+    in_use: int
+    idle: int
+
+class Summary(TypedDict):
+    has_error: bool
+    units: List[Unit]
+
 def language() -> int: ...
+def parse_many(
+    sources: Iterable[Union[bytes, str, PathLike]], threads: int = 0
+) -> List[Summary]: ...
+def parser_pool_stats() -> PoolStats: ...
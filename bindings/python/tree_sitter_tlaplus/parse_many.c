@@ -0,0 +1,437 @@
+#include <Python.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TREE_SITTER_TLAPLUS_MMAP_INPUT
+#define TREE_SITTER_TLAPLUS_POOL
+#include "tree-sitter-tlaplus.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+// parse_many, an optional extension of its own as it compiles in the
+// tree-sitter runtime; built only if a runtime is found, leaving the
+// language-only _binding extension to work without one. The grammar is
+// not compiled in again: the language is taken from _binding on import.
+static const TSLanguage *language;
+
+// Gives the parser pool the language taken from _binding
+const TSLanguage *tree_sitter_tlaplus(void) {
+    return language;
+}
+
+// Parsers shared by all calls, so workers of later calls skip creating a
+// parser and setting its language; created along with the module
+static TSTlaplusParserPool *parser_pool;
+
+// A unit directly inside a top-level module, or inside a snippet
+typedef struct {
+    const char *type; // Owned by the language
+    char *name;
+    uint32_t name_length;
+    uint32_t start_byte;
+    uint32_t end_byte;
+    TSPoint start_point;
+} Unit;
+
+// One source to parse, given either as a path or as the source bytes
+typedef struct {
+    const char *path;
+    const char *source;
+    uint32_t length;
+    int error_number; // Nonzero if the path could not be read
+    bool out_of_memory; // Set if a parser or the summary could not be allocated
+    bool has_error;
+    Unit *units;
+    uint32_t unit_count;
+} Job;
+
+// Jobs are handed out in order to whichever worker asks next
+typedef struct {
+    Job *jobs;
+    size_t job_count;
+    size_t next_job;
+#ifdef _WIN32
+    CRITICAL_SECTION lock;
+#else
+    pthread_mutex_t lock;
+#endif
+} Pool;
+
+static Job *pool_next_job(Pool *pool) {
+    Job *job = NULL;
+#ifdef _WIN32
+    EnterCriticalSection(&pool->lock);
+#else
+    pthread_mutex_lock(&pool->lock);
+#endif
+    if (pool->next_job < pool->job_count) {
+        job = &pool->jobs[pool->next_job++];
+    }
+#ifdef _WIN32
+    LeaveCriticalSection(&pool->lock);
+#else
+    pthread_mutex_unlock(&pool->lock);
+#endif
+    return job;
+}
+
+static bool is_type(TSNode node, const char *type) {
+    return strcmp(ts_node_type(node), type) == 0;
+}
+
+// Records the named children of the node which are units, skipping the
+// module name, its delimiting lines, and comments
+static void add_units(Job *job, TSNode node, const char *text) {
+    TSNode node_name = ts_node_child_by_field_name(node, "name", 4);
+    uint32_t child_count = ts_node_named_child_count(node);
+    if (child_count == 0) {
+        return;
+    }
+    Unit *units = realloc(job->units, (job->unit_count + child_count) * sizeof(Unit));
+    if (units == NULL) {
+        job->out_of_memory = true;
+        return;
+    }
+    job->units = units;
+
+    for (uint32_t i = 0; i < child_count; i++) {
+        TSNode child = ts_node_named_child(node, i);
+        if (ts_node_is_extra(child) || ts_node_eq(child, node_name) || is_type(child, "header_line") ||
+            is_type(child, "double_line") || is_type(child, "single_line")) {
+            continue;
+        }
+
+        // LOCAL definitions are named by the definition they wrap
+        TSNode name = ts_node_child_by_field_name(child, "name", 4);
+        if (ts_node_is_null(name) && is_type(child, "local_definition") && ts_node_named_child_count(child) > 0) {
+            name = ts_node_child_by_field_name(ts_node_named_child(child, 0), "name", 4);
+        }
+
+        Unit *unit = &job->units[job->unit_count++];
+        unit->type = ts_node_type(child);
+        unit->name = NULL;
+        unit->name_length = 0;
+        unit->start_byte = ts_node_start_byte(child);
+        unit->end_byte = ts_node_end_byte(child);
+        unit->start_point = ts_node_start_point(child);
+        if (!ts_node_is_null(name)) {
+            uint32_t length = ts_node_end_byte(name) - ts_node_start_byte(name);
+            unit->name = malloc(length);
+            if (unit->name == NULL) {
+                job->out_of_memory = true;
+                return;
+            }
+            memcpy(unit->name, text + ts_node_start_byte(name), length);
+            unit->name_length = length;
+        }
+    }
+}
+
+static void summarize(Job *job, TSTree *tree, const char *text) {
+    TSNode root = ts_tree_root_node(tree);
+    job->has_error = ts_node_has_error(root);
+    bool has_module = false;
+    uint32_t child_count = ts_node_named_child_count(root);
+    for (uint32_t i = 0; i < child_count; i++) {
+        TSNode child = ts_node_named_child(root, i);
+        if (is_type(child, "module")) {
+            has_module = true;
+            add_units(job, child, text);
+        }
+    }
+    if (!has_module) {
+        add_units(job, root, text);
+    }
+}
+
+static void parse_job(TSParser *parser, Job *job) {
+    TSTree *tree;
+    if (job->path != NULL) {
+        TSTlaplusMappedFile file;
+        errno = 0;
+        if (!tree_sitter_tlaplus_mapped_file_open(&file, job->path)) {
+            job->error_number = errno != 0 ? errno : EIO;
+            return;
+        }
+        tree = ts_parser_parse(parser, NULL, tree_sitter_tlaplus_mapped_file_input(&file));
+        if (tree != NULL) {
+            summarize(job, tree, file.data);
+        }
+        tree_sitter_tlaplus_mapped_file_close(&file);
+    } else {
+        tree = ts_parser_parse_string(parser, NULL, job->source, job->length);
+        if (tree != NULL) {
+            summarize(job, tree, job->source);
+        }
+    }
+    if (tree == NULL) {
+        job->out_of_memory = true;
+        return;
+    }
+    ts_tree_delete(tree);
+}
+
+#ifdef _WIN32
+static DWORD WINAPI parse_worker(LPVOID payload) {
+#else
+static void *parse_worker(void *payload) {
+#endif
+    Pool *pool = payload;
+    // A worker without a parser leaves its share to the others; jobs that
+    // no worker took are marked failed once all have finished
+    TSParser *parser = tree_sitter_tlaplus_parser_pool_acquire(parser_pool);
+    if (parser == NULL) {
+        return 0;
+    }
+    for (Job *job = pool_next_job(pool); job != NULL; job = pool_next_job(pool)) {
+        parse_job(parser, job);
+    }
+    tree_sitter_tlaplus_parser_pool_release(parser_pool, parser);
+    return 0;
+}
+
+// Parses all jobs on the given number of threads, the calling one included
+static void pool_run(Pool *pool, size_t thread_count) {
+#ifdef _WIN32
+    InitializeCriticalSection(&pool->lock);
+    HANDLE *threads = calloc(thread_count, sizeof(HANDLE));
+#else
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_t *threads = calloc(thread_count, sizeof(pthread_t));
+#endif
+    // If threads cannot be started the remaining workers do all the jobs
+    size_t started = 0;
+    while (threads != NULL && started + 1 < thread_count) {
+#ifdef _WIN32
+        threads[started] = CreateThread(NULL, 0, parse_worker, pool, 0, NULL);
+        if (threads[started] == NULL) break;
+#else
+        if (pthread_create(&threads[started], NULL, parse_worker, pool) != 0) break;
+#endif
+        started++;
+    }
+
+    parse_worker(pool);
+    for (size_t i = 0; i < started; i++) {
+#ifdef _WIN32
+        WaitForSingleObject(threads[i], INFINITE);
+        CloseHandle(threads[i]);
+#else
+        pthread_join(threads[i], NULL);
+#endif
+    }
+    free(threads);
+#ifdef _WIN32
+    DeleteCriticalSection(&pool->lock);
+#else
+    pthread_mutex_destroy(&pool->lock);
+#endif
+}
+
+static size_t processor_count(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (size_t)count : 1;
+#endif
+}
+
+// Converts the job's summary to a dict of its error flag and units
+static PyObject *job_summary(const Job *job) {
+    PyObject *units = PyList_New(job->unit_count);
+    if (units == NULL) {
+        return NULL;
+    }
+    for (uint32_t i = 0; i < job->unit_count; i++) {
+        const Unit *unit = &job->units[i];
+        PyObject *item = Py_BuildValue(
+            "(sz#II(II))", unit->type, unit->name, (Py_ssize_t)unit->name_length,
+            unit->start_byte, unit->end_byte, unit->start_point.row, unit->start_point.column);
+        if (item == NULL) {
+            Py_DECREF(units);
+            return NULL;
+        }
+        PyList_SetItem(units, i, item);
+    }
+    return Py_BuildValue("{s:O,s:N}", "has_error", job->has_error ? Py_True : Py_False, "units", units);
+}
+
+static void free_jobs(Job *jobs, size_t job_count) {
+    for (size_t i = 0; i < job_count; i++) {
+        for (uint32_t j = 0; j < jobs[i].unit_count; j++) {
+            free(jobs[i].units[j].name);
+        }
+        free(jobs[i].units);
+    }
+    free(jobs);
+}
+
+static PyObject* _parse_many_parse_many(PyObject *self, PyObject *args, PyObject *kwargs) {
+    static char *keywords[] = {"sources", "threads", NULL};
+    PyObject *sources;
+    Py_ssize_t threads = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|n", keywords, &sources, &threads)) {
+        return NULL;
+    }
+    if (threads < 0) {
+        PyErr_SetString(PyExc_ValueError, "threads must not be negative");
+        return NULL;
+    }
+
+    // Holds the sources, and encoded paths, alive while the GIL is released
+    PyObject *items = PySequence_List(sources);
+    if (items == NULL) {
+        return NULL;
+    }
+    Py_ssize_t job_count = PyList_Size(items);
+    Job *jobs = calloc(job_count > 0 ? job_count : 1, sizeof(Job));
+    if (jobs == NULL) {
+        Py_DECREF(items);
+        return PyErr_NoMemory();
+    }
+
+    for (Py_ssize_t i = 0; i < job_count; i++) {
+        PyObject *item = PyList_GetItem(items, i);
+        PyObject *source = NULL;
+        if (PyBytes_Check(item)) {
+            Py_INCREF(item);
+            source = item;
+        } else {
+            PyObject *path = PyOS_FSPath(item);
+            if (path != NULL && PyUnicode_Check(path)) {
+                source = PyUnicode_EncodeFSDefault(path);
+                Py_DECREF(path);
+            } else {
+                source = path;
+            }
+        }
+
+        char *data;
+        Py_ssize_t length;
+        if (source == NULL || PyBytes_AsStringAndSize(source, &data, &length) < 0) {
+            Py_XDECREF(source);
+            free_jobs(jobs, job_count);
+            Py_DECREF(items);
+            return NULL;
+        }
+        if (length > UINT32_MAX) {
+            Py_DECREF(source);
+            free_jobs(jobs, job_count);
+            Py_DECREF(items);
+            PyErr_SetString(PyExc_ValueError, "sources must be smaller than 4 GiB");
+            return NULL;
+        }
+
+        if (PyBytes_Check(item)) {
+            jobs[i].source = data;
+            jobs[i].length = (uint32_t)length;
+        } else {
+            jobs[i].path = data;
+        }
+        PyList_SetItem(items, i, source);
+    }
+
+    size_t thread_count = threads > 0 ? (size_t)threads : processor_count();
+    Pool pool = {.jobs = jobs, .job_count = job_count, .next_job = 0};
+    Py_BEGIN_ALLOW_THREADS
+    pool_run(&pool, thread_count < (size_t)job_count ? thread_count : (size_t)job_count);
+    Py_END_ALLOW_THREADS
+    for (size_t i = pool.next_job; i < (size_t)job_count; i++) {
+        jobs[i].out_of_memory = true;
+    }
+
+    PyObject *results = PyList_New(job_count);
+    for (Py_ssize_t i = 0; results != NULL && i < job_count; i++) {
+        PyObject *summary = NULL;
+        if (jobs[i].error_number != 0) {
+            errno = jobs[i].error_number;
+            PyErr_SetFromErrnoWithFilename(PyExc_OSError, jobs[i].path);
+        } else if (jobs[i].out_of_memory) {
+            PyErr_NoMemory();
+        } else {
+            summary = job_summary(&jobs[i]);
+        }
+        if (summary == NULL) {
+            Py_CLEAR(results);
+        } else {
+            PyList_SetItem(results, i, summary);
+        }
+    }
+
+    free_jobs(jobs, job_count);
+    Py_DECREF(items);
+    return results;
+}
+
+static PyObject* _parse_many_parser_pool_stats(PyObject *self, PyObject *args) {
+    TSTlaplusParserPoolStats stats = tree_sitter_tlaplus_parser_pool_stats(parser_pool);
+    return Py_BuildValue(
+        "{s:I,s:I,s:I,s:I}", "created", stats.created, "reused", stats.reused,
+        "in_use", stats.in_use, "idle", stats.idle);
+}
+
+static PyMethodDef methods[] = {
+    {"parse_many", (PyCFunction)(void (*)(void))_parse_many_parse_many, METH_VARARGS | METH_KEYWORDS,
+     "Parse many sources in parallel with the GIL released, returning a summary of each."},
+    {"parser_pool_stats", _parse_many_parser_pool_stats, METH_NOARGS,
+     "Count the parsers kept for reuse by parse_many."},
+    {NULL, NULL, 0, NULL}
+};
+
+static struct PyModuleDef module = {
+    .m_base = PyModuleDef_HEAD_INIT,
+    .m_name = "_parse_many",
+    .m_doc = NULL,
+    .m_size = -1,
+    .m_methods = methods
+};
+
+// Reads the language pointer from _binding.language()
+static bool load_language(void) {
+    PyObject *binding = PyImport_ImportModule("tree_sitter_tlaplus._binding");
+    if (binding == NULL) {
+        return false;
+    }
+    PyObject *pointer = PyObject_CallMethod(binding, "language", NULL);
+    Py_DECREF(binding);
+    if (pointer == NULL) {
+        return false;
+    }
+    language = PyLong_AsVoidPtr(pointer);
+    Py_DECREF(pointer);
+    if (language == NULL) {
+        if (!PyErr_Occurred()) {
+            PyErr_SetString(PyExc_ImportError, "_binding gave no language");
+        }
+        return false;
+    }
+    uint32_t version = ts_language_version(language);
+    if (version < TREE_SITTER_MIN_COMPATIBLE_LANGUAGE_VERSION || version > TREE_SITTER_LANGUAGE_VERSION) {
+        PyErr_SetString(PyExc_ImportError, "the language is incompatible with the tree-sitter runtime of parse_many");
+        return false;
+    }
+    return true;
+}
+
+PyMODINIT_FUNC PyInit__parse_many(void) {
+    if (language == NULL && !load_language()) {
+        return NULL;
+    }
+    if (parser_pool == NULL) {
+        size_t count = processor_count();
+        parser_pool = tree_sitter_tlaplus_parser_pool_new(1, count < UINT32_MAX ? (uint32_t)count : UINT32_MAX);
+        if (parser_pool == NULL) {
+            return PyErr_NoMemory();
+        }
+    }
+    return PyModule_Create(&module);
+}
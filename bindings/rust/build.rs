@@ -4,6 +4,11 @@ fn main() {
     let mut c_config = cc::Build::new();
     c_config.std("c11").include(src_dir);
 
+    println!("cargo:rerun-if-env-changed=TSTLAPLUS_OPTIMIZED_PARSER");
+    if std::env::var_os("TSTLAPLUS_OPTIMIZED_PARSER").is_some() {
+        c_config.define("TSTLAPLUS_OPTIMIZED_PARSER", None);
+    }
+
     let parser_path = src_dir.join("parser.c");
     c_config.file(&parser_path);
     println!("cargo:rerun-if-changed={}", parser_path.to_str().unwrap());
@@ -12,5 +17,9 @@ fn main() {
     c_config.file(&scanner_path);
     println!("cargo:rerun-if-changed={}", scanner_path.to_str().unwrap());
 
+    let outline_path = src_dir.join("outline.c");
+    c_config.file(&outline_path);
+    println!("cargo:rerun-if-changed={}", outline_path.to_str().unwrap());
+
     c_config.compile("tree-sitter-tlaplus");
 }
@@ -169,7 +169,7 @@
 (constant_declaration (operator_declaration name: (_) @constant))
 (pcal_var_decl (identifier) @variable)
 (pcal_with (identifier) @parameter)
-((".") . (identifier) @attribute)
+(pcal_lhs "." . (identifier) @attribute)
 (record_literal (identifier) @attribute)
 (set_of_records (identifier) @attribute)
 (variable_declaration (identifier) @variable)
@@ -235,7 +235,11 @@
 (block_comment_text) @comment
 (comment) @comment
 (single_line) @comment
-(_ label: (identifier) @label)
+(pcal_algorithm_body label: (identifier) @label)
+(pcal_either label: (identifier) @label)
+(pcal_if label: (identifier) @label)
+(pcal_while label: (identifier) @label)
+(pcal_with label: (identifier) @label)
 (label name: (_) @label)
 (pcal_goto statement: (identifier) @label)
 
@@ -139,7 +139,7 @@
 (constant_declaration (operator_declaration name: (_) @constant))
 (pcal_var_decl (identifier) @variable.builtin)
 (pcal_with (identifier) @variable.parameter)
-((".") . (identifier) @attribute)
+(pcal_lhs "." . (identifier) @attribute)
 (record_literal (identifier) @attribute)
 (set_of_records (identifier) @attribute)
 (variable_declaration (identifier) @variable.builtin)
@@ -216,7 +216,11 @@
 (block_comment_text) @comment
 (comment) @comment
 (single_line) @comment
-(_ label: (identifier) @tag)
+(pcal_algorithm_body label: (identifier) @tag)
+(pcal_either label: (identifier) @tag)
+(pcal_if label: (identifier) @tag)
+(pcal_while label: (identifier) @tag)
+(pcal_with label: (identifier) @tag)
 (label name: (_) @tag)
 (pcal_goto statement: (identifier) @tag)
 
@@ -0,0 +1,29 @@
+#!/usr/bin/env node
+// Post-processes the generated src/parser.c so the optimization-disabling
+// pragmas emitted by `tree-sitter generate` can be turned off by defining
+// TSTLAPLUS_OPTIMIZED_PARSER. Safe to run repeatedly.
+
+const fs = require('fs');
+const path = require('path');
+
+const parserPath = path.join(__dirname, '..', 'src', 'parser.c');
+const pragmaBlock = [
+  '#ifdef _MSC_VER',
+  '#pragma optimize("", off)',
+  '#elif defined(__clang__)',
+  '#pragma clang optimize off',
+  '#elif defined(__GNUC__)',
+  '#pragma GCC optimize ("O0")',
+  '#endif',
+].join('\n');
+const guardedBlock = [
+  '#ifndef TSTLAPLUS_OPTIMIZED_PARSER',
+  pragmaBlock,
+  '#endif // TSTLAPLUS_OPTIMIZED_PARSER',
+].join('\n');
+
+const source = fs.readFileSync(parserPath, 'utf8');
+if (source.includes(guardedBlock) || !source.includes(pragmaBlock)) {
+  process.exit(0);
+}
+fs.writeFileSync(parserPath, source.replace(pragmaBlock, guardedBlock));
@@ -0,0 +1,43 @@
+#!/usr/bin/env node
+// Reports the size of the generated parse table against the budget in
+// script/parser-budget.json, exiting with an error if any count is over
+// budget. Object files or libraries given as arguments have their sizes
+// reported too. Run with --update to lower the budget after shrinking
+// the grammar.
+
+const fs = require('fs');
+const path = require('path');
+
+const parserPath = path.join(__dirname, '..', 'src', 'parser.c');
+const budgetPath = path.join(__dirname, 'parser-budget.json');
+const counts = ['STATE_COUNT', 'LARGE_STATE_COUNT', 'SYMBOL_COUNT', 'TOKEN_COUNT'];
+
+const source = fs.readFileSync(parserPath, 'latin1');
+const current = {};
+for (const name of counts) {
+  const match = source.match(new RegExp(`^#define ${name} (\\d+)$`, 'm'));
+  if (!match) {
+    console.error(`${name} not found in ${parserPath}`);
+    process.exit(2);
+  }
+  current[name] = parseInt(match[1], 10);
+}
+// Line endings are not counted, so Windows checkouts measure the same
+current.PARSER_C_BYTES = source.length - (source.match(/\r/g) || []).length;
+
+const args = process.argv.slice(2);
+if (args.includes('--update')) {
+  fs.writeFileSync(budgetPath, JSON.stringify(current, null, 2) + '\n');
+}
+const budget = JSON.parse(fs.readFileSync(budgetPath, 'utf8'));
+
+let overBudget = false;
+for (const [name, value] of Object.entries(current)) {
+  const over = value > budget[name];
+  overBudget = overBudget || over;
+  console.log(`${name.toLowerCase()}=${value} budget=${budget[name]}${over ? ' over_budget=1' : ''}`);
+}
+for (const file of args.filter((arg) => arg !== '--update')) {
+  console.log(`object=${file} bytes=${fs.statSync(file).size}`);
+}
+process.exit(overBudget ? 1 : 0);
@@ -1,11 +1,34 @@
-from os.path import isdir, join
+from os import environ
+from os.path import isdir, isfile, join
 from platform import system
+from warnings import warn
 
 from setuptools import Extension, find_packages, setup
 from setuptools.command.build import build
 from wheel.bdist_wheel import bdist_wheel
 
 
+# parse_many drives the parser itself, so it is an extension of its own with
+# the tree-sitter runtime compiled in, built only if the runtime is found;
+# extensions are loaded with RTLD_LOCAL, so its symbols do not clash with
+# those of the py-tree-sitter package
+TREE_SITTER_LIB_DIR = environ.get(
+    "TREE_SITTER_LIB_DIR", join("test", "dependencies", "tree-sitter", "lib")
+)
+HAS_RUNTIME = isfile(join(TREE_SITTER_LIB_DIR, "src", "lib.c"))
+if not HAS_RUNTIME:
+    warn(
+        f"tree-sitter runtime not found in {TREE_SITTER_LIB_DIR}, so parse_many is not "
+        "built; run `git submodule update --init --recursive` or set TREE_SITTER_LIB_DIR"
+    )
+
+COMPILE_ARGS = ["-std=c11"] if system() != 'Windows' else []
+LIMITED_API_MACROS = [
+    ("Py_LIMITED_API", "0x03080000"),
+    ("PY_SSIZE_T_CLEAN", None)
+]
+
+
 class Build(build):
     def run(self):
         if isdir("queries"):
@@ -37,18 +60,38 @@ setup(
                 "bindings/python/tree_sitter_tlaplus/binding.c",
                 "src/parser.c",
                 "src/scanner.c",
+                "src/outline.c",
             ],
-            extra_compile_args=(
-                ["-std=c11"] if system() != 'Windows' else []
+            extra_compile_args=COMPILE_ARGS,
+            define_macros=LIMITED_API_MACROS + (
+                [("TSTLAPLUS_OPTIMIZED_PARSER", None)]
+                if environ.get("TSTLAPLUS_OPTIMIZED_PARSER") else []
             ),
-            define_macros=[
-                ("Py_LIMITED_API", "0x03080000"),
-                ("PY_SSIZE_T_CLEAN", None)
-            ],
             include_dirs=["src"],
             py_limited_api=True,
         )
-    ],
+    ] + ([
+        Extension(
+            name="_parse_many",
+            sources=[
+                "bindings/python/tree_sitter_tlaplus/parse_many.c",
+                "bindings/c/tree-sitter-tlaplus-pool.c",
+                join(TREE_SITTER_LIB_DIR, "src", "lib.c"),
+            ],
+            extra_compile_args=COMPILE_ARGS,
+            define_macros=LIMITED_API_MACROS + (
+                [("_POSIX_C_SOURCE", "200809L"), ("_DEFAULT_SOURCE", None)]
+                if system() != 'Windows' else []
+            ),
+            include_dirs=[
+                "src",
+                "bindings/c",
+                join(TREE_SITTER_LIB_DIR, "include"),
+                join(TREE_SITTER_LIB_DIR, "src"),
+            ],
+            py_limited_api=True,
+        )
+    ] if HAS_RUNTIME else []),
     cmdclass={
         "build": Build,
         "bdist_wheel": BdistWheel
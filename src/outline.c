@@ -0,0 +1,862 @@
+#include "../bindings/c/tree-sitter-tlaplus.h"
+#include "stdbool.h"
+#include "string.h"
+
+/**
+ * Outline of a spec: module names & imports along with the names of the
+ * constants, variables, operators and theorems declared by their units.
+ * It is found by a single pass over the source bytes whose tokens are
+ * coarser than the grammar's: expressions are never parsed, brackets are
+ * only matched, and the kind of each definition is told by the few
+ * tokens before its == at bracket depth zero. Entries are emitted in
+ * source order.
+ */
+
+  // Coarse tokens produced by the outline lexer.
+  enum OutlineTokenType {
+    OutlineToken_IDENTIFIER,    // Identifier, not a keyword.
+    OutlineToken_KEYWORD,       // Reserved word; see the keyword field.
+    OutlineToken_PLACEHOLDER,   // The _ of an operator declaration.
+    OutlineToken_PREFIX_OP,     // Symbol of a prefix operator.
+    OutlineToken_INFIX_OP,      // Any other operator or punctuation.
+    OutlineToken_POSTFIX_OP,    // Symbol of a postfix operator.
+    OutlineToken_COMMA,         // The , separator.
+    OutlineToken_DEF_EQ,        // The == or ≜ of a definition.
+    OutlineToken_SINGLE_LINE,   // Line of four or more dashes.
+    OutlineToken_DOUBLE_LINE,   // Line of four or more equals signs.
+    OutlineToken_STEP_ID,       // Proof step ID starting its line.
+    OutlineToken_OPEN,          // (, [ or {
+    OutlineToken_CLOSE,         // ), ] or }
+    OutlineToken_PAREN_GROUP,   // Whole (...) group at depth zero.
+    OutlineToken_BRACKET_GROUP, // Whole [...] or {...} group at depth zero.
+    OutlineToken_OTHER,         // Numbers, strings, and anything else.
+    OutlineToken_END_OF_FILE
+  };
+
+  // Keywords distinguished by the outline.
+  enum OutlineKeyword {
+    OutlineKeyword_NONE,
+    OutlineKeyword_OTHER,       // Any keyword not listed below.
+    OutlineKeyword_MODULE,
+    OutlineKeyword_EXTENDS,
+    OutlineKeyword_INSTANCE,
+    OutlineKeyword_LOCAL,
+    OutlineKeyword_LET,
+    OutlineKeyword_IN,
+    OutlineKeyword_THEOREM,     // Or PROPOSITION, LEMMA, COROLLARY.
+    OutlineKeyword_ASSUMPTION,  // Or ASSUME, AXIOM.
+    OutlineKeyword_CONSTANT,    // Or CONSTANTS.
+    OutlineKeyword_VARIABLE,    // Or VARIABLES.
+    OutlineKeyword_QED,
+    OutlineKeyword_NEW,
+    OutlineKeyword_STEP_REF,    // Keywords followed by proof step refs.
+    OutlineKeyword_PREFIX_OP    // DOMAIN, ENABLED, SUBSET, UNCHANGED, UNION.
+  };
+
+  // A keyword and its kind.
+  struct OutlineKeywordEntry {
+    const char *text;
+    enum OutlineKeyword keyword;
+  };
+
+  // All reserved words of the grammar, sorted for binary search.
+  static const struct OutlineKeywordEntry outline_keywords[] = {
+    {"ACTION", OutlineKeyword_OTHER},
+    {"ASSUME", OutlineKeyword_ASSUMPTION},
+    {"ASSUMPTION", OutlineKeyword_ASSUMPTION},
+    {"AXIOM", OutlineKeyword_ASSUMPTION},
+    {"BY", OutlineKeyword_STEP_REF},
+    {"CASE", OutlineKeyword_OTHER},
+    {"CHOOSE", OutlineKeyword_OTHER},
+    {"CONSTANT", OutlineKeyword_CONSTANT},
+    {"CONSTANTS", OutlineKeyword_CONSTANT},
+    {"COROLLARY", OutlineKeyword_THEOREM},
+    {"DEF", OutlineKeyword_STEP_REF},
+    {"DEFINE", OutlineKeyword_OTHER},
+    {"DEFS", OutlineKeyword_STEP_REF},
+    {"DOMAIN", OutlineKeyword_PREFIX_OP},
+    {"ELSE", OutlineKeyword_OTHER},
+    {"ENABLED", OutlineKeyword_PREFIX_OP},
+    {"EXCEPT", OutlineKeyword_OTHER},
+    {"EXTENDS", OutlineKeyword_EXTENDS},
+    {"HAVE", OutlineKeyword_OTHER},
+    {"HIDE", OutlineKeyword_STEP_REF},
+    {"IF", OutlineKeyword_OTHER},
+    {"IN", OutlineKeyword_IN},
+    {"INSTANCE", OutlineKeyword_INSTANCE},
+    {"LAMBDA", OutlineKeyword_OTHER},
+    {"LEMMA", OutlineKeyword_THEOREM},
+    {"LET", OutlineKeyword_LET},
+    {"LOCAL", OutlineKeyword_LOCAL},
+    {"MODULE", OutlineKeyword_MODULE},
+    {"NEW", OutlineKeyword_NEW},
+    {"OBVIOUS", OutlineKeyword_OTHER},
+    {"OMITTED", OutlineKeyword_OTHER},
+    {"ONLY", OutlineKeyword_STEP_REF},
+    {"OTHER", OutlineKeyword_OTHER},
+    {"PICK", OutlineKeyword_OTHER},
+    {"PROOF", OutlineKeyword_OTHER},
+    {"PROPOSITION", OutlineKeyword_THEOREM},
+    {"PROVE", OutlineKeyword_OTHER},
+    {"QED", OutlineKeyword_QED},
+    {"RECURSIVE", OutlineKeyword_OTHER},
+    {"STATE", OutlineKeyword_OTHER},
+    {"SUBSET", OutlineKeyword_PREFIX_OP},
+    {"SUFFICES", OutlineKeyword_OTHER},
+    {"TAKE", OutlineKeyword_OTHER},
+    {"TEMPORAL", OutlineKeyword_OTHER},
+    {"THEN", OutlineKeyword_OTHER},
+    {"THEOREM", OutlineKeyword_THEOREM},
+    {"UNCHANGED", OutlineKeyword_PREFIX_OP},
+    {"UNION", OutlineKeyword_PREFIX_OP},
+    {"USE", OutlineKeyword_STEP_REF},
+    {"VARIABLE", OutlineKeyword_VARIABLE},
+    {"VARIABLES", OutlineKeyword_VARIABLE},
+    {"WITH", OutlineKeyword_OTHER},
+    {"WITNESS", OutlineKeyword_OTHER}
+  };
+
+  // A lexed token and the span of source it covers.
+  struct OutlineToken {
+    enum OutlineTokenType type;
+    enum OutlineKeyword keyword;
+    uint32_t start_byte;
+    uint32_t end_byte;
+  };
+
+  // Comma-separated lists whose items are emitted, and the position
+  // within the current item.
+  enum OutlineListState {
+    OutlineList_NONE,
+    OutlineList_NAME,                 // EXTENDS or VARIABLE item expected.
+    OutlineList_NAME_SEPARATOR,       // Comma expected after such an item.
+    OutlineList_CONSTANT,             // CONSTANT item expected.
+    OutlineList_CONSTANT_NAME,        // After the name of an op(_, _) item.
+    OutlineList_CONSTANT_PLACEHOLDER, // After the _ starting _+_ or _^+.
+    OutlineList_CONSTANT_SYMBOL,      // _ or comma expected after -. or _+.
+    OutlineList_CONSTANT_SEPARATOR    // Comma expected after the item.
+  };
+
+  // Number of depth-zero tokens remembered before each ==.
+  #define OUTLINE_HISTORY_SIZE 4
+
+  // Outline lexer & parser state.
+  struct Outline {
+    const char *source;
+    uint32_t length;
+    uint32_t position;
+
+    // Whether only whitespace precedes the position on its line.
+    bool at_line_start;
+
+    TSTlaplusOutlineCallback callback;
+    void *payload;
+
+    // Number of modules open at the position, and whether text outside
+    // of modules has been skipped up to the start of one.
+    uint32_t module_depth;
+    bool at_module_start;
+
+    // Number of brackets open at the position, and the first of them.
+    uint32_t group_depth;
+    struct OutlineToken group;
+
+    // Number of LET without their IN.
+    uint32_t let_depth;
+
+    // Whether units are inside a proof, whose definitions are local.
+    bool in_proof;
+
+    // Whether the next identifier is the name of a module or instance.
+    bool expect_module_name;
+    bool expect_instance_name;
+    bool instance_is_local;
+
+    // The list being read, and the kind of its entries.
+    enum OutlineListState list;
+    TSTlaplusOutlineKind list_kind;
+
+    // Last depth-zero tokens, most recent first.
+    struct OutlineToken history[OUTLINE_HISTORY_SIZE];
+
+    // A definition is emitted at the token after its ==, unless that is
+    // INSTANCE; then it is a module definition and the instance is.
+    bool has_pending_definition;
+    TSTlaplusOutlineEntry pending_definition;
+  };
+
+  /**
+   * Checks whether the byte can be part of an identifier.
+   *
+   * @param byte The byte to check.
+   * @return Whether the byte is an ASCII letter, digit or underscore.
+   */
+  static bool outline_is_word_byte(char const byte) {
+    return ('a' <= byte && byte <= 'z') || ('A' <= byte && byte <= 'Z')
+      || ('0' <= byte && byte <= '9') || '_' == byte;
+  }
+
+  /**
+   * Checks whether the byte can be part of an ASCII operator symbol.
+   *
+   * @param byte The byte to check.
+   * @return Whether the byte is an operator character.
+   */
+  static bool outline_is_operator_byte(char const byte) {
+    switch (byte) {
+      case '~': case '!': case '@': case '#': case '$': case '%': case '^':
+      case '&': case '*': case '-': case '+': case '=': case '|': case '<':
+      case '>': case '/': case ':': case '.': case '?': case '\'':
+        return true;
+      default:
+        return false;
+    }
+  }
+
+    /**
+     * Checks whether the source continues with the given text.
+     *
+     * @param this The outline state.
+     * @param offset Bytes after the position at which to look.
+     * @param text The text to look for.
+     * @return Whether the text is found there.
+     */
+    static bool outline_is_next(
+      const struct Outline* const this,
+      uint32_t const offset,
+      const char* const text
+    ) {
+      uint32_t const length = (uint32_t)strlen(text);
+      return this->position + offset <= this->length
+        && length <= this->length - this->position - offset
+        && 0 == memcmp(this->source + this->position + offset, text, length);
+    }
+
+    /**
+     * Returns the byte the given distance after the position, or NUL past
+     * the end of the source.
+     *
+     * @param this The outline state.
+     * @param offset Bytes after the position at which to look.
+     * @return The byte at that offset.
+     */
+    static char outline_peek(const struct Outline* const this, uint32_t const offset) {
+      return this->position + offset < this->length
+        ? this->source[this->position + offset]
+        : '\0';
+    }
+
+    /**
+     * Skips text outside of modules up to the next module start, which
+     * matches /----[-]*[ ]*MODULE/ as in the external scanner.
+     *
+     * @param this The outline state.
+     * @return Whether a module start was found.
+     */
+    static bool outline_skip_extramodular_text(struct Outline* const this) {
+      while (this->position < this->length) {
+        const char* const dash = memchr(
+          this->source + this->position, '-', this->length - this->position);
+        if (NULL == dash) break;
+        uint32_t const start = (uint32_t)(dash - this->source);
+        this->position = start;
+        while ('-' == outline_peek(this, 0)) this->position++;
+        if (this->position - start >= 4) {
+          while (' ' == outline_peek(this, 0)) this->position++;
+          if (outline_is_next(this, 0, "MODULE")) {
+            this->position = start;
+            this->at_module_start = true;
+            return true;
+          }
+        }
+      }
+      this->position = this->length;
+      return false;
+    }
+
+    /**
+     * Skips a block comment, which may be nested, from its opening (*.
+     *
+     * @param this The outline state.
+     */
+    static void outline_skip_block_comment(struct Outline* const this) {
+      uint32_t depth = 0;
+      while (this->position < this->length) {
+        if (outline_is_next(this, 0, "(*")) {
+          depth++;
+          this->position += 2;
+        } else if (outline_is_next(this, 0, "*)")) {
+          this->position += 2;
+          if (0 == --depth) return;
+        } else {
+          this->position++;
+        }
+      }
+    }
+
+    /**
+     * Looks up the kind of the keyword with the given text.
+     *
+     * @param text Start of the word.
+     * @param length Length of the word.
+     * @return The keyword, or NONE if the word is an identifier.
+     */
+    static enum OutlineKeyword outline_keyword(const char* const text, uint32_t const length) {
+      if (length < 2 || length > 11 || text[0] < 'A' || text[0] > 'Z') {
+        return OutlineKeyword_NONE;
+      }
+      size_t low = 0;
+      size_t high = sizeof(outline_keywords) / sizeof(outline_keywords[0]);
+      while (low < high) {
+        size_t const middle = (low + high) / 2;
+        const char* const keyword = outline_keywords[middle].text;
+        int order = strncmp(keyword, text, length);
+        if (0 == order && '\0' != keyword[length]) order = 1;
+        if (0 == order) return outline_keywords[middle].keyword;
+        if (order < 0) {
+          low = middle + 1;
+        } else {
+          high = middle;
+        }
+      }
+      return OutlineKeyword_NONE;
+    }
+
+    /**
+     * Classifies the ASCII operator symbol just lexed.
+     *
+     * @param text Start of the symbol.
+     * @param length Length of the symbol.
+     * @return Which kind of operator the symbol could name.
+     */
+    static enum OutlineTokenType outline_operator_type(const char* const text, uint32_t const length) {
+      if ((2 == length && 0 == memcmp(text, "-.", 2))
+          || (1 == length && '~' == text[0])
+          || (2 == length && 0 == memcmp(text, "<>", 2))
+          || (5 == length && 0 == memcmp(text, "\\lnot", 5))
+          || (4 == length && 0 == memcmp(text, "\\neg", 4))) {
+        return OutlineToken_PREFIX_OP;
+      }
+      if ((2 == length && '^' == text[0] && NULL != strchr("+*#", text[1]))
+          || (1 == length && '\'' == text[0])) {
+        return OutlineToken_POSTFIX_OP;
+      }
+      // Closing a tuple, so never the symbol of an infix definition
+      if (length >= 2 && 0 == memcmp(text, ">>", 2)) {
+        return OutlineToken_OTHER;
+      }
+      return OutlineToken_INFIX_OP;
+    }
+
+    /**
+     * Lexes a non-ASCII codepoint, which is an operator, a ≜, or one of
+     * the number sets that the grammar lexes as identifiers.
+     *
+     * @param this The outline state.
+     * @return The type of the token.
+     */
+    static enum OutlineTokenType outline_lex_codepoint(struct Outline* const this) {
+      unsigned char const lead = (unsigned char)outline_peek(this, 0);
+      uint32_t const length = lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 1;
+      enum OutlineTokenType type = OutlineToken_INFIX_OP;
+      if (outline_is_next(this, 0, "≜")) {
+        type = OutlineToken_DEF_EQ;
+      } else if (outline_is_next(this, 0, "ℕ") || outline_is_next(this, 0, "ℤ")
+          || outline_is_next(this, 0, "ℝ")) {
+        type = OutlineToken_IDENTIFIER;
+      } else if (outline_is_next(this, 0, "¬") || outline_is_next(this, 0, "□")
+          || outline_is_next(this, 0, "⋄") || outline_is_next(this, 0, "◇")) {
+        type = OutlineToken_PREFIX_OP;
+      } else if (outline_is_next(this, 0, "⁺")) {
+        type = OutlineToken_POSTFIX_OP;
+      } else if (outline_is_next(this, 0, "⟩") || outline_is_next(this, 0, "〉")) {
+        type = OutlineToken_OTHER;
+      } else if (1 == length) {
+        type = OutlineToken_OTHER;
+      }
+      this->position += length <= this->length - this->position
+        ? length
+        : this->length - this->position;
+      return type;
+    }
+
+    /**
+     * Lexes the next token, skipping whitespace, comments, and text
+     * outside of modules.
+     *
+     * @param this The outline state.
+     * @return The next token.
+     */
+    static struct OutlineToken outline_lex(struct Outline* const this) {
+      struct OutlineToken token;
+      token.keyword = OutlineKeyword_NONE;
+      for (;;) {
+        if (0 == this->module_depth && !this->at_module_start && !outline_skip_extramodular_text(this)) {
+          token.type = OutlineToken_END_OF_FILE;
+          token.start_byte = token.end_byte = this->length;
+          return token;
+        }
+        if (this->position >= this->length) {
+          token.type = OutlineToken_END_OF_FILE;
+          token.start_byte = token.end_byte = this->length;
+          return token;
+        }
+
+        char const byte = this->source[this->position];
+        if ('\n' == byte) {
+          this->at_line_start = true;
+          this->position++;
+        } else if (' ' == byte || '\t' == byte || '\r' == byte || '\f' == byte || '\v' == byte) {
+          this->position++;
+        } else if ('\\' == byte && '*' == outline_peek(this, 1)) {
+          const char* const end = memchr(
+            this->source + this->position, '\n', this->length - this->position);
+          this->position = NULL == end ? this->length : (uint32_t)(end - this->source);
+        } else if ('(' == byte && '*' == outline_peek(this, 1)) {
+          outline_skip_block_comment(this);
+        } else {
+          break;
+        }
+      }
+
+      bool const at_line_start = this->at_line_start;
+      this->at_line_start = false;
+      token.start_byte = this->position;
+      const char* const text = this->source + this->position;
+      char const byte = text[0];
+      if (outline_is_word_byte(byte)) {
+        bool has_letter = false;
+        while (outline_is_word_byte(outline_peek(this, 0))) {
+          char const next = outline_peek(this, 0);
+          has_letter |= !('0' <= next && next <= '9') && '_' != next;
+          this->position++;
+        }
+        uint32_t const length = this->position - token.start_byte;
+        if (has_letter) {
+          token.keyword = outline_keyword(text, length);
+          token.type = OutlineKeyword_NONE == token.keyword
+            ? OutlineToken_IDENTIFIER
+            : OutlineToken_KEYWORD;
+        } else {
+          token.type = 1 == length && '_' == byte
+            ? OutlineToken_PLACEHOLDER
+            : OutlineToken_OTHER;
+        }
+      } else if ('"' == byte) {
+        this->position++;
+        while (this->position < this->length && '"' != outline_peek(this, 0) && '\n' != outline_peek(this, 0)) {
+          this->position += '\\' == outline_peek(this, 0) && this->position + 1 < this->length ? 2 : 1;
+        }
+        if ('"' == outline_peek(this, 0)) this->position++;
+        token.type = OutlineToken_OTHER;
+      } else if (',' == byte) {
+        this->position++;
+        token.type = OutlineToken_COMMA;
+      } else if ('(' == byte && (outline_is_next(this, 0, "(+)") || outline_is_next(this, 0, "(-)")
+          || outline_is_next(this, 0, "(.)") || outline_is_next(this, 0, "(/)"))) {
+        this->position += 3;
+        token.type = OutlineToken_INFIX_OP;
+      } else if (outline_is_next(this, 0, "(\\X)") || outline_is_next(this, 0, "/\\")) {
+        this->position += '(' == byte ? 4 : 2;
+        token.type = OutlineToken_INFIX_OP;
+      } else if ('(' == byte || '[' == byte || '{' == byte) {
+        this->position++;
+        token.type = OutlineToken_OPEN;
+      } else if (')' == byte || ']' == byte || '}' == byte) {
+        this->position++;
+        token.type = OutlineToken_CLOSE;
+      } else if ('\\' == byte) {
+        this->position++;
+        if ('/' == outline_peek(this, 0) || '\\' == outline_peek(this, 0)) {
+          this->position++;
+        } else {
+          while (outline_is_word_byte(outline_peek(this, 0))) this->position++;
+        }
+        token.type = outline_operator_type(text, this->position - token.start_byte);
+      } else if ('<' == byte && at_line_start
+          && (('0' <= outline_peek(this, 1) && outline_peek(this, 1) <= '9')
+            || '*' == outline_peek(this, 1) || '+' == outline_peek(this, 1))) {
+        // <1>a. starting a line is a proof step, or its reference
+        uint32_t offset = 2;
+        if ('0' <= outline_peek(this, 1) && outline_peek(this, 1) <= '9') {
+          while ('0' <= outline_peek(this, offset) && outline_peek(this, offset) <= '9') offset++;
+        }
+        if ('>' == outline_peek(this, offset)) {
+          this->position += offset + 1;
+          while (outline_is_word_byte(outline_peek(this, 0))) this->position++;
+          while ('.' == outline_peek(this, 0)) this->position++;
+          token.type = OutlineToken_STEP_ID;
+        } else {
+          this->position++;
+          token.type = OutlineToken_INFIX_OP;
+        }
+      } else if ('-' == byte && outline_is_next(this, 0, "----")) {
+        while ('-' == outline_peek(this, 0)) this->position++;
+        token.type = OutlineToken_SINGLE_LINE;
+      } else if ('=' == byte && '=' == outline_peek(this, 1)) {
+        while ('=' == outline_peek(this, 0)) this->position++;
+        uint32_t const length = this->position - token.start_byte;
+        token.type = length >= 4
+          ? OutlineToken_DOUBLE_LINE
+          : 2 == length ? OutlineToken_DEF_EQ : OutlineToken_INFIX_OP;
+      } else if (outline_is_operator_byte(byte)) {
+        // Runs of symbols are one token, ending before any ==
+        do {
+          this->position++;
+        } while (outline_is_operator_byte(outline_peek(this, 0))
+          && !outline_is_next(this, 0, "=="));
+        token.type = outline_operator_type(text, this->position - token.start_byte);
+      } else {
+        token.type = outline_lex_codepoint(this);
+      }
+      token.end_byte = this->position;
+      return token;
+    }
+
+    /**
+     * Passes an entry naming the given token to the callback.
+     *
+     * @param this The outline state.
+     * @param kind The kind of entry.
+     * @param name The token holding the name.
+     * @param local Whether the entry was declared LOCAL.
+     */
+    static void outline_emit(
+      struct Outline* const this,
+      TSTlaplusOutlineKind const kind,
+      const struct OutlineToken* const name,
+      bool const local
+    ) {
+      TSTlaplusOutlineEntry entry;
+      entry.kind = kind;
+      entry.module_depth = this->module_depth > 0 ? this->module_depth - 1 : 0;
+      entry.local = local;
+      entry.start_byte = name->start_byte;
+      entry.end_byte = name->end_byte;
+      this->callback(this->payload, &entry);
+    }
+
+    /**
+     * Checks whether the token is an operator symbol of the given type.
+     *
+     * @param token The token to check.
+     * @param type PREFIX_OP, INFIX_OP or POSTFIX_OP.
+     * @return Whether the token is such a symbol.
+     */
+    static bool outline_is_operator(const struct OutlineToken* const token, enum OutlineTokenType const type) {
+      return type == token->type
+        || (OutlineToken_PREFIX_OP == type && OutlineKeyword_PREFIX_OP == token->keyword);
+    }
+
+    /**
+     * Checks whether the depth-zero token at the given distance back is
+     * the given keyword.
+     *
+     * @param this The outline state.
+     * @param index Index into the history, most recent first.
+     * @param keyword The keyword to check for.
+     * @return Whether the token is that keyword.
+     */
+    static bool outline_history_is(
+      const struct Outline* const this,
+      unsigned const index,
+      enum OutlineKeyword const keyword
+    ) {
+      return index < OUTLINE_HISTORY_SIZE && keyword == this->history[index].keyword;
+    }
+
+    /**
+     * Records the definition whose == is the current token, telling its
+     * kind by the tokens before it; function definitions are left out.
+     *
+     * @param this The outline state.
+     */
+    static void outline_definition(struct Outline* const this) {
+      const struct OutlineToken* const history = this->history;
+      const struct OutlineToken* name = NULL;
+      unsigned name_index = 0;
+      if (OutlineToken_IDENTIFIER == history[0].type) {
+        if (outline_history_is(this, 1, OutlineKeyword_THEOREM)) {
+          outline_emit(this, TSTlaplusOutlineTheorem, &history[0], false);
+          return;
+        } else if (outline_history_is(this, 1, OutlineKeyword_ASSUMPTION)) {
+          return;
+        } else if (outline_is_operator(&history[1], OutlineToken_INFIX_OP)
+            && OutlineToken_IDENTIFIER == history[2].type) {
+          name_index = 1;
+        } else if (outline_is_operator(&history[1], OutlineToken_PREFIX_OP)) {
+          name_index = 1;
+        }
+        name = &history[name_index];
+      } else if (OutlineToken_PAREN_GROUP == history[0].type
+          && OutlineToken_IDENTIFIER == history[1].type) {
+        name_index = 1;
+        name = &history[1];
+      } else if (outline_is_operator(&history[0], OutlineToken_POSTFIX_OP)
+          && OutlineToken_IDENTIFIER == history[1].type) {
+        name = &history[0];
+      }
+      if (NULL == name) return;
+
+      // Parameters of infix & postfix definitions come before the name
+      bool const has_parameter_first = outline_is_operator(name, OutlineToken_INFIX_OP)
+        || outline_is_operator(name, OutlineToken_POSTFIX_OP);
+      unsigned const first_index = name_index + (has_parameter_first ? 1 : 0);
+      this->has_pending_definition = true;
+      this->pending_definition.kind = TSTlaplusOutlineOperator;
+      this->pending_definition.module_depth = this->module_depth - 1;
+      this->pending_definition.local = outline_history_is(this, first_index + 1, OutlineKeyword_LOCAL);
+      this->pending_definition.start_byte = name->start_byte;
+      this->pending_definition.end_byte = name->end_byte;
+    }
+
+    /**
+     * Continues the EXTENDS, CONSTANT or VARIABLE list being read.
+     *
+     * @param this The outline state.
+     * @param token The depth-zero token.
+     * @return Whether the token belongs to the list.
+     */
+    static bool outline_list_token(struct Outline* const this, const struct OutlineToken* const token) {
+      enum OutlineTokenType const type = token->type;
+      bool const is_comma = OutlineToken_COMMA == type;
+      bool const is_placeholder = OutlineToken_PLACEHOLDER == type;
+      bool const is_symbol = outline_is_operator(token, OutlineToken_PREFIX_OP)
+        || OutlineToken_INFIX_OP == type
+        || OutlineToken_POSTFIX_OP == type;
+      switch (this->list) {
+        case OutlineList_NAME:
+          if (OutlineToken_IDENTIFIER != type) break;
+          outline_emit(this, this->list_kind, token, false);
+          this->list = OutlineList_NAME_SEPARATOR;
+          return true;
+        case OutlineList_NAME_SEPARATOR:
+          if (!is_comma) break;
+          this->list = OutlineList_NAME;
+          return true;
+        case OutlineList_CONSTANT:
+          if (OutlineToken_IDENTIFIER == type) {
+            outline_emit(this, TSTlaplusOutlineConstant, token, false);
+            this->list = OutlineList_CONSTANT_NAME;
+          } else if (is_placeholder) {
+            this->list = OutlineList_CONSTANT_PLACEHOLDER;
+          } else if (outline_is_operator(token, OutlineToken_PREFIX_OP)) {
+            outline_emit(this, TSTlaplusOutlineConstant, token, false);
+            this->list = OutlineList_CONSTANT_SYMBOL;
+          } else {
+            break;
+          }
+          return true;
+        case OutlineList_CONSTANT_NAME:
+          if (OutlineToken_PAREN_GROUP == type) {
+            this->list = OutlineList_CONSTANT_SEPARATOR;
+            return true;
+          }
+          if (!is_comma) break;
+          this->list = OutlineList_CONSTANT;
+          return true;
+        case OutlineList_CONSTANT_PLACEHOLDER:
+          if (!is_symbol) break;
+          outline_emit(this, TSTlaplusOutlineConstant, token, false);
+          this->list = OutlineList_CONSTANT_SYMBOL;
+          return true;
+        case OutlineList_CONSTANT_SYMBOL:
+          if (is_placeholder) {
+            this->list = OutlineList_CONSTANT_SEPARATOR;
+            return true;
+          }
+          if (!is_comma) break;
+          this->list = OutlineList_CONSTANT;
+          return true;
+        case OutlineList_CONSTANT_SEPARATOR:
+          if (!is_comma) break;
+          this->list = OutlineList_CONSTANT;
+          return true;
+        default:
+          break;
+      }
+      this->list = OutlineList_NONE;
+      return false;
+    }
+
+    /**
+     * Resets the state of the units of a module at its start or end.
+     *
+     * @param this The outline state.
+     */
+    static void outline_reset_units(struct Outline* const this) {
+      this->group_depth = 0;
+      this->let_depth = 0;
+      this->in_proof = false;
+      this->expect_module_name = false;
+      this->expect_instance_name = false;
+      this->list = OutlineList_NONE;
+      this->has_pending_definition = false;
+    }
+
+    /**
+     * Handles a token outside of any brackets.
+     *
+     * @param this The outline state.
+     * @param token The token.
+     */
+    static void outline_token(struct Outline* const this, const struct OutlineToken* const token) {
+      if (this->has_pending_definition) {
+        this->has_pending_definition = false;
+        if (OutlineKeyword_INSTANCE == token->keyword) {
+          this->instance_is_local = this->pending_definition.local;
+        } else {
+          this->callback(this->payload, &this->pending_definition);
+        }
+      }
+
+      bool const is_list_token = OutlineList_NONE != this->list && outline_list_token(this, token);
+      if (!is_list_token) {
+        bool const is_unit = 0 == this->let_depth && !this->in_proof;
+        if (this->expect_module_name) {
+          this->expect_module_name = false;
+          if (OutlineToken_IDENTIFIER == token->type) {
+            outline_emit(this, TSTlaplusOutlineModule, token, false);
+          }
+        } else if (this->expect_instance_name) {
+          this->expect_instance_name = false;
+          if (OutlineToken_IDENTIFIER == token->type) {
+            outline_emit(this, TSTlaplusOutlineInstance, token, this->instance_is_local);
+          }
+        }
+
+        switch (token->type) {
+          case OutlineToken_SINGLE_LINE:
+            break;
+          case OutlineToken_DOUBLE_LINE:
+            if (this->module_depth > 0) this->module_depth--;
+            outline_reset_units(this);
+            break;
+          case OutlineToken_STEP_ID:
+            // Step refs continuing a BY or USE are not new steps
+            if (OutlineToken_COMMA != this->history[0].type
+                && OutlineKeyword_STEP_REF != this->history[0].keyword) {
+              this->in_proof = true;
+            }
+            break;
+          case OutlineToken_DEF_EQ:
+            if (is_unit) outline_definition(this);
+            break;
+          case OutlineToken_KEYWORD:
+            switch (token->keyword) {
+              case OutlineKeyword_MODULE:
+                this->at_module_start = false;
+                if (OutlineToken_SINGLE_LINE == this->history[0].type) {
+                  this->module_depth++;
+                  outline_reset_units(this);
+                  this->expect_module_name = true;
+                }
+                break;
+              case OutlineKeyword_VARIABLE:
+              case OutlineKeyword_CONSTANT:
+                // ASSUME NEW CONSTANT x, VARIABLE y declare parameters
+                if (OutlineKeyword_NEW == this->history[0].keyword
+                    || OutlineKeyword_ASSUMPTION == this->history[0].keyword
+                    || OutlineToken_COMMA == this->history[0].type) {
+                  break;
+                }
+                // fall through
+              case OutlineKeyword_EXTENDS:
+                // These only start units, so also recover from mismatches
+                this->let_depth = 0;
+                this->in_proof = false;
+                this->list = OutlineKeyword_CONSTANT == token->keyword
+                  ? OutlineList_CONSTANT
+                  : OutlineList_NAME;
+                this->list_kind = OutlineKeyword_EXTENDS == token->keyword
+                  ? TSTlaplusOutlineExtends
+                  : TSTlaplusOutlineVariable;
+                break;
+              case OutlineKeyword_THEOREM:
+              case OutlineKeyword_LOCAL:
+                this->let_depth = 0;
+                this->in_proof = false;
+                break;
+              case OutlineKeyword_INSTANCE:
+                if (is_unit) {
+                  this->expect_instance_name = true;
+                  if (OutlineKeyword_LOCAL == this->history[0].keyword) {
+                    this->instance_is_local = true;
+                  } else if (OutlineToken_DEF_EQ != this->history[0].type) {
+                    this->instance_is_local = false;
+                  }
+                }
+                break;
+              case OutlineKeyword_LET:
+                this->let_depth++;
+                break;
+              case OutlineKeyword_IN:
+                if (this->let_depth > 0) this->let_depth--;
+                break;
+              case OutlineKeyword_QED:
+                this->in_proof = false;
+                break;
+              default:
+                break;
+            }
+            break;
+          default:
+            break;
+        }
+      }
+
+      memmove(&this->history[1], &this->history[0], (OUTLINE_HISTORY_SIZE - 1) * sizeof(struct OutlineToken));
+      this->history[0] = *token;
+    }
+
+void tree_sitter_tlaplus_outline(
+  const char *source,
+  uint32_t length,
+  TSTlaplusOutlineCallback callback,
+  void *payload
+) {
+  struct Outline outline;
+  memset(&outline, 0, sizeof(outline));
+  outline.source = source;
+  outline.length = length;
+  outline.at_line_start = true;
+  outline.callback = callback;
+  outline.payload = payload;
+  for (unsigned i = 0; i < OUTLINE_HISTORY_SIZE; i++) {
+    outline.history[i].type = OutlineToken_OTHER;
+  }
+
+  for (;;) {
+    struct OutlineToken token = outline_lex(&outline);
+    if (OutlineToken_END_OF_FILE == token.type) break;
+
+    // Brackets are matched but their contents only track LET nesting,
+    // except that module ends recover from unbalanced brackets
+    if (OutlineToken_DOUBLE_LINE == token.type) {
+      outline.group_depth = 0;
+    } else if (OutlineToken_OPEN == token.type) {
+      if (0 == outline.group_depth++) outline.group = token;
+      continue;
+    } else if (outline.group_depth > 0) {
+      if (OutlineToken_CLOSE == token.type && 0 == --outline.group_depth) {
+        bool const is_box = '[' == source[outline.group.start_byte]
+          && outline.group.end_byte == token.start_byte;
+        token.type = '(' == source[outline.group.start_byte]
+          ? OutlineToken_PAREN_GROUP
+          : is_box ? OutlineToken_PREFIX_OP : OutlineToken_BRACKET_GROUP;
+        token.start_byte = outline.group.start_byte;
+      } else {
+        if (OutlineKeyword_LET == token.keyword) outline.let_depth++;
+        if (OutlineKeyword_IN == token.keyword && outline.let_depth > 0) outline.let_depth--;
+        continue;
+      }
+    } else if (OutlineToken_CLOSE == token.type) {
+      token.type = OutlineToken_OTHER;
+    }
+    outline_token(&outline, &token);
+  }
+
+  if (outline.has_pending_definition) {
+    callback(payload, &outline.pending_definition);
+  }
+}
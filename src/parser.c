@@ -4,6 +4,7 @@
 #pragma GCC diagnostic ignored "-Wmissing-field-initializers"
 #endif
 
+#ifndef TSTLAPLUS_OPTIMIZED_PARSER
 #ifdef _MSC_VER
 #pragma optimize("", off)
 #elif defined(__clang__)
@@ -11,6 +12,7 @@
 #elif defined(__GNUC__)
 #pragma GCC optimize ("O0")
 #endif
+#endif // TSTLAPLUS_OPTIMIZED_PARSER
 
 #define LANGUAGE_VERSION 14
 #define STATE_COUNT 5484
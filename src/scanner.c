@@ -4,7 +4,30 @@
 #include "assert.h"
 #include "limits.h"
 #include "string.h"
-#include "wctype.h"
+
+/**
+ * Macro; evaluates the statement only if scanner statistics are enabled.
+ *
+ * @param statement The statement updating scanner statistics.
+ */
+#ifdef TLAPLUS_SCANNER_STATS
+#define SCANNER_STATS(statement) statement
+#else
+#define SCANNER_STATS(statement)
+#endif
+
+/**
+ * Macro; storage class of the per-thread scanner globals. WebAssembly
+ * modules loaded by web-tree-sitter run on a single thread and are built
+ * without thread-local storage, so there they are ordinary globals.
+ */
+#if defined(__EMSCRIPTEN__) || defined(__wasm__)
+#define SCANNER_THREAD_LOCAL
+#elif defined(_MSC_VER)
+#define SCANNER_THREAD_LOCAL __declspec(thread)
+#else
+#define SCANNER_THREAD_LOCAL __thread
+#endif
 
 /**
  * Macro; goes to the lexer state without consuming any codepoints.
@@ -74,11 +97,81 @@
   // Datatype used to record column index of jlists.
   typedef int16_t column_index;
 
+  // Columns past this are recorded as this, so jlists on very long lines
+  // compare as aligned rather than overflowing column_index.
+  #define COLUMN_INDEX_MAX INT16_MAX
+
   // Datatype used to record proof levels.
   typedef int32_t proof_level;
 
-  // A dynamic array of chars.
-  typedef Array(char) CharArray;
+  // Proof levels past this are recorded as this; small enough that the
+  // zigzag-encoded level shifted left by a flag bit still fits 32 bits.
+  #define PROOF_LEVEL_MAX ((proof_level)((1 << 29) - 1))
+
+  // Classes of codepoints distinguished by the scanner.
+  enum CharClass {
+    CharClass_WHITESPACE  = 1 << 0, // Space, tab, and line break codepoints.
+    CharClass_DIGIT       = 1 << 1, // The ASCII digits 0-9.
+    CharClass_ALPHA       = 1 << 2, // ASCII uppercase & lowercase letters.
+    CharClass_UNDERSCORE  = 1 << 3  // The underscore codepoint.
+  };
+
+  // Classes of every ASCII codepoint. Codepoints outside ASCII belong to
+  // no class, as in the grammar's identifier & whitespace rules; looking
+  // them up with iswspace & iswalnum would make lexing depend on the
+  // locale of the host process, and on that locale's data being present.
+  static const uint8_t ascii_char_classes[128] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 0, 0, // 0x00-0x0F
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x10-0x1F
+    1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x20-0x2F
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 0, 0, 0, 0, 0, 0, // 0x30-0x3F
+    0, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, // 0x40-0x4F
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 0, 0, 0, 0, 8, // 0x50-0x5F
+    0, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, // 0x60-0x6F
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 0, 0, 0, 0, 0  // 0x70-0x7F
+  };
+
+  /**
+   * Checks whether the given codepoint belongs to any of the given classes.
+   *
+   * @param codepoint The codepoint to check.
+   * @param classes Bitwise OR of the CharClass values to check for.
+   * @return Whether the codepoint belongs to any of the given classes.
+   */
+  static bool is_char_class(int32_t const codepoint, uint8_t const classes) {
+    return (uint32_t)codepoint < 128
+      && 0 != (ascii_char_classes[codepoint] & classes);
+  }
+
+  /**
+   * Checks whether the given codepoint is whitespace.
+   *
+   * @param codepoint The codepoint to check.
+   * @return Whether the given codepoint is whitespace.
+   */
+  static bool is_whitespace(int32_t const codepoint) {
+    return is_char_class(codepoint, CharClass_WHITESPACE);
+  }
+
+  /**
+   * Checks whether the given codepoint is an ASCII digit.
+   *
+   * @param codepoint The codepoint to check.
+   * @return Whether the given codepoint is an ASCII digit.
+   */
+  static bool is_digit(int32_t const codepoint) {
+    return is_char_class(codepoint, CharClass_DIGIT);
+  }
+
+  /**
+   * Checks whether the given codepoint is an ASCII letter or digit.
+   *
+   * @param codepoint The codepoint to check.
+   * @return Whether the given codepoint is an ASCII letter or digit.
+   */
+  static bool is_alphanumeric(int32_t const codepoint) {
+    return is_char_class(codepoint, CharClass_ALPHA | CharClass_DIGIT);
+  }
 
   /**
    * Advances the scanner while marking the codepoint as non-whitespace.
@@ -122,7 +215,7 @@
    * @return Whether the given codepoint could be used in an identifier.
    */
   static bool is_identifier_char(int32_t const codepoint) {
-    return iswalnum(codepoint) || ('_' == codepoint);
+    return is_char_class(codepoint, CharClass_ALPHA | CharClass_DIGIT | CharClass_UNDERSCORE);
   }
 
   /**
@@ -138,6 +231,46 @@
     }
   }
 
+  /**
+   * Skips codepoints as long as they are whitespace. If a line break is
+   * skipped the column of the following codepoint is implied by the
+   * whitespace after it, which saves calling get_column; that walks back
+   * to the start of the line, so is linear in the length of the line.
+   *
+   * @param lexer The tree-sitter lexing control structure.
+   * @return The column of the next codepoint, or -1 if no line break was
+   *         skipped and so the column is unknown.
+   */
+  static int64_t skip_whitespace(TSLexer* const lexer) {
+    int64_t col = -1;
+    while (is_whitespace(lexer->lookahead)) {
+      if ('\n' == lexer->lookahead) {
+        col = 0;
+      } else if (col >= 0) {
+        col++;
+      }
+
+      lexer->advance(lexer, true);
+    }
+
+    return col;
+  }
+
+  /**
+   * Gets the column of the next codepoint, saturating at COLUMN_INDEX_MAX.
+   * The column is only known for free right after a newline; otherwise
+   * get_column walks back to the start of the line, so a lexeme later on
+   * the same line of a jlist still costs O(line length).
+   *
+   * @param lexer The tree-sitter lexing control structure.
+   * @param skipped_col The column returned by skip_whitespace.
+   * @return The column of the next codepoint.
+   */
+  static column_index get_next_column(TSLexer* const lexer, int64_t const skipped_col) {
+    const uint32_t col = skipped_col < 0 ? lexer->get_column(lexer) : (uint32_t)skipped_col;
+    return col > COLUMN_INDEX_MAX ? COLUMN_INDEX_MAX : (column_index)col;
+  }
+
   /**
    * Checks whether the next codepoint sequence is the one given.
    * This function can change the state of the lexer.
@@ -163,9 +296,28 @@
     return true;
   }
 
+  /**
+   * Advances the lexer until the next codepoint is the one given or the
+   * end of the file is reached. Since the lookahead is zero at the end of
+   * the file, EOF only needs to be checked when a zero is encountered.
+   *
+   * @param lexer The tree-sitter lexing control structure.
+   * @param codepoint The codepoint to advance to.
+   */
+  static void advance_to_codepoint(TSLexer* const lexer, int32_t const codepoint) {
+    while (!is_next_codepoint(lexer, codepoint)) {
+      if (0 == lexer->lookahead && !has_next(lexer)) {
+        return;
+      }
+
+      advance(lexer);
+    }
+  }
+
   // Possible states for the extramodular text lexer to enter.
   enum EMTLexState {
     EMTLexState_CONSUME,
+    EMTLexState_SKIP_TO_DASH,
     EMTLexState_DASH,
     EMTLexState_SINGLE_LINE,
     EMTLexState_MODULE,
@@ -184,7 +336,10 @@
    * or EOF, which marks the end of the extramodular text. It is important
    * that the extramodular text does not itself include the captured module
    * start sequence, which is why this is in an external scanner rather
-   * than a regex in the grammar itself.
+   * than a regex in the grammar itself. Since the module start sequence
+   * must begin with a dash, once any text has been consumed the lexer
+   * skips directly to the next dash; this keeps large blocks of text
+   * (pasted model checker output, for example) out of the state machine.
    *
    * @param lexer The tree-sitter lexing control structure
    * @param valid_symbols Tokens possibly expected in this spot.
@@ -198,12 +353,17 @@
     switch (state) {
       case EMTLexState_CONSUME:
         if (eof) ADVANCE(EMTLexState_END_OF_FILE);
-        if (iswspace(lookahead) && !has_consumed_any) SKIP(EMTLexState_CONSUME);
-        if (iswspace(lookahead) && has_consumed_any) ADVANCE(EMTLexState_CONSUME);
-        lexer->mark_end(lexer);
-        if ('-' == lookahead) ADVANCE(EMTLexState_DASH);
+        if (is_whitespace(lookahead) && !has_consumed_any) SKIP(EMTLexState_CONSUME);
+        if ('-' == lookahead) {
+          lexer->mark_end(lexer);
+          ADVANCE(EMTLexState_DASH);
+        }
         has_consumed_any = true;
-        ADVANCE(EMTLexState_CONSUME);
+        ADVANCE(EMTLexState_SKIP_TO_DASH);
+        END_STATE();
+      case EMTLexState_SKIP_TO_DASH:
+        advance_to_codepoint(lexer, '-');
+        GO_TO_STATE(EMTLexState_CONSUME);
         END_STATE();
       case EMTLexState_DASH:
         if (is_next_codepoint_sequence(lexer, "---")) ADVANCE(EMTLexState_SINGLE_LINE);
@@ -254,38 +414,29 @@
     /**
      * Initializes a new instance of the ProofStepId class.
      *
-     * @param raw_level The unparsed contents of the <...> lexeme.
+     * @return A ProofStepId of type NONE.
      */
-    static struct ProofStepId parse_proof_step_id(const CharArray* raw_level) {
+    static struct ProofStepId create_proof_step_id() {
       struct ProofStepId id;
+      id.type = ProofStepIdType_NONE;
       id.level = -1;
-      if (0 == raw_level->size) {
-        id.type = ProofStepIdType_NONE;
-      } else if ('*' == *array_get(raw_level, 0)) {
-        id.type = ProofStepIdType_STAR;
-      } else if ('+' == *array_get(raw_level, 0)) {
-        id.type = ProofStepIdType_PLUS;
-      } else {
-        id.type = ProofStepIdType_NUMBERED;
-        id.level = 0;
-        int32_t multiplier = 1;
-        for (size_t i = 0; i < raw_level->size; i++) {
-          const size_t index = raw_level->size - i - 1;
-          const int8_t digit_value = *array_get(raw_level, index) - 48;
-          if (0 <= digit_value && digit_value <= 9) {
-            id.level += digit_value * multiplier;
-            multiplier *= 10;
-          } else {
-            id.type = ProofStepIdType_NONE;
-            id.level = -1;
-            break;
-          }
-        }
-      }
-      array_delete(raw_level);
       return id;
     }
 
+    /**
+     * Appends a digit to the level of a NUMBERED proof step ID as it is
+     * lexed. Levels too large to record saturate at PROOF_LEVEL_MAX.
+     *
+     * @param this The proof step ID being lexed.
+     * @param codepoint The digit codepoint to append.
+     */
+    static void proof_step_id_push_digit(struct ProofStepId* const this, int32_t const codepoint) {
+      const proof_level digit_value = (proof_level)(codepoint - '0');
+      this->level = this->level > (PROOF_LEVEL_MAX - digit_value) / 10
+        ? PROOF_LEVEL_MAX
+        : this->level * 10 + digit_value;
+    }
+
   // Lexemes recognized by this lexer.
   enum Lexeme {
     Lexeme_FORWARD_SLASH,
@@ -337,6 +488,118 @@
     Lexeme_END_OF_FILE
   };
 
+  // Length of the longest keyword recognized by the keyword lexer.
+#define MAX_KEYWORD_LENGTH 11
+
+  // Number of slots in the keyword hash table (must be a power of two).
+#define KEYWORD_TABLE_SIZE 32
+
+  /**
+   * Macro; hashes a keyword by its first, second, and last codepoints
+   * and its length. The hash is perfect on the keyword table, so each
+   * keyword has its own slot. When adding a keyword check the scanner
+   * benchmark's keywords mode still passes, and adjust the hash if not;
+   * GCC also reports colliding slots with -Woverride-init.
+   *
+   * @param first The first codepoint of the keyword.
+   * @param second The second codepoint of the keyword.
+   * @param last The last codepoint of the keyword.
+   * @param length The number of codepoints in the keyword.
+   */
+#define KEYWORD_HASH(first, second, last, length)                   \
+    (((unsigned)(first) + ((unsigned)(second) << 3)                   \
+      + ((unsigned)(last) << 1) + (unsigned)(length))                 \
+      & (KEYWORD_TABLE_SIZE - 1))
+
+  /**
+   * Macro; defines the keyword table entry for the given keyword, placed
+   * in its hash slot by the compiler.
+   *
+   * @param first The first codepoint of the keyword.
+   * @param second The second codepoint of the keyword.
+   * @param last The last codepoint of the keyword.
+   * @param text The keyword as a string literal.
+   * @param lexeme The lexeme of the keyword.
+   */
+#define KEYWORD(first, second, last, text, lexeme)                  \
+    [KEYWORD_HASH(first, second, last, sizeof(text) - 1)] =           \
+      { text, sizeof(text) - 1, lexeme }
+
+  // An entry in the keyword hash table; empty slots have length zero.
+  struct Keyword {
+    const char* text;
+    size_t length;
+    enum Lexeme lexeme;
+  };
+
+  // Keywords which are lexed as a whole identifier, keyed by hash.
+  static const struct Keyword keywords[KEYWORD_TABLE_SIZE] = {
+    KEYWORD('A', 'S', 'E', "ASSUME", Lexeme_ASSUME_KEYWORD),
+    KEYWORD('A', 'S', 'N', "ASSUMPTION", Lexeme_ASSUMPTION_KEYWORD),
+    KEYWORD('A', 'X', 'M', "AXIOM", Lexeme_AXIOM_KEYWORD),
+    KEYWORD('B', 'Y', 'Y', "BY", Lexeme_BY_KEYWORD),
+    KEYWORD('C', 'O', 'T', "CONSTANT", Lexeme_CONSTANT_KEYWORD),
+    KEYWORD('C', 'O', 'S', "CONSTANTS", Lexeme_CONSTANTS_KEYWORD),
+    KEYWORD('C', 'O', 'Y', "COROLLARY", Lexeme_COROLLARY_KEYWORD),
+    KEYWORD('E', 'L', 'E', "ELSE", Lexeme_ELSE_KEYWORD),
+    KEYWORD('I', 'N', 'N', "IN", Lexeme_IN_KEYWORD),
+    KEYWORD('L', 'E', 'A', "LEMMA", Lexeme_LEMMA_KEYWORD),
+    KEYWORD('L', 'O', 'L', "LOCAL", Lexeme_LOCAL_KEYWORD),
+    KEYWORD('O', 'B', 'S', "OBVIOUS", Lexeme_OBVIOUS_KEYWORD),
+    KEYWORD('O', 'M', 'D', "OMITTED", Lexeme_OMITTED_KEYWORD),
+    KEYWORD('P', 'R', 'F', "PROOF", Lexeme_PROOF_KEYWORD),
+    KEYWORD('P', 'R', 'N', "PROPOSITION", Lexeme_PROPOSITION_KEYWORD),
+    KEYWORD('Q', 'E', 'D', "QED", Lexeme_QED_KEYWORD),
+    KEYWORD('T', 'H', 'N', "THEN", Lexeme_THEN_KEYWORD),
+    KEYWORD('T', 'H', 'M', "THEOREM", Lexeme_THEOREM_KEYWORD),
+    KEYWORD('V', 'A', 'E', "VARIABLE", Lexeme_VARIABLE_KEYWORD),
+    KEYWORD('V', 'A', 'S', "VARIABLES", Lexeme_VARIABLES_KEYWORD)
+  };
+
+  /**
+   * Lexes an identifier starting with a capital ASCII letter and checks
+   * whether it is a keyword. Keywords are all capitals, so the identifier
+   * is only read as long as its codepoints could be part of a keyword,
+   * then looked up in the keyword hash table. WF_ and SF_ are prefixes
+   * of the identifiers they are part of, so are checked separately. The
+   * lexer is left at the end of any keyword found.
+   *
+   * @param lexer The tree-sitter lexing control structure.
+   * @return The keyword lexeme encountered, or Lexeme_IDENTIFIER.
+   */
+  static enum Lexeme lex_keyword(TSLexer* const lexer) {
+    char text[MAX_KEYWORD_LENGTH];
+    size_t length = 0;
+    while ('A' <= lexer->lookahead && lexer->lookahead <= 'Z') {
+      if (MAX_KEYWORD_LENGTH == length) {
+        return Lexeme_IDENTIFIER;
+      }
+
+      text[length++] = (char)lexer->lookahead;
+      advance(lexer);
+    }
+
+    if (2 == length && 'F' == text[1] && '_' == lexer->lookahead) {
+      if ('W' == text[0]) {
+        advance(lexer);
+        return Lexeme_WEAK_FAIRNESS;
+      } else if ('S' == text[0]) {
+        advance(lexer);
+        return Lexeme_STRONG_FAIRNESS;
+      }
+    }
+
+    if (length < 2 || is_identifier_char(lexer->lookahead)) {
+      return Lexeme_IDENTIFIER;
+    }
+
+    const struct Keyword* const keyword =
+      &keywords[KEYWORD_HASH(text[0], text[1], text[length - 1], length)];
+    return keyword->length == length && 0 == memcmp(keyword->text, text, length)
+      ? keyword->lexeme
+      : Lexeme_IDENTIFIER;
+  }
+
   // Possible states for the lexer to enter.
   enum LexState {
     LexState_CONSUME_LEADING_SPACE,
@@ -356,7 +619,6 @@
     LexState_R_SQUARE_BRACKET,
     LexState_R_CURLY_BRACE,
     LexState_R_ANGLE_BRACKET,
-    LexState_S, LexState_SF_,
     LexState_RIGHT_ARROW,
     LexState_RIGHT_MAP_ARROW,
     LexState_COMMENT_START,
@@ -365,19 +627,7 @@
     LexState_DOUBLE_LINE,
     LexState_PIPE,
     LexState_RIGHT_TURNSTILE,
-    LexState_A, LexState_ASSUM, LexState_ASSUME, LexState_ASSUMPTION, LexState_AX, LexState_AXIOM,
-    LexState_B, LexState_BY,
-    LexState_C, LexState_CO, LexState_CON, LexState_COR, LexState_CONSTANT, LexState_CONSTANTS, LexState_COROLLARY,
-    LexState_E, LexState_ELSE,
-    LexState_I, LexState_IN,
-    LexState_L, LexState_LE, LexState_LEMMA, LexState_LO, LexState_LOCAL,
-    LexState_O, LexState_OB, LexState_OBVIOUS, LexState_OM, LexState_OMITTED,
-    LexState_P, LexState_PRO, LexState_PROO, LexState_PROOF, LexState_PROP, LexState_PROPOSITION,
-    LexState_Q, LexState_QED,
-    LexState_T, LexState_THE, LexState_THEN, LexState_THEOREM,
-    LexState_V, LexState_VARIABLE, LexState_VARIABLES,
-    LexState_W, LexState_WF_,
-    LexState_IDENTIFIER,
+    LexState_KEYWORD,
     LexState_PROOF_LEVEL_NUMBER,
     LexState_PROOF_LEVEL_STAR,
     LexState_PROOF_LEVEL_PLUS,
@@ -389,18 +639,17 @@
 
   /**
    * Looks ahead to identify the next lexeme. Consumes all leading
-   * whitespace. Out parameters include column of first non-whitespace
-   * codepoint and the level of the proof step ID lexeme if encountered.
+   * whitespace. The out parameter holds the type & level of the proof
+   * step ID lexeme if encountered; the level is computed while lexing so
+   * this function never allocates.
    *
    * @param lexer The tree-sitter lexing control structure.
-   * @param lexeme_start_col The starting column of the first lexeme.
-   * @param proof_step_id_level The level of the proof step ID.
+   * @param proof_step_id The type & level of the proof step ID.
    * @return The lexeme encountered.
    */
   static enum Lexeme lex_lookahead(
     TSLexer* const lexer,
-    column_index* lexeme_start_col,
-    CharArray* proof_step_id_level
+    struct ProofStepId* proof_step_id
   ) {
     enum LexState state = LexState_CONSUME_LEADING_SPACE;
     enum Lexeme result_lexeme = Lexeme_OTHER;
@@ -408,8 +657,7 @@
     eof = !has_next(lexer);
     switch (state) {
       case LexState_CONSUME_LEADING_SPACE:
-        if (iswspace(lookahead)) SKIP(LexState_CONSUME_LEADING_SPACE);
-        *lexeme_start_col = lexer->get_column(lexer);
+        if (is_whitespace(lookahead)) SKIP(LexState_CONSUME_LEADING_SPACE);
         lexer->mark_end(lexer);
         if (eof) ADVANCE(LexState_END_OF_FILE);
         if ('/' == lookahead) ADVANCE(LexState_FORWARD_SLASH);
@@ -426,19 +674,7 @@
         if (']' == lookahead) ADVANCE(LexState_R_SQUARE_BRACKET);
         if ('}' == lookahead) ADVANCE(LexState_R_CURLY_BRACE);
         if ('|' == lookahead) ADVANCE(LexState_PIPE);
-        if ('A' == lookahead) ADVANCE(LexState_A);
-        if ('B' == lookahead) ADVANCE(LexState_B);
-        if ('C' == lookahead) ADVANCE(LexState_C);
-        if ('E' == lookahead) ADVANCE(LexState_E);
-        if ('I' == lookahead) ADVANCE(LexState_I);
-        if ('L' == lookahead) ADVANCE(LexState_L);
-        if ('O' == lookahead) ADVANCE(LexState_O);
-        if ('P' == lookahead) ADVANCE(LexState_P);
-        if ('Q' == lookahead) ADVANCE(LexState_Q);
-        if ('S' == lookahead) ADVANCE(LexState_S);
-        if ('T' == lookahead) ADVANCE(LexState_T);
-        if ('V' == lookahead) ADVANCE(LexState_V);
-        if ('W' == lookahead) ADVANCE(LexState_W);
+        if ('A' <= lookahead && lookahead <= 'Z') GO_TO_STATE(LexState_KEYWORD);
         if (L'\u2227' == lookahead) ADVANCE(LexState_LAND); // '∧'
         if (L'\u2228' == lookahead) ADVANCE(LexState_LOR); // '∨'
         if (L'\u3009' == lookahead) ADVANCE(LexState_R_ANGLE_BRACKET); // '〉'
@@ -459,10 +695,20 @@
         if ('*' == lookahead) ADVANCE(LexState_COMMENT_START);
         END_LEX_STATE();
       case LexState_LT:
-        array_push(proof_step_id_level, (char)(lookahead & CHAR_MAX));
-        if (iswdigit(lookahead)) ADVANCE(LexState_PROOF_LEVEL_NUMBER);
-        if ('*' == lookahead) ADVANCE(LexState_PROOF_LEVEL_STAR);
-        if ('+' == lookahead) ADVANCE(LexState_PROOF_LEVEL_PLUS);
+        if (is_digit(lookahead)) {
+          proof_step_id->type = ProofStepIdType_NUMBERED;
+          proof_step_id->level = 0;
+          proof_step_id_push_digit(proof_step_id, lookahead);
+          ADVANCE(LexState_PROOF_LEVEL_NUMBER);
+        }
+        if ('*' == lookahead) {
+          proof_step_id->type = ProofStepIdType_STAR;
+          ADVANCE(LexState_PROOF_LEVEL_STAR);
+        }
+        if ('+' == lookahead) {
+          proof_step_id->type = ProofStepIdType_PLUS;
+          ADVANCE(LexState_PROOF_LEVEL_PLUS);
+        }
         ADVANCE(LexState_OTHER);
         END_LEX_STATE();
       case LexState_GT:
@@ -536,208 +782,12 @@
       case LexState_RIGHT_TURNSTILE:
         if ('>' == lookahead) ADVANCE(LexState_RIGHT_MAP_ARROW);
         END_LEX_STATE();
-      case LexState_A:
-        ACCEPT_LEXEME(Lexeme_IDENTIFIER);
-        if ('X' == lookahead) ADVANCE(LexState_AX);
-        if (is_next_codepoint_sequence(lexer, "SSUM")) ADVANCE(LexState_ASSUM);
-        END_LEX_STATE();
-      case LexState_ASSUM:
-        ACCEPT_LEXEME(Lexeme_IDENTIFIER);
-        if ('E' == lookahead) ADVANCE(LexState_ASSUME);
-        if (is_next_codepoint_sequence(lexer, "PTION")) ADVANCE(LexState_ASSUMPTION);
-        END_LEX_STATE();
-      case LexState_ASSUME:
-        ACCEPT_LEXEME(Lexeme_ASSUME_KEYWORD);
-        if (is_identifier_char(lookahead)) ADVANCE(LexState_IDENTIFIER);
-        END_LEX_STATE();
-      case LexState_ASSUMPTION:
-        ACCEPT_LEXEME(Lexeme_ASSUMPTION_KEYWORD);
-        if (is_identifier_char(lookahead)) ADVANCE(LexState_IDENTIFIER);
-        END_LEX_STATE();
-      case LexState_AX:
-        ACCEPT_LEXEME(Lexeme_IDENTIFIER);
-        if (is_next_codepoint_sequence(lexer, "IOM")) ADVANCE(LexState_AXIOM);
-        END_LEX_STATE();
-      case LexState_AXIOM:
-        ACCEPT_LEXEME(Lexeme_AXIOM_KEYWORD);
-        if (is_identifier_char(lookahead)) ADVANCE(LexState_IDENTIFIER);
-        END_LEX_STATE();
-      case LexState_B:
-        ACCEPT_LEXEME(Lexeme_IDENTIFIER);
-        if ('Y' == lookahead) ADVANCE(LexState_BY);
-        END_LEX_STATE();
-      case LexState_BY:
-        ACCEPT_LEXEME(Lexeme_BY_KEYWORD);
-        if (is_identifier_char(lookahead)) ADVANCE(LexState_IDENTIFIER);
-        END_LEX_STATE();
-      case LexState_C:
-        ACCEPT_LEXEME(Lexeme_IDENTIFIER);
-        if ('O' == lookahead) ADVANCE(LexState_CO);
-        END_LEX_STATE();
-      case LexState_CO:
-        ACCEPT_LEXEME(Lexeme_IDENTIFIER);
-        if ('N' == lookahead) ADVANCE(LexState_CON);
-        if ('R' == lookahead) ADVANCE(LexState_COR);
-        END_LEX_STATE();
-      case LexState_CON:
-        ACCEPT_LEXEME(Lexeme_IDENTIFIER);
-        if (is_next_codepoint_sequence(lexer, "STANT")) ADVANCE(LexState_CONSTANT);
-        END_LEX_STATE();
-      case LexState_CONSTANT:
-        ACCEPT_LEXEME(Lexeme_CONSTANT_KEYWORD);
-        if ('S' == lookahead) ADVANCE(LexState_CONSTANTS);
-        if (is_identifier_char(lookahead)) ADVANCE(LexState_IDENTIFIER);
-        END_LEX_STATE();
-      case LexState_CONSTANTS:
-        ACCEPT_LEXEME(Lexeme_CONSTANTS_KEYWORD);
-        if (is_identifier_char(lookahead)) ADVANCE(LexState_IDENTIFIER);
-        END_LEX_STATE();
-      case LexState_COR:
-        ACCEPT_LEXEME(Lexeme_IDENTIFIER);
-        if (is_next_codepoint_sequence(lexer, "OLLARY")) ADVANCE(LexState_COROLLARY);
-        END_LEX_STATE();
-      case LexState_COROLLARY:
-        ACCEPT_LEXEME(Lexeme_COROLLARY_KEYWORD);
-        if (is_identifier_char(lookahead)) ADVANCE(LexState_IDENTIFIER);
-        END_LEX_STATE();
-      case LexState_E:
-        ACCEPT_LEXEME(Lexeme_IDENTIFIER);
-        if (is_next_codepoint_sequence(lexer, "LSE")) ADVANCE(LexState_ELSE);
-        END_LEX_STATE();
-      case LexState_ELSE:
-        ACCEPT_LEXEME(Lexeme_ELSE_KEYWORD);
-        if (is_identifier_char(lookahead)) ADVANCE(LexState_IDENTIFIER);
-        END_LEX_STATE();
-      case LexState_I:
-        ACCEPT_LEXEME(Lexeme_IDENTIFIER);
-        if ('N' == lookahead) ADVANCE(LexState_IN);
-        END_LEX_STATE();
-      case LexState_IN:
-        ACCEPT_LEXEME(Lexeme_IN_KEYWORD);
-        if (is_identifier_char(lookahead)) ADVANCE(LexState_IDENTIFIER);
-        END_LEX_STATE();
-      case LexState_L:
-        ACCEPT_LEXEME(Lexeme_IDENTIFIER);
-        if ('E' == lookahead) ADVANCE(LexState_LE);
-        if ('O' == lookahead) ADVANCE(LexState_LO);
-        END_LEX_STATE();
-      case LexState_LE:
-        ACCEPT_LEXEME(Lexeme_IDENTIFIER);
-        if (is_next_codepoint_sequence(lexer, "MMA")) ADVANCE(LexState_LEMMA);
-        END_LEX_STATE();
-      case LexState_LEMMA:
-        ACCEPT_LEXEME(Lexeme_LEMMA_KEYWORD);
-        if (is_identifier_char(lookahead)) ADVANCE(LexState_IDENTIFIER);
-        END_LEX_STATE();
-      case LexState_LO:
-        ACCEPT_LEXEME(Lexeme_IDENTIFIER);
-        if (is_next_codepoint_sequence(lexer, "CAL")) ADVANCE(LexState_LOCAL);
-        END_LEX_STATE();
-      case LexState_LOCAL:
-        ACCEPT_LEXEME(Lexeme_LOCAL_KEYWORD);
-        if (is_identifier_char(lookahead)) ADVANCE(LexState_IDENTIFIER);
-        END_LEX_STATE();
-      case LexState_O:
-        ACCEPT_LEXEME(Lexeme_IDENTIFIER);
-        if ('B' == lookahead) ADVANCE(LexState_OB);
-        if ('M' == lookahead) ADVANCE(LexState_OM);
-        END_LEX_STATE();
-      case LexState_OB:
-        ACCEPT_LEXEME(Lexeme_IDENTIFIER);
-        if (is_next_codepoint_sequence(lexer, "VIOUS")) ADVANCE(LexState_OBVIOUS);
-        END_LEX_STATE();
-      case LexState_OBVIOUS:
-        ACCEPT_LEXEME(Lexeme_OBVIOUS_KEYWORD);
-        if (is_identifier_char(lookahead)) ADVANCE(LexState_IDENTIFIER);
-        END_LEX_STATE();
-      case LexState_OM:
-        ACCEPT_LEXEME(Lexeme_IDENTIFIER);
-        if (is_next_codepoint_sequence(lexer, "ITTED")) ADVANCE(LexState_OMITTED);
-        END_LEX_STATE();
-      case LexState_OMITTED:
-        ACCEPT_LEXEME(Lexeme_OMITTED_KEYWORD);
-        if (is_identifier_char(lookahead)) ADVANCE(LexState_IDENTIFIER);
-        END_LEX_STATE();
-      case LexState_P:
-        ACCEPT_LEXEME(Lexeme_IDENTIFIER);
-        if (is_next_codepoint_sequence(lexer, "RO")) ADVANCE(LexState_PRO);
-        END_LEX_STATE();
-      case LexState_PRO:
-        ACCEPT_LEXEME(Lexeme_IDENTIFIER);
-        if ('O' == lookahead) ADVANCE(LexState_PROO);
-        if ('P' == lookahead) ADVANCE(LexState_PROP);
-        END_LEX_STATE();
-      case LexState_PROO:
-        ACCEPT_LEXEME(Lexeme_IDENTIFIER);
-        if ('F' == lookahead) ADVANCE(LexState_PROOF);
-        END_LEX_STATE();
-      case LexState_PROOF:
-        ACCEPT_LEXEME(Lexeme_PROOF_KEYWORD);
-        if (is_identifier_char(lookahead)) ADVANCE(LexState_IDENTIFIER);
-        END_LEX_STATE();
-      case LexState_PROP:
-        ACCEPT_LEXEME(Lexeme_IDENTIFIER);
-        if (is_next_codepoint_sequence(lexer, "OSITION")) ADVANCE(LexState_PROPOSITION);
-        END_LEX_STATE();
-      case LexState_PROPOSITION:
-        ACCEPT_LEXEME(Lexeme_PROPOSITION_KEYWORD);
-        if (is_identifier_char(lookahead)) ADVANCE(LexState_IDENTIFIER);
-        END_LEX_STATE();
-      case LexState_Q:
-        ACCEPT_LEXEME(Lexeme_IDENTIFIER);
-        if (is_next_codepoint_sequence(lexer, "ED")) ADVANCE(LexState_QED);
-        END_LEX_STATE();
-      case LexState_QED:
-        ACCEPT_LEXEME(Lexeme_QED_KEYWORD);
-        if (is_identifier_char(lookahead)) ADVANCE(LexState_IDENTIFIER);
-        END_LEX_STATE();
-      case LexState_S:
-        ACCEPT_LEXEME(Lexeme_IDENTIFIER);
-        if (is_next_codepoint_sequence(lexer, "F_")) ADVANCE(LexState_SF_);
-        END_LEX_STATE();
-      case LexState_SF_:
-        ACCEPT_LEXEME(Lexeme_STRONG_FAIRNESS);
-        END_LEX_STATE();
-      case LexState_T:
-        ACCEPT_LEXEME(Lexeme_IDENTIFIER);
-        if (is_next_codepoint_sequence(lexer, "HE")) ADVANCE(LexState_THE);
-        END_LEX_STATE();
-      case LexState_THE:
-        ACCEPT_LEXEME(Lexeme_IDENTIFIER);
-        if ('N' == lookahead) ADVANCE(LexState_THEN);
-        if (is_next_codepoint_sequence(lexer, "OREM")) ADVANCE(LexState_THEOREM);
-        END_LEX_STATE();
-      case LexState_THEN:
-        ACCEPT_LEXEME(Lexeme_THEN_KEYWORD);
-        if (is_identifier_char(lookahead)) ADVANCE(LexState_IDENTIFIER);
-        END_LEX_STATE();
-      case LexState_THEOREM:
-        ACCEPT_LEXEME(Lexeme_THEOREM_KEYWORD);
-        if (is_identifier_char(lookahead)) ADVANCE(LexState_IDENTIFIER);
-        END_LEX_STATE();
-      case LexState_V:
-        ACCEPT_LEXEME(Lexeme_IDENTIFIER);
-        if (is_next_codepoint_sequence(lexer, "ARIABLE")) ADVANCE(LexState_VARIABLE);
-        END_LEX_STATE();
-      case LexState_VARIABLE:
-        ACCEPT_LEXEME(Lexeme_VARIABLE_KEYWORD);
-        if ('S' == lookahead) ADVANCE(LexState_VARIABLES);
-        if (is_identifier_char(lookahead)) ADVANCE(LexState_IDENTIFIER);
-        END_LEX_STATE();
-      case LexState_VARIABLES:
-        ACCEPT_LEXEME(Lexeme_VARIABLES_KEYWORD);
-        if (is_identifier_char(lookahead)) ADVANCE(LexState_IDENTIFIER);
-        END_LEX_STATE();
-      case LexState_W:
-        ACCEPT_LEXEME(Lexeme_IDENTIFIER);
-        if (is_next_codepoint_sequence(lexer, "F_")) ADVANCE(LexState_WF_);
-        END_LEX_STATE();
-      case LexState_WF_:
-        ACCEPT_LEXEME(Lexeme_WEAK_FAIRNESS);
+      case LexState_KEYWORD:
+        ACCEPT_LEXEME(lex_keyword(lexer));
         END_LEX_STATE();
       case LexState_PROOF_LEVEL_NUMBER:
-        if (iswdigit(lookahead)) {
-          array_push(proof_step_id_level, (char)(lookahead & CHAR_MAX));
+        if (is_digit(lookahead)) {
+          proof_step_id_push_digit(proof_step_id, lookahead);
           ADVANCE(LexState_PROOF_LEVEL_NUMBER);
         }
         if ('>' == lookahead) ADVANCE(LexState_PROOF_NAME);
@@ -753,16 +803,13 @@
         END_LEX_STATE();
       case LexState_PROOF_NAME:
         ACCEPT_LEXEME(Lexeme_PROOF_STEP_ID);
-        if (iswalnum(lookahead)) ADVANCE(LexState_PROOF_NAME);
+        if (is_alphanumeric(lookahead)) ADVANCE(LexState_PROOF_NAME);
         if ('.' == lookahead) ADVANCE(LexState_PROOF_ID);
         END_LEX_STATE();
       case LexState_PROOF_ID:
         ACCEPT_LEXEME(Lexeme_PROOF_STEP_ID);
         if ('.' == lookahead) ADVANCE(LexState_PROOF_ID);
         END_LEX_STATE();
-      case LexState_IDENTIFIER:
-        ACCEPT_LEXEME(Lexeme_IDENTIFIER);
-        END_LEX_STATE();
       case LexState_OTHER:
         ACCEPT_LEXEME(Lexeme_OTHER);
         END_LEX_STATE();
@@ -794,62 +841,626 @@
   };
 
   /**
-   * Maps the given lexeme to a token.
+   * Maps the given lexeme to a token.
+   *
+   * @param lexeme The lexeme to map to a token.
+   * @return The token corresponding to the given lexeme.
+   */
+  static enum Token tokenize_lexeme(enum Lexeme lexeme) {
+    switch (lexeme) {
+      case Lexeme_FORWARD_SLASH: return Token_OTHER;
+      case Lexeme_BACKWARD_SLASH: return Token_OTHER;
+      case Lexeme_GT: return Token_OTHER;
+      case Lexeme_EQ: return Token_OTHER;
+      case Lexeme_DASH: return Token_OTHER;
+      case Lexeme_COMMA: return Token_RIGHT_DELIMITER;
+      case Lexeme_COLON: return Token_RIGHT_DELIMITER;
+      case Lexeme_SEMICOLON: return Token_TERMINATOR;
+      case Lexeme_LAND: return Token_LAND;
+      case Lexeme_LOR: return Token_LOR;
+      case Lexeme_L_PAREN: return Token_OTHER;
+      case Lexeme_R_PAREN: return Token_RIGHT_DELIMITER;
+      case Lexeme_R_SQUARE_BRACKET: return Token_RIGHT_DELIMITER;
+      case Lexeme_R_CURLY_BRACE: return Token_RIGHT_DELIMITER;
+      case Lexeme_R_ANGLE_BRACKET: return Token_RIGHT_DELIMITER;
+      case Lexeme_RIGHT_ARROW: return Token_RIGHT_DELIMITER;
+      case Lexeme_RIGHT_MAP_ARROW: return Token_RIGHT_DELIMITER;
+      case Lexeme_COMMENT_START: return Token_COMMENT_START;
+      case Lexeme_BLOCK_COMMENT_START: return Token_COMMENT_START;
+      case Lexeme_SINGLE_LINE: return Token_TERMINATOR;
+      case Lexeme_DOUBLE_LINE: return Token_TERMINATOR;
+      case Lexeme_ASSUME_KEYWORD: return Token_TERMINATOR;
+      case Lexeme_ASSUMPTION_KEYWORD: return Token_TERMINATOR;
+      case Lexeme_AXIOM_KEYWORD: return Token_TERMINATOR;
+      case Lexeme_BY_KEYWORD: return Token_BY_KEYWORD;
+      case Lexeme_CONSTANT_KEYWORD: return Token_TERMINATOR;
+      case Lexeme_CONSTANTS_KEYWORD: return Token_TERMINATOR;
+      case Lexeme_COROLLARY_KEYWORD: return Token_TERMINATOR;
+      case Lexeme_ELSE_KEYWORD: return Token_RIGHT_DELIMITER;
+      case Lexeme_IN_KEYWORD: return Token_RIGHT_DELIMITER;
+      case Lexeme_LEMMA_KEYWORD: return Token_TERMINATOR;
+      case Lexeme_LOCAL_KEYWORD: return Token_TERMINATOR;
+      case Lexeme_OBVIOUS_KEYWORD: return Token_OBVIOUS_KEYWORD;
+      case Lexeme_OMITTED_KEYWORD: return Token_OMITTED_KEYWORD;
+      case Lexeme_PROOF_KEYWORD: return Token_PROOF_KEYWORD;
+      case Lexeme_PROPOSITION_KEYWORD: return Token_TERMINATOR;
+      case Lexeme_THEN_KEYWORD: return Token_RIGHT_DELIMITER;
+      case Lexeme_THEOREM_KEYWORD: return Token_TERMINATOR;
+      case Lexeme_VARIABLE_KEYWORD: return Token_TERMINATOR;
+      case Lexeme_VARIABLES_KEYWORD: return Token_TERMINATOR;
+      case Lexeme_PROOF_STEP_ID: return Token_PROOF_STEP_ID;
+      case Lexeme_QED_KEYWORD: return Token_QED_KEYWORD;
+      case Lexeme_STRONG_FAIRNESS: return Token_STRONG_FAIRNESS;
+      case Lexeme_WEAK_FAIRNESS: return Token_WEAK_FAIRNESS;
+      case Lexeme_IDENTIFIER: return Token_OTHER;
+      case Lexeme_OTHER: return Token_OTHER;
+      case Lexeme_END_OF_FILE: return Token_TERMINATOR;
+      default: return Token_OTHER;
+    }
+  }
+
+  // Instrumentation counters, collected only if TLAPLUS_SCANNER_STATS is
+  // defined and read through the tree_sitter_tlaplus_scanner_stat_* API.
+  enum ScannerStat {
+    ScannerStat_SCAN_CALLS,             // Calls to the external scanner.
+    ScannerStat_TOKENS_EMITTED,         // Calls which emitted a token.
+    ScannerStat_EXTRAMODULAR_TEXT_SCANS,// Calls scanning extramodular text.
+    ScannerStat_LOOKAHEAD_SKIPS,        // Calls not needing lex_lookahead.
+    ScannerStat_GET_COLUMN_CALLS,       // Columns found with get_column.
+    ScannerStat_TRACKED_COLUMNS,        // Columns found skipping a newline.
+    ScannerStat_LEXED_TOKEN,            // First of the per-Token counts.
+    ScannerStat_LOOKAHEAD_CODEPOINTS = ScannerStat_LEXED_TOKEN + Token_OTHER + 1,
+    ScannerStat_SERIALIZE_CALLS,        // Calls to serialize.
+    ScannerStat_SERIALIZED_BYTES,       // Total bytes serialized.
+    ScannerStat_DESERIALIZE_CALLS,      // Calls to deserialize.
+    ScannerStat_DESERIALIZED_BYTES,     // Total bytes deserialized.
+    ScannerStat_DESERIALIZE_SKIPS,      // Deserializes of the current state.
+    ScannerStat_MAX_JLIST_DEPTH,        // Deepest jlist nesting seen.
+    ScannerStat_MAX_PROOF_DEPTH,        // Deepest proof nesting seen.
+    ScannerStat_MAX_CONTEXT_DEPTH,      // Deepest PlusCal nesting seen.
+    ScannerStat_COUNT
+  };
+
+#ifdef TLAPLUS_SCANNER_STATS
+  // Names of each counter, in ScannerStat order.
+  static const char* const scanner_stat_names[ScannerStat_COUNT] = {
+    "scan_calls",
+    "tokens_emitted",
+    "extramodular_text_scans",
+    "lookahead_skips",
+    "get_column_calls",
+    "tracked_columns",
+    "lexed_land",
+    "lexed_lor",
+    "lexed_right_delimiter",
+    "lexed_comment_start",
+    "lexed_terminator",
+    "lexed_proof_step_id",
+    "lexed_proof_keyword",
+    "lexed_by_keyword",
+    "lexed_obvious_keyword",
+    "lexed_omitted_keyword",
+    "lexed_qed_keyword",
+    "lexed_weak_fairness",
+    "lexed_strong_fairness",
+    "lexed_other",
+    "lookahead_codepoints",
+    "serialize_calls",
+    "serialized_bytes",
+    "deserialize_calls",
+    "deserialized_bytes",
+    "deserialize_skips",
+    "max_jlist_depth",
+    "max_proof_depth",
+    "max_context_depth"
+  };
+
+  // Counters are per-thread, so each covers the parsers used on a thread.
+  static SCANNER_THREAD_LOCAL uint64_t scanner_stats[ScannerStat_COUNT];
+
+  /**
+   * Adds the given amount to a counter.
+   *
+   * @param stat The counter to add to.
+   * @param amount The amount to add.
+   */
+  static void scanner_stats_add(enum ScannerStat const stat, uint64_t const amount) {
+    scanner_stats[stat] += amount;
+  }
+
+  /**
+   * Raises a counter to the given value if it is larger.
+   *
+   * @param stat The counter to raise.
+   * @param value The value to raise the counter to.
+   */
+  static void scanner_stats_max(enum ScannerStat const stat, uint64_t const value) {
+    if (value > scanner_stats[stat]) scanner_stats[stat] = value;
+  }
+
+  // Lexer forwarding to the tree-sitter lexer to count lookahead.
+  struct CountingLexer {
+    // The lexer interface presented to the scanner.
+    TSLexer base;
+
+    // The tree-sitter lexer being forwarded to.
+    TSLexer* inner;
+  };
+
+    static void counting_lexer_advance(TSLexer* const lexer, bool const skip) {
+      struct CountingLexer* const this = (struct CountingLexer*)(lexer);
+      this->inner->advance(this->inner, skip);
+      this->base.lookahead = this->inner->lookahead;
+      scanner_stats_add(ScannerStat_LOOKAHEAD_CODEPOINTS, 1);
+    }
+
+    static void counting_lexer_mark_end(TSLexer* const lexer) {
+      struct CountingLexer* const this = (struct CountingLexer*)(lexer);
+      this->inner->mark_end(this->inner);
+    }
+
+    static uint32_t counting_lexer_get_column(TSLexer* const lexer) {
+      struct CountingLexer* const this = (struct CountingLexer*)(lexer);
+      return this->inner->get_column(this->inner);
+    }
+
+    static bool counting_lexer_is_at_included_range_start(const TSLexer* const lexer) {
+      const struct CountingLexer* const this = (const struct CountingLexer*)(lexer);
+      return this->inner->is_at_included_range_start(this->inner);
+    }
+
+    static bool counting_lexer_eof(const TSLexer* const lexer) {
+      const struct CountingLexer* const this = (const struct CountingLexer*)(lexer);
+      return this->inner->eof(this->inner);
+    }
+
+    /**
+     * Initializes a new instance of the CountingLexer class.
+     *
+     * @param inner The tree-sitter lexer to forward to.
+     * @return A CountingLexer forwarding to the given lexer.
+     */
+    static struct CountingLexer create_counting_lexer(TSLexer* const inner) {
+      struct CountingLexer lexer;
+      lexer.base.lookahead = inner->lookahead;
+      lexer.base.result_symbol = inner->result_symbol;
+      lexer.base.advance = counting_lexer_advance;
+      lexer.base.mark_end = counting_lexer_mark_end;
+      lexer.base.get_column = counting_lexer_get_column;
+      lexer.base.is_at_included_range_start = counting_lexer_is_at_included_range_start;
+      lexer.base.eof = counting_lexer_eof;
+      lexer.inner = inner;
+      return lexer;
+    }
+#endif
+
+  // Version tag written at the start of every serialized NestedScanner.
+  // Bump this whenever the layout below changes.
+  #define SERIALIZATION_FORMAT_VERSION 1
+
+  // Bytes of the serialization buffer left free whenever a token nests the
+  // state deeper. Tokens that do not nest it only change the last proof
+  // level of the current context, whose varint grows by at most four bytes.
+  #define SERIALIZATION_HEADROOM 4
+
+  /**
+   * A cursor writing compact serialized state into a bounded buffer.
+   * Integers are written as LEB128 varints: seven bits per byte, with
+   * the high bit set on all bytes but the last. Writing past capacity
+   * sets the overflowed flag instead of touching memory.
+   */
+  struct SerializationWriter {
+
+    // The buffer being written into.
+    char* buffer;
+
+    // The number of bytes written so far.
+    unsigned offset;
+
+    // The size of the buffer.
+    unsigned capacity;
+
+    // Whether a write was dropped for lack of space.
+    bool overflowed;
+  };
+
+    /**
+     * Initializes a new writer over the given buffer.
+     *
+     * @param buffer The buffer to write into.
+     * @param capacity The size of the buffer.
+     * @return A writer positioned at the start of the buffer.
+     */
+    static struct SerializationWriter create_writer(char* const buffer, unsigned const capacity) {
+      struct SerializationWriter writer;
+      writer.buffer = buffer;
+      writer.offset = 0;
+      writer.capacity = capacity;
+      writer.overflowed = false;
+      return writer;
+    }
+
+    /**
+     * Writes a single byte.
+     *
+     * @param this The writer.
+     * @param value The byte to write.
+     */
+    static void write_byte(struct SerializationWriter* const this, uint8_t const value) {
+      if (this->offset < this->capacity) {
+        this->buffer[this->offset++] = (char)value;
+      } else {
+        this->overflowed = true;
+      }
+    }
+
+    /**
+     * Writes an unsigned integer as a varint.
+     *
+     * @param this The writer.
+     * @param value The value to write.
+     */
+    static void write_varint(struct SerializationWriter* const this, uint32_t value) {
+      if (this->capacity - this->offset >= 5) {
+        // Fast path; a 32-bit varint is at most five bytes
+        while (value >= 0x80) {
+          this->buffer[this->offset++] = (char)(value | 0x80);
+          value >>= 7;
+        }
+        this->buffer[this->offset++] = (char)value;
+        return;
+      }
+
+      while (value >= 0x80) {
+        write_byte(this, (uint8_t)(value | 0x80));
+        value >>= 7;
+      }
+      write_byte(this, (uint8_t)value);
+    }
+
+  /**
+   * A cursor reading compact serialized state from a bounded buffer.
+   * Reading past the end sets the malformed flag and yields zeroes.
+   */
+  struct SerializationReader {
+
+    // The buffer being read from.
+    const char* buffer;
+
+    // The number of bytes read so far.
+    unsigned offset;
+
+    // The size of the buffer.
+    unsigned length;
+
+    // Whether the buffer ended early or held an invalid value.
+    bool malformed;
+  };
+
+    /**
+     * Initializes a new reader over the given buffer.
+     *
+     * @param buffer The buffer to read from.
+     * @param length The size of the buffer.
+     * @return A reader positioned at the start of the buffer.
+     */
+    static struct SerializationReader create_reader(const char* const buffer, unsigned const length) {
+      struct SerializationReader reader;
+      reader.buffer = buffer;
+      reader.offset = 0;
+      reader.length = length;
+      reader.malformed = false;
+      return reader;
+    }
+
+    /**
+     * Reads a single byte.
+     *
+     * @param this The reader.
+     * @return The byte read, or zero if the buffer is exhausted.
+     */
+    static uint8_t read_byte(struct SerializationReader* const this) {
+      if (this->offset < this->length) {
+        return (uint8_t)this->buffer[this->offset++];
+      } else {
+        this->malformed = true;
+        return 0;
+      }
+    }
+
+    /**
+     * Reads a varint-encoded unsigned integer.
+     *
+     * @param this The reader.
+     * @return The value read.
+     */
+    static uint32_t read_varint(struct SerializationReader* const this) {
+      uint32_t value = 0;
+      for (unsigned shift = 0; shift < 35; shift += 7) {
+        const uint8_t byte = read_byte(this);
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if (0 == (byte & 0x80)) {
+          return value;
+        }
+      }
+
+      this->malformed = true;
+      return 0;
+    }
+
+  /**
+   * Maps signed integers to unsigned so that values near zero, like
+   * the ubiquitous -1 sentinel level, encode to a single varint byte.
+   *
+   * @param value The signed value.
+   * @return The zigzag-encoded value.
+   */
+  static uint32_t zigzag_encode(int32_t const value) {
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+  }
+
+  /**
+   * Inverse of zigzag_encode.
+   *
+   * @param value The zigzag-encoded value.
+   * @return The signed value.
+   */
+  static int32_t zigzag_decode(uint32_t const value) {
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+  }
+
+  // Allocation functions for scanner memory, with their payload; see
+  // tree_sitter_tlaplus_scanner_set_allocator.
+  struct ScannerAllocator {
+    void* (*allocate)(void* payload, size_t size);
+    void (*deallocate)(void* payload, void* pointer);
+    void* payload;
+  };
+
+  static void* default_scanner_allocate(void* const payload, size_t const size) {
+    (void)payload;
+    return ts_malloc(size);
+  }
+
+  static void default_scanner_deallocate(void* const payload, void* const pointer) {
+    (void)payload;
+    ts_free(pointer);
+  }
+
+  // The allocator given to scanners created on this thread.
+  static SCANNER_THREAD_LOCAL struct ScannerAllocator thread_scanner_allocator = {
+    default_scanner_allocate, default_scanner_deallocate, NULL
+  };
+
+  // Bytes in the first block of an arena. Arenas hold only what outgrows
+  // the inline storage of the scanner, so this fits some hundreds of
+  // nested jlists and is rarely exceeded.
+  #define SCANNER_ARENA_BLOCK_SIZE 4096
+
+  // Alignment of every allocation from an arena.
+  #define SCANNER_ARENA_ALIGNMENT 16
+
+  // A block of arena memory, followed by its contents.
+  struct ArenaBlock {
+
+    // The next block, allocated once this one filled up.
+    struct ArenaBlock* next;
+
+    // The number of bytes of contents.
+    size_t capacity;
+
+    // The number of bytes of contents handed out.
+    size_t used;
+  };
+
+  // Offset of the contents of an arena block from its start.
+  #define ARENA_BLOCK_HEADER_SIZE \
+    ((sizeof(struct ArenaBlock) + SCANNER_ARENA_ALIGNMENT - 1) & ~(size_t)(SCANNER_ARENA_ALIGNMENT - 1))
+
+  /**
+   * Scanner memory which is handed out by bumping an offset, and freed all
+   * at once; a scanner's arena is rewound whenever its state is restored,
+   * and freed when it is destroyed. Blocks come from the allocator the
+   * scanner was created with; none is allocated until the stacks outgrow
+   * the scanner, and as rewinding keeps a single block, scans restoring
+   * the same scanner only allocate again to nest deeper than before.
+   */
+  struct Arena {
+
+    // The blocks, oldest first, or NULL if none were needed yet.
+    struct ArenaBlock* first;
+
+    // The block allocations are handed out from.
+    struct ArenaBlock* current;
+
+    // The allocator of the blocks.
+    struct ScannerAllocator allocator;
+  };
+
+    /**
+     * Initializes an arena with no blocks.
+     *
+     * @param this The arena to initialize.
+     * @param allocator The allocator to take blocks from.
+     */
+    static void arena_init(struct Arena* const this, struct ScannerAllocator const allocator) {
+      this->first = NULL;
+      this->current = NULL;
+      this->allocator = allocator;
+    }
+
+    /**
+     * Allocates a block of at least the given capacity and appends it to
+     * the arena, making it the current block.
+     *
+     * @param this The arena.
+     * @param capacity The number of bytes the block must hold.
+     * @return The block, or NULL if it could not be allocated.
+     */
+    static struct ArenaBlock* arena_add_block(struct Arena* const this, size_t capacity) {
+      const size_t previous = NULL == this->current ? 0 : this->current->capacity;
+      if (capacity < SCANNER_ARENA_BLOCK_SIZE) capacity = SCANNER_ARENA_BLOCK_SIZE;
+      if (capacity < 2 * previous) capacity = 2 * previous;
+
+      struct ArenaBlock* const block = this->allocator.allocate(this->allocator.payload, ARENA_BLOCK_HEADER_SIZE + capacity);
+      if (NULL == block) {
+        return NULL;
+      }
+      block->next = NULL;
+      block->capacity = capacity;
+      block->used = 0;
+      if (NULL == this->current) {
+        this->first = block;
+      } else {
+        this->current->next = block;
+      }
+      this->current = block;
+      return block;
+    }
+
+    /**
+     * Hands out memory from the arena, valid until it is next rewound.
+     *
+     * @param this The arena.
+     * @param size The number of bytes to allocate.
+     * @return The memory, aligned to SCANNER_ARENA_ALIGNMENT.
+     */
+    static void* arena_allocate(struct Arena* const this, size_t size) {
+      size = (size + SCANNER_ARENA_ALIGNMENT - 1) & ~(size_t)(SCANNER_ARENA_ALIGNMENT - 1);
+      struct ArenaBlock* block = this->current;
+      if (NULL == block || block->capacity - block->used < size) {
+        block = arena_add_block(this, size);
+        assert(NULL != block);
+      }
+
+      void* const pointer = (char*)block + ARENA_BLOCK_HEADER_SIZE + block->used;
+      block->used += size;
+      return pointer;
+    }
+
+    /**
+     * Frees every block of the arena.
+     *
+     * @param this The arena.
+     */
+    static void arena_free(struct Arena* const this) {
+      struct ArenaBlock* block = this->first;
+      while (NULL != block) {
+        struct ArenaBlock* const next = block->next;
+        this->allocator.deallocate(this->allocator.payload, block);
+        block = next;
+      }
+      this->first = NULL;
+      this->current = NULL;
+    }
+
+    /**
+     * Releases everything allocated from the arena in one step. If the
+     * arena spilled into several blocks they are replaced by one holding
+     * them all, so later allocations up to the same depth stay in a single
+     * block without any further allocation.
+     *
+     * @param this The arena.
+     */
+    static void arena_rewind(struct Arena* const this) {
+      if (NULL != this->first && NULL != this->first->next) {
+        size_t capacity = 0;
+        for (struct ArenaBlock* block = this->first; NULL != block; block = block->next) {
+          capacity += block->capacity;
+        }
+        arena_free(this);
+        arena_add_block(this, capacity);
+      }
+      if (NULL != this->first) {
+        this->first->used = 0;
+      }
+      this->current = this->first;
+    }
+
+/**
+ * Macro; declares a stack holding its first elements inline, so shallow
+ * stacks never touch the heap. Once the stack outgrows the inline buffer
+ * its elements move to an arena, which owns that memory; the stack must
+ * be reinitialized before the arena is rewound or freed.
+ *
+ * @param T The element type.
+ * @param inline_capacity The number of elements stored inline.
+ */
+#define SmallStack(T, inline_capacity)    \
+  struct {                                \
+    T *heap;                              \
+    uint32_t size;                        \
+    uint32_t capacity;                    \
+    T inline_contents[inline_capacity];   \
+  }
+
+// Number of jlists & proof levels the Scanner stores inline; eight jlists
+// fill one 64-byte cache line, and nesting is rarely any deeper.
+#define SCANNER_INLINE_NEST_CAPACITY 8
+
+#define small_stack_init(self) \
+  ((self)->heap = NULL, (self)->size = 0, (self)->capacity = small_stack_inline_capacity(self))
+
+#define small_stack_inline_capacity(self) \
+  ((uint32_t)(sizeof((self)->inline_contents) / sizeof(*(self)->inline_contents)))
+
+#define small_stack_contents(self) \
+  (NULL != (self)->heap ? (self)->heap : (self)->inline_contents)
+
+#define small_stack_get(self, index) \
+  (assert((uint32_t)(index) < (self)->size), &small_stack_contents(self)[index])
+
+#define small_stack_back(self) small_stack_get(self, (self)->size - 1)
+
+#define small_stack_clear(self) ((self)->size = 0)
+
+#define small_stack_reserve(self, arena, new_capacity)                      \
+  small_stack__reserve(                                                   \
+    arena, (self)->inline_contents, (void **)&(self)->heap,               \
+    &(self)->capacity, (self)->size, sizeof(*(self)->inline_contents),    \
+    new_capacity)
+
+#define small_stack_push(self, arena, element)            \
+  (small_stack_reserve(self, arena, (self)->size + 1),    \
+   small_stack_contents(self)[(self)->size++] = (element))
+
+#define small_stack_pop(self) (small_stack_contents(self)[--(self)->size])
+
+#define small_stack_drop(self) (assert((self)->size > 0), (void)--(self)->size)
+
+  /**
+   * Ensures a SmallStack has room for the given number of elements,
+   * moving its elements into a larger buffer from the arena if they no
+   * longer fit; the buffer they move out of is reclaimed on rewind.
    *
-   * @param lexeme The lexeme to map to a token.
-   * @return The token corresponding to the given lexeme.
+   * @param arena The arena to allocate from.
+   * @param inline_contents The inline buffer of the stack.
+   * @param heap The arena buffer of the stack, or NULL if inline.
+   * @param capacity The current capacity of the stack.
+   * @param size The number of elements in the stack.
+   * @param element_size The size of each element.
+   * @param new_capacity The number of elements to make room for.
    */
-  static enum Token tokenize_lexeme(enum Lexeme lexeme) {
-    switch (lexeme) {
-      case Lexeme_FORWARD_SLASH: return Token_OTHER;
-      case Lexeme_BACKWARD_SLASH: return Token_OTHER;
-      case Lexeme_GT: return Token_OTHER;
-      case Lexeme_EQ: return Token_OTHER;
-      case Lexeme_DASH: return Token_OTHER;
-      case Lexeme_COMMA: return Token_RIGHT_DELIMITER;
-      case Lexeme_COLON: return Token_RIGHT_DELIMITER;
-      case Lexeme_SEMICOLON: return Token_TERMINATOR;
-      case Lexeme_LAND: return Token_LAND;
-      case Lexeme_LOR: return Token_LOR;
-      case Lexeme_L_PAREN: return Token_OTHER;
-      case Lexeme_R_PAREN: return Token_RIGHT_DELIMITER;
-      case Lexeme_R_SQUARE_BRACKET: return Token_RIGHT_DELIMITER;
-      case Lexeme_R_CURLY_BRACE: return Token_RIGHT_DELIMITER;
-      case Lexeme_R_ANGLE_BRACKET: return Token_RIGHT_DELIMITER;
-      case Lexeme_RIGHT_ARROW: return Token_RIGHT_DELIMITER;
-      case Lexeme_RIGHT_MAP_ARROW: return Token_RIGHT_DELIMITER;
-      case Lexeme_COMMENT_START: return Token_COMMENT_START;
-      case Lexeme_BLOCK_COMMENT_START: return Token_COMMENT_START;
-      case Lexeme_SINGLE_LINE: return Token_TERMINATOR;
-      case Lexeme_DOUBLE_LINE: return Token_TERMINATOR;
-      case Lexeme_ASSUME_KEYWORD: return Token_TERMINATOR;
-      case Lexeme_ASSUMPTION_KEYWORD: return Token_TERMINATOR;
-      case Lexeme_AXIOM_KEYWORD: return Token_TERMINATOR;
-      case Lexeme_BY_KEYWORD: return Token_BY_KEYWORD;
-      case Lexeme_CONSTANT_KEYWORD: return Token_TERMINATOR;
-      case Lexeme_CONSTANTS_KEYWORD: return Token_TERMINATOR;
-      case Lexeme_COROLLARY_KEYWORD: return Token_TERMINATOR;
-      case Lexeme_ELSE_KEYWORD: return Token_RIGHT_DELIMITER;
-      case Lexeme_IN_KEYWORD: return Token_RIGHT_DELIMITER;
-      case Lexeme_LEMMA_KEYWORD: return Token_TERMINATOR;
-      case Lexeme_LOCAL_KEYWORD: return Token_TERMINATOR;
-      case Lexeme_OBVIOUS_KEYWORD: return Token_OBVIOUS_KEYWORD;
-      case Lexeme_OMITTED_KEYWORD: return Token_OMITTED_KEYWORD;
-      case Lexeme_PROOF_KEYWORD: return Token_PROOF_KEYWORD;
-      case Lexeme_PROPOSITION_KEYWORD: return Token_TERMINATOR;
-      case Lexeme_THEN_KEYWORD: return Token_RIGHT_DELIMITER;
-      case Lexeme_THEOREM_KEYWORD: return Token_TERMINATOR;
-      case Lexeme_VARIABLE_KEYWORD: return Token_TERMINATOR;
-      case Lexeme_VARIABLES_KEYWORD: return Token_TERMINATOR;
-      case Lexeme_PROOF_STEP_ID: return Token_PROOF_STEP_ID;
-      case Lexeme_QED_KEYWORD: return Token_QED_KEYWORD;
-      case Lexeme_STRONG_FAIRNESS: return Token_STRONG_FAIRNESS;
-      case Lexeme_WEAK_FAIRNESS: return Token_WEAK_FAIRNESS;
-      case Lexeme_IDENTIFIER: return Token_OTHER;
-      case Lexeme_OTHER: return Token_OTHER;
-      case Lexeme_END_OF_FILE: return Token_TERMINATOR;
-      default: return Token_OTHER;
+  static void small_stack__reserve(
+    struct Arena* const arena,
+    const void* const inline_contents,
+    void** const heap,
+    uint32_t* const capacity,
+    uint32_t const size,
+    size_t const element_size,
+    uint32_t new_capacity
+  ) {
+    if (new_capacity <= *capacity) {
+      return;
+    }
+
+    if (new_capacity < 2 * *capacity) {
+      new_capacity = 2 * *capacity;
     }
+    void* const contents = arena_allocate(arena, new_capacity * element_size);
+    memcpy(contents, NULL == *heap ? inline_contents : *heap, size * element_size);
+    *heap = contents;
+    *capacity = new_capacity;
   }
 
   // Possible types of junction list.
@@ -875,38 +1486,28 @@
       return jlist;
     }
 
-    static unsigned jlist_serialize(struct JunctList* this, char* const buffer, bool const is_dry_run) {
-      unsigned offset = 0;
-      unsigned copied = 0;
-
-      // Serialize junction type
-      copied = sizeof(uint8_t);
-      if (!is_dry_run) { buffer[offset] = (uint8_t)(this->type); }
-      offset += copied;
-
-      // Serialize alignment column
-      copied = sizeof(column_index);
-      if (!is_dry_run) { memcpy(&buffer[offset], &this->alignment_column, copied); }
-      offset += copied;
-
-      return offset;
+    /**
+     * Serializes a jlist as a single varint holding the alignment column
+     * shifted left by one, with the junction type in the low bit.
+     *
+     * @param this The jlist to serialize.
+     * @param writer The writer to serialize into.
+     */
+    static void jlist_serialize(const struct JunctList* const this, struct SerializationWriter* const writer) {
+      const uint32_t column = (uint16_t)(this->alignment_column);
+      write_varint(writer, (column << 1) | (uint32_t)(this->type));
     }
 
-    static unsigned jlist_deserialize(struct JunctList* this, const char* const buffer) {
-      unsigned offset = 0;
-      unsigned copied = 0;
-
-      // Deserialize junction type
-      copied = sizeof(uint8_t);
-      this->type = (enum JunctType)buffer[offset];
-      offset += copied;
-
-      // Deserialize alignment column
-      copied = sizeof(column_index);
-      memcpy(&this->alignment_column, &buffer[offset], copied);
-      offset += copied;
-
-      return offset;
+    /**
+     * Deserializes a jlist written by jlist_serialize.
+     *
+     * @param this The jlist to deserialize into.
+     * @param reader The reader to deserialize from.
+     */
+    static void jlist_deserialize(struct JunctList* const this, struct SerializationReader* const reader) {
+      const uint32_t value = read_varint(reader);
+      this->type = (enum JunctType)(value & 1);
+      this->alignment_column = (column_index)(uint16_t)(value >> 1);
     }
 
   /**
@@ -915,162 +1516,138 @@
   struct Scanner {
 
     // The nested junction lists at the current lexer position.
-    Array(struct JunctList) jlists;
+    SmallStack(struct JunctList, SCANNER_INLINE_NEST_CAPACITY) jlists;
 
     // The nested proofs at the current lexer position.
-    Array(proof_level) proofs;
+    SmallStack(proof_level, SCANNER_INLINE_NEST_CAPACITY) proofs;
 
     // The level of the last proof.
     proof_level last_proof_level;
 
     // Whether we have seen a PROOF token.
     bool have_seen_proof_keyword;
+
+    // The arena holding stacks that outgrew their inline storage.
+    struct Arena* arena;
 };
 
     /**
-     * Serializes the Scanner state into the given buffer.
+     * Clears the Scanner back to the state returned by scanner_create
+     * while keeping any memory already allocated for its stacks.
      *
-     * @param this The Scanner state to serialize.
-     * @param buffer The buffer into which to serialize the scanner state.
-     * @param is_dry_run Whether to actually copy the bytes to the buffer.
-     * @return Number of bytes written into the buffer.
+     * @param this The Scanner state to clear.
      */
-    static unsigned scanner_try_serialize(
-      const struct Scanner* const this,
-      char* const buffer,
-      const bool is_dry_run
-    ) {
-      unsigned offset = 0;
-      unsigned copied = 0;
-
-      const nest_address jlist_depth = (nest_address)(this->jlists.size);
-      copied = sizeof(nest_address);
-      if (!is_dry_run) { memcpy(&buffer[offset], &jlist_depth, copied); }
-      offset += copied;
-      for (nest_address i = 0; i < jlist_depth; i++) {
-        char* const buffer_addr = is_dry_run ? NULL : &buffer[offset];
-        copied = jlist_serialize(array_get(&this->jlists, i), buffer_addr, is_dry_run);
-        offset += copied;
-      }
-
-      const nest_address proof_depth = (nest_address)(this->proofs.size);
-      copied = sizeof(nest_address);
-      if (!is_dry_run) { memcpy(&buffer[offset], &proof_depth, copied); }
-      offset += copied;
-      copied = proof_depth * sizeof(proof_level);
-      if (!is_dry_run && copied > 0) { memcpy(&buffer[offset], this->proofs.contents, copied); }
-      offset += copied;
-
-      copied = sizeof(proof_level);
-      if (!is_dry_run) { memcpy(&buffer[offset], &this->last_proof_level, copied); }
-      offset += copied;
-
-      copied = sizeof(uint8_t);
-      if (!is_dry_run) { buffer[offset] = (uint8_t)(this->have_seen_proof_keyword); }
-      offset += copied;
-
-      return offset;
+    static void scanner_clear(struct Scanner* const this) {
+      small_stack_clear(&this->jlists);
+      small_stack_clear(&this->proofs);
+      this->last_proof_level = -1;
+      this->have_seen_proof_keyword = false;
     }
 
     /**
-     * Serializes the Scanner state into the given buffer.
+     * Serializes the Scanner state in a single pass. The layout is:
+     * 1. Varint jlist count, then one varint per jlist
+     * 2. Varint proof count, then the first proof level and the deltas
+     *    between subsequent levels as zigzag varints
+     * 3. Zigzag varint of the last proof level, shifted left by one with
+     *    the have_seen_proof_keyword flag in the low bit
+     * The encoding is self-delimiting so no length prefix is needed.
      *
      * @param this The Scanner state to serialize.
-     * @param buffer The buffer into which to serialize the scanner state.
-     * @return Number of bytes written into the buffer.
+     * @param writer The writer into which to serialize the scanner state.
      */
-    static unsigned scanner_serialize(const struct Scanner* this, char* buffer) {
-      return scanner_try_serialize(this, buffer, false);
-    }
+    static void scanner_serialize(const struct Scanner* const this, struct SerializationWriter* const writer) {
+      write_varint(writer, this->jlists.size);
+      for (unsigned i = 0; i < this->jlists.size; i++) {
+        jlist_serialize(small_stack_get(&this->jlists, i), writer);
+      }
 
-    /**
-     * Calculates the serialized size of the scanner.
-     *
-     * @param this The Scanner state to find the deserialized size of.
-     * @return The size of the Scanner when serialized.
-     */
-    static unsigned scanner_serialized_size(const struct Scanner* const this) {
-      return scanner_try_serialize(this, NULL, true);
+      write_varint(writer, this->proofs.size);
+      proof_level previous_level = 0;
+      for (unsigned i = 0; i < this->proofs.size; i++) {
+        const proof_level level = *small_stack_get(&this->proofs, i);
+        write_varint(writer, zigzag_encode(level - previous_level));
+        previous_level = level;
+      }
+
+      write_varint(writer,
+        (zigzag_encode(this->last_proof_level) << 1)
+        | (uint32_t)(this->have_seen_proof_keyword));
     }
 
     /**
-     * Deserializes the Scanner state from the given buffer.
+     * Deserializes the Scanner state written by scanner_serialize.
      *
      * @param this The Scanner state to deserialize.
-     * @param buffer The buffer from which to deserialize the state.
-     * @param length The bytes available to read from the buffer.
+     * @param reader The reader from which to deserialize the state.
      */
-    static void scanner_deserialize(struct Scanner* const this, const char* const buffer, unsigned const length) {
+    static void scanner_deserialize(struct Scanner* const this, struct SerializationReader* const reader) {
       // Very important to clear values of all fields here!
       // Scanner object is reused; if a variable isn't cleared, it can
       // lead to extremely strange & impossible-to-debug behavior.
-      array_delete(&this->jlists);
-      array_delete(&this->proofs);
-      this->last_proof_level = -1;
-      this->have_seen_proof_keyword = false;
-
-      if (length > 0) {
-        unsigned offset = 0;
-        unsigned copied = 0;
-
-        nest_address jlist_depth = 0;
-        copied = sizeof(nest_address);
-        memcpy(&jlist_depth, &buffer[offset], copied);
-        if (jlist_depth > 0) array_grow_by(&(this->jlists), jlist_depth);
-        offset += copied;
-
-        for (nest_address i = 0; i < jlist_depth; i++) {
-          assert(offset < length);
-          copied = jlist_deserialize(array_get(&(this->jlists), i), &buffer[offset]);
-          offset += copied;
-        }
-
-        nest_address proof_depth = 0;
-        copied = sizeof(nest_address);
-        memcpy(&proof_depth, &buffer[offset], copied);
-        if (proof_depth > 0) array_grow_by(&(this->proofs), proof_depth);
-        offset += copied;
-
-        copied = proof_depth * sizeof(proof_level);
-        if (copied > 0) { memcpy(this->proofs.contents, &buffer[offset], copied); }
-        offset += copied;
+      // Deep stacks take their storage from the rewound arena, which
+      // needs no allocation once it has grown to fit them.
+      scanner_clear(this);
+
+      // Every element takes at least one byte, which bounds the counts.
+      const uint32_t jlist_depth = read_varint(reader);
+      if (jlist_depth > reader->length - reader->offset) {
+        reader->malformed = true;
+        return;
+      }
+      small_stack_reserve(&this->jlists, this->arena, jlist_depth);
+      this->jlists.size = jlist_depth;
+      for (unsigned i = 0; i < jlist_depth; i++) {
+        jlist_deserialize(small_stack_get(&this->jlists, i), reader);
+      }
 
-        copied = sizeof(proof_level);
-        memcpy(&(this->last_proof_level), &buffer[offset], copied);
-        offset += copied;
+      const uint32_t proof_depth = read_varint(reader);
+      if (proof_depth > reader->length - reader->offset) {
+        reader->malformed = true;
+        return;
+      }
+      small_stack_reserve(&this->proofs, this->arena, proof_depth);
+      this->proofs.size = proof_depth;
+      proof_level previous_level = 0;
+      for (unsigned i = 0; i < proof_depth; i++) {
+        previous_level += zigzag_decode(read_varint(reader));
+        *small_stack_get(&this->proofs, i) = previous_level;
+      }
 
-        copied = sizeof(uint8_t);
-        this->have_seen_proof_keyword = (bool)(buffer[offset] & 1);
-        offset += copied;
+      const uint32_t last_proof = read_varint(reader);
+      this->last_proof_level = zigzag_decode(last_proof >> 1);
+      this->have_seen_proof_keyword = (bool)(last_proof & 1);
+    }
 
-        assert(offset == length);
-      }
+    /**
+     * Whether the Scanner is in the state returned by scanner_create.
+     *
+     * @param this The Scanner state.
+     * @return Whether the Scanner holds no state.
+     */
+    static bool scanner_is_initial(const struct Scanner* const this) {
+      return 0 == this->jlists.size
+        && 0 == this->proofs.size
+        && -1 == this->last_proof_level
+        && !this->have_seen_proof_keyword;
     }
 
     /**
      * Initializes a new instance of the Scanner object.
      *
+     * @param arena The arena for stacks outgrowing their inline storage.
      * @return A newly-created Scanner.
      */
-    static struct Scanner scanner_create() {
+    static struct Scanner scanner_create(struct Arena* const arena) {
       struct Scanner s;
-      array_init(&s.jlists);
-      array_init(&s.proofs);
+      small_stack_init(&s.jlists);
+      small_stack_init(&s.proofs);
       s.last_proof_level = -1;
       s.have_seen_proof_keyword = false;
+      s.arena = arena;
       return s;
     }
 
-    /**
-     * Frees all memory associated with this Scanner.
-     *
-     * @param this The Scanner to free.
-     */
-    static void scanner_free(struct Scanner* const this) {
-      array_delete(&this->jlists);
-      array_delete(&this->proofs);
-    }
-
     /**
      * Whether the Scanner state indicates we are currently in a jlist.
      *
@@ -1089,7 +1666,7 @@
      * @return The column index of the current jlist.
      */
     static column_index get_current_jlist_column_index(const struct Scanner* const this) {
-      return is_in_jlist(this) ? array_back(&this->jlists)->alignment_column : -1;
+      return is_in_jlist(this) ? small_stack_back(&this->jlists)->alignment_column : -1;
     }
 
     /**
@@ -1103,7 +1680,7 @@
       struct Scanner* const this,
       enum JunctType const type
     ) {
-      return is_in_jlist(this) && type == array_back(&this->jlists)->type;
+      return is_in_jlist(this) && type == small_stack_back(&this->jlists)->type;
     }
 
     /**
@@ -1123,7 +1700,7 @@
     ) {
       lexer->result_symbol = INDENT;
       struct JunctList new_list = create_junctlist(type, col);
-      array_push(&this->jlists, new_list);
+      small_stack_push(&this->jlists, this->arena, new_list);
       return true;
     }
 
@@ -1150,7 +1727,7 @@
     static bool emit_dedent(struct Scanner* const this, TSLexer* const lexer) {
       if (is_in_jlist(this)) {
         lexer->result_symbol = DEDENT;
-        array_pop(&this->jlists);
+        small_stack_drop(&this->jlists);
         return true;
       } else {
         return false;
@@ -1391,7 +1968,7 @@
      * @return The current proof level.
      */
     static proof_level get_current_proof_level(const struct Scanner* const this) {
-      return is_in_proof(this) ? *array_back(&this->proofs) : -1;
+      return is_in_proof(this) ? *small_stack_back(&this->proofs) : -1;
     }
 
     /**
@@ -1408,7 +1985,7 @@
       proof_level level
     ) {
       lexer->result_symbol = BEGIN_PROOF;
-      array_push(&this->proofs, level);
+      small_stack_push(&this->proofs, this->arena, level);
       this->last_proof_level = level;
       this->have_seen_proof_keyword = false;
       return true;
@@ -1632,7 +2209,7 @@
     ) {
       if (is_in_proof(this)) {
         this->last_proof_level = get_current_proof_level(this);
-        array_pop(&this->proofs);
+        small_stack_drop(&this->proofs);
       }
 
       lexer->result_symbol = QED_KEYWORD;
@@ -1666,6 +2243,64 @@
       }
     }
 
+    /**
+     * Checks whether a lexeme starting with the given codepoint could be
+     * a junct, either /\ or \/ or their unicode equivalents.
+     *
+     * @param codepoint The first codepoint of the next lexeme.
+     * @return Whether the lexeme could be a junct.
+     */
+    static bool could_start_junct(int32_t const codepoint) {
+      return '/' == codepoint
+        || '\\' == codepoint
+        || L'\u2227' == codepoint  // '∧'
+        || L'\u2228' == codepoint; // '∨'
+    }
+
+    /**
+     * Checks whether a lexeme starting with the given codepoint could
+     * possibly lead to a token being emitted. Within a jlist any lexeme
+     * could end the jlist, but outside of one only a few lexemes matter
+     * and most only if specific tokens are valid. This lets the scanner
+     * skip lex_lookahead for the vast majority of lexemes.
+     *
+     * @param this The Scanner state.
+     * @param valid_symbols Tokens possibly expected in this spot.
+     * @param codepoint The first codepoint of the next lexeme.
+     * @return Whether scanning the lexeme could emit a token.
+     */
+    static bool could_emit_token(
+      const struct Scanner* const this,
+      const bool* const valid_symbols,
+      int32_t const codepoint
+    ) {
+      if (is_in_jlist(this)) {
+        return true;
+      }
+
+      if (could_start_junct(codepoint)) {
+        return valid_symbols[INDENT];
+      }
+
+      switch (codepoint) {
+        case '<':
+          return valid_symbols[BEGIN_PROOF] || valid_symbols[BEGIN_PROOF_STEP];
+        case 'P':
+          return valid_symbols[PROOF_KEYWORD];
+        case 'B':
+          return valid_symbols[BY_KEYWORD];
+        case 'O':
+          return valid_symbols[OBVIOUS_KEYWORD] || valid_symbols[OMITTED_KEYWORD];
+        case 'Q':
+        case 'S':
+        case 'W':
+          // QED, SF_, and WF_ are emitted even if not valid
+          return true;
+        default:
+          return false;
+      }
+    }
+
     /**
      * Scans for various possible external tokens.
      *
@@ -1691,13 +2326,26 @@
       }
 
       if(valid_symbols[LEADING_EXTRAMODULAR_TEXT] || valid_symbols[TRAILING_EXTRAMODULAR_TEXT]) {
+        SCANNER_STATS(scanner_stats_add(ScannerStat_EXTRAMODULAR_TEXT_SCANS, 1));
         return scan_extramodular_text(lexer, valid_symbols);
       } else {
+        // Check the start of the next lexeme before lexing all of it
+        const int64_t skipped_col = skip_whitespace(lexer);
+        if (!could_emit_token(this, valid_symbols, lexer->lookahead)) {
+          SCANNER_STATS(scanner_stats_add(ScannerStat_LOOKAHEAD_SKIPS, 1));
+          return false;
+        }
+
+        // Columns are only compared against jlists or used to start one
         column_index col = -1;
-        CharArray proof_step_id_level = array_new();
-        enum Token token = tokenize_lexeme(lex_lookahead(lexer, &col, &proof_step_id_level));
-        struct ProofStepId proof_step_id_token = parse_proof_step_id(&proof_step_id_level);
-        array_delete(&proof_step_id_level);
+        if (is_in_jlist(this) || could_start_junct(lexer->lookahead)) {
+          SCANNER_STATS(scanner_stats_add(skipped_col < 0 ? ScannerStat_GET_COLUMN_CALLS : ScannerStat_TRACKED_COLUMNS, 1));
+          col = get_next_column(lexer, skipped_col);
+        }
+
+        struct ProofStepId proof_step_id_token = create_proof_step_id();
+        enum Token token = tokenize_lexeme(lex_lookahead(lexer, &proof_step_id_token));
+        SCANNER_STATS(scanner_stats_add(ScannerStat_LEXED_TOKEN + token, 1));
         switch (token) {
           case Token_LAND:
             return handle_junct_token(this, lexer, valid_symbols, JunctType_CONJUNCTION, col);
@@ -1738,70 +2386,187 @@
    * Each time a PlusCal block is entered, a nested context is created.
    * Exiting the PlusCal block exits the context.
    * Multiply-nested PlusCal blocks are supported.
+   * Contexts are kept as live Scanner objects; entering and exiting a
+   * PlusCal block only moves the top of the stack, and contexts above
+   * the top are kept around so their stack capacity can be reused until
+   * the state is next restored.
+   * The outermost context is stored inline, so creating a scanner
+   * outside PlusCal makes no allocation beyond the NestedScanner itself.
+   * Everything else is allocated from the arena, and so is released in
+   * one step each time the state is restored.
    */
   struct NestedScanner {
 
-    // The enclosing context(s) of the PlusCal block.
-    Array(CharArray) enclosing_contexts;
+    // The memory of stacks which outgrew their inline storage.
+    struct Arena arena;
 
-    // The currently-active context.
-    struct Scanner current_context;
+    // The contexts, outermost first; the first context_depth are active.
+    SmallStack(struct Scanner, 1) contexts;
+
+    // The number of active contexts (guaranteed to be >= 1).
+    unsigned context_depth;
+
+    // The bytes last serialized or deserialized; these describe the
+    // current state unless the state was changed by a scan since.
+    char cached_state[TREE_SITTER_SERIALIZATION_BUFFER_SIZE];
+
+    // The number of bytes in cached_state.
+    unsigned cached_state_length;
+
+    // Whether the state may have changed since cached_state was written.
+    bool is_cached_state_stale;
 
   };
 
     /**
-     * Serialize the nested scanner into a buffer.
+     * Gets the currently-active context.
+     *
+     * @param this The NestedScanner state.
+     * @return The innermost active context.
+     */
+    static struct Scanner* nested_scanner_current_context(const struct NestedScanner* const this) {
+      // Contexts are mutable through a const NestedScanner, as with Array
+      return (struct Scanner*)small_stack_get(&this->contexts, this->context_depth - 1);
+    }
+
+    /**
+     * Activates a new innermost context in its initial state, reusing
+     * a previously-allocated context if available.
+     *
+     * @param this The NestedScanner state.
+     */
+    static void nested_scanner_push_context(struct NestedScanner* const this) {
+      if (this->context_depth < this->contexts.size) {
+        scanner_clear(small_stack_get(&this->contexts, this->context_depth));
+      } else {
+        small_stack_push(&this->contexts, &this->arena, scanner_create(&this->arena));
+      }
+
+      this->context_depth++;
+    }
+
+    /**
+     * Writes the format version, a varint count of contexts, then each
+     * context from the outermost to the current one.
+     *
+     * @param this The NestedScanner state.
+     * @param writer The writer to serialize into.
+     */
+    static void nested_scanner_write(
+      const struct NestedScanner* const this,
+      struct SerializationWriter* const writer
+    ) {
+      write_byte(writer, SERIALIZATION_FORMAT_VERSION);
+      write_varint(writer, this->context_depth);
+      for (unsigned i = 0; i < this->context_depth; i++) {
+        scanner_serialize(small_stack_get(&this->contexts, i), writer);
+      }
+    }
+
+    /**
+     * Serializes the nested scanner into a buffer. The initial state is
+     * serialized as zero bytes, which tree-sitter stores for free. Any
+     * other state is written as the format version, a varint count of
+     * contexts (guaranteed to be >= 1), then each context from the
+     * outermost to the current one. Contexts are self-delimiting.
      *
      * @param this The NestedScanner state.
      * @param buffer The buffer to serialize the state into.
      * @return The number of bytes written into the buffer.
      */
-    static unsigned nested_scanner_serialize(
+    static unsigned nested_scanner_try_serialize(
       const struct NestedScanner* const this,
       char* const buffer
     ) {
-      unsigned offset = 0;
-      unsigned copied = 0;
-
-      // First write number of enclosing contexts (guaranteed to be >= 1)
-      nest_address const context_depth = this->enclosing_contexts.size + 1;
-      copied = sizeof(nest_address);
-      if (copied > 0) memcpy(&buffer[offset], &context_depth, copied);
-      offset += copied;
-
-      // Then write size of N-1 enclosing contexts
-      for (int i = 0; i < context_depth - 1; i++) {
-        unsigned const context_size = array_get(&this->enclosing_contexts, i)->size;
-        copied = sizeof(unsigned);
-        if (copied > 0) memcpy(&buffer[offset], &context_size, copied);
-        offset += copied;
+      if (1 == this->context_depth && scanner_is_initial(nested_scanner_current_context(this))) {
+        return 0;
       }
 
-      // Reserve space for current context size
-      unsigned const current_context_size_offset = offset;
-      copied = sizeof(unsigned);
-      offset += copied;
-
-      // Serialize N-1 enclosing contexts
-      for (unsigned i = 0; i < this->enclosing_contexts.size; i++) {
-        CharArray* context = array_get(&this->enclosing_contexts, i);
-        copied = context->size;
-        if (copied > 0) memcpy(&buffer[offset], context->contents, copied);
-        offset += copied;
-      }
+      struct SerializationWriter writer = create_writer(buffer, TREE_SITTER_SERIALIZATION_BUFFER_SIZE);
+      nested_scanner_write(this, &writer);
+
+      // Nesting is bounded by nested_scanner_has_room, so this should not
+      // happen; state too large to store is dropped rather than truncated
+      assert(!writer.overflowed);
+      return writer.overflowed ? 0 : writer.offset;
+    }
 
-      // Serialize current context
-      copied = scanner_serialize(&this->current_context, &buffer[offset]);
-      offset += copied;
+    /**
+     * Whether the state, just nested deeper by a token, leaves enough of
+     * the serialization buffer free that any later token not nesting it
+     * further still fits; see SERIALIZATION_HEADROOM. Tokens nesting the
+     * state past this are refused, so the depth of jlists, proofs and
+     * PlusCal contexts is bounded by the size of their serialized form.
+     *
+     * @param this The NestedScanner state.
+     * @return Whether the state fits with room to spare.
+     */
+    static bool nested_scanner_has_room(const struct NestedScanner* const this) {
+      char buffer[TREE_SITTER_SERIALIZATION_BUFFER_SIZE];
+      struct SerializationWriter writer =
+        create_writer(buffer, TREE_SITTER_SERIALIZATION_BUFFER_SIZE - SERIALIZATION_HEADROOM);
+      nested_scanner_write(this, &writer);
+      return !writer.overflowed;
+    }
+
+    /**
+     * Records the given bytes as the serialized form of the current state.
+     *
+     * @param this The NestedScanner state.
+     * @param buffer The serialized form of the current state.
+     * @param length The number of bytes in the buffer.
+     */
+    static void nested_scanner_cache_state(
+      struct NestedScanner* const this,
+      const char* const buffer,
+      unsigned const length
+    ) {
+      if (length > 0) memcpy(this->cached_state, buffer, length);
+      this->cached_state_length = length;
+      this->is_cached_state_stale = false;
+    }
 
-      // Write current context size to reserved position
-      memcpy(&buffer[current_context_size_offset], &copied, sizeof(unsigned));
+    /**
+     * Serialize the nested scanner into a buffer, reusing the cached
+     * bytes if the state has not changed since they were written.
+     *
+     * @param this The NestedScanner state.
+     * @param buffer The buffer to serialize the state into.
+     * @return The number of bytes written into the buffer.
+     */
+    static unsigned nested_scanner_serialize(
+      struct NestedScanner* const this,
+      char* const buffer
+    ) {
+      if (this->is_cached_state_stale) {
+        const unsigned length = nested_scanner_try_serialize(this, buffer);
+        nested_scanner_cache_state(this, buffer, length);
+        return length;
+      } else {
+        if (this->cached_state_length > 0) memcpy(buffer, this->cached_state, this->cached_state_length);
+        return this->cached_state_length;
+      }
+    }
 
-      return offset;
+    /**
+     * Returns the nested scanner to its initial state and rewinds its
+     * arena, first dropping every stack stored there.
+     *
+     * @param this The NestedScanner state.
+     */
+    static void nested_scanner_rewind(struct NestedScanner* const this) {
+      small_stack_init(&this->contexts);
+      this->contexts.inline_contents[0] = scanner_create(&this->arena);
+      this->contexts.size = 1;
+      this->context_depth = 1;
+      arena_rewind(&this->arena);
     }
 
     /**
-     * Deserialize a nested scanner.
+     * Deserialize a nested scanner. Malformed buffers or buffers of a
+     * different format version reset the scanner to its initial state.
+     * Tree-sitter often restores the state it was just given, so this is
+     * skipped entirely if the buffer matches the current state.
      *
      * @param this The nested scanner instance to deserialize into.
      * @param buffer The buffer to deserialize from.
@@ -1812,57 +2577,53 @@
       const char* const buffer,
       unsigned const length
     ) {
-      for (unsigned i = 0; i < this->enclosing_contexts.size; i++) {
-        array_delete(array_get(&this->enclosing_contexts, i));
+      if (!this->is_cached_state_stale
+        && length == this->cached_state_length
+        && (0 == length || 0 == memcmp(buffer, this->cached_state, length))) {
+        SCANNER_STATS(scanner_stats_add(ScannerStat_DESERIALIZE_SKIPS, 1));
+        return;
       }
-      array_delete(&this->enclosing_contexts);
-      scanner_deserialize(&this->current_context, NULL, 0);
+
+      nested_scanner_rewind(this);
 
       if (length > 0) {
-        unsigned offset = 0;
-        unsigned copied = 0;
-
-        // First item: total number of contexts (guaranteed to be >= 1)
-        nest_address context_depth = 0;
-        copied = sizeof(nest_address);
-        memcpy(&context_depth, &buffer[offset], copied);
-        assert(1 <= context_depth);
-        if (context_depth - 1 > 0) array_grow_by(&this->enclosing_contexts, context_depth - 1);
-        offset += copied;
-
-        // Next N items: size of all contexts
-        Array(unsigned) context_sizes = array_new();
-        if (context_depth > 0) array_grow_by(&context_sizes, context_depth);
-        copied = context_depth * sizeof(unsigned);
-        if (copied > 0) memcpy(context_sizes.contents, &buffer[offset], copied);
-        offset += copied;
-
-        // Deserialize N-1 contexts as enclosing contexts
-        for (int i = 0; i < context_depth - 1; i++) {
-          copied = *array_get(&context_sizes, i);
-          array_grow_by(array_get(&this->enclosing_contexts, i), copied);
-          if (copied > 0) memcpy(array_get(&this->enclosing_contexts, i)->contents, &buffer[offset], copied);
-          offset += copied;
+        struct SerializationReader reader = create_reader(buffer, length);
+        const uint8_t version = read_byte(&reader);
+        const uint32_t context_depth = read_varint(&reader);
+        reader.malformed |= SERIALIZATION_FORMAT_VERSION != version
+          || 0 == context_depth
+          || context_depth > length - reader.offset;
+
+        for (unsigned i = 0; !reader.malformed && i < context_depth; i++) {
+          if (i > 0) nested_scanner_push_context(this);
+          scanner_deserialize(nested_scanner_current_context(this), &reader);
         }
 
-        // Final context is deserialized as current context
-        copied = *array_back(&context_sizes);
-        scanner_deserialize(&this->current_context, &buffer[offset], copied);
-        offset += copied;
-
-        array_delete(&context_sizes);
-        assert(offset == length);
+        assert(!reader.malformed && reader.offset == length);
+        if (reader.malformed) {
+          this->context_depth = 1;
+          scanner_clear(nested_scanner_current_context(this));
+          nested_scanner_cache_state(this, NULL, 0);
+          return;
+        }
       }
+
+      nested_scanner_cache_state(this, buffer, length);
     }
 
     /**
      * Initializes a new instance of the NestedScanner object.
      *
      * @param this The NestedScanner to initialize.
+     * @param allocator The allocator for the arena of the NestedScanner.
      */
-    static void nested_scanner_init(struct NestedScanner* const this) {
-      array_init(&this->enclosing_contexts);
-      this->current_context = scanner_create();
+    static void nested_scanner_init(struct NestedScanner* const this, struct ScannerAllocator const allocator) {
+      arena_init(&this->arena, allocator);
+      small_stack_init(&this->contexts);
+      small_stack_push(&this->contexts, &this->arena, scanner_create(&this->arena));
+      this->context_depth = 1;
+      this->cached_state_length = 0;
+      this->is_cached_state_stale = false;
     }
 
     /**
@@ -1871,11 +2632,44 @@
      * @param this The NestedScanner to free.
      */
     static void nested_scanner_free(struct NestedScanner* const this) {
-      for (unsigned i = 0; i < this->enclosing_contexts.size; i++) {
-        array_delete(array_get(&this->enclosing_contexts, i));
+      small_stack_init(&this->contexts);
+      arena_free(&this->arena);
+    }
+
+    /**
+     * Scans for a token in the current context, refusing any INDENT or
+     * BEGIN_PROOF token that would nest the state too deeply to serialize;
+     * the lexer then falls back to the grammar's own tokens, so jlists and
+     * proofs past the limit are parsed as ordinary expressions or errors.
+     *
+     * @param this The NestedScanner state.
+     * @param lexer The tree-sitter lexing control structure.
+     * @param valid_symbols Tokens possibly expected in this spot.
+     * @return Whether a token was encountered.
+     */
+    static bool nested_scanner_scan_context(
+      struct NestedScanner* const this,
+      TSLexer* const lexer,
+      const bool* const valid_symbols
+    ) {
+      struct Scanner* const context = nested_scanner_current_context(this);
+      const proof_level last_proof_level = context->last_proof_level;
+      const bool have_seen_proof_keyword = context->have_seen_proof_keyword;
+      if (!scan(context, lexer, valid_symbols)) {
+        return false;
+      }
+
+      if (INDENT == lexer->result_symbol && !nested_scanner_has_room(this)) {
+        small_stack_drop(&context->jlists);
+        return false;
+      } else if (BEGIN_PROOF == lexer->result_symbol && !nested_scanner_has_room(this)) {
+        small_stack_drop(&context->proofs);
+        context->last_proof_level = last_proof_level;
+        context->have_seen_proof_keyword = have_seen_proof_keyword;
+        return false;
+      } else {
+        return true;
       }
-      array_delete(&this->enclosing_contexts);
-      scanner_free(&this->current_context);
     }
 
     static bool nested_scan(
@@ -1888,34 +2682,30 @@
       if (valid_symbols[ERROR_SENTINEL]) {
         return false;
       } else if (valid_symbols[PCAL_START]) {
-        // Entering PlusCal block; push current context then clear
-        unsigned const expected_size = scanner_serialized_size(&this->current_context);
-        CharArray serialized_current_context = array_new();
-        array_grow_by(&serialized_current_context, expected_size);
-        unsigned const actual_size = scanner_serialize(&this->current_context, serialized_current_context.contents);
-        assert(expected_size == actual_size);
-        array_push(&this->enclosing_contexts, serialized_current_context);
-        scanner_free(&this->current_context);
-        this->current_context = scanner_create();
+        // Entering PlusCal block; push a fresh context
+        nested_scanner_push_context(this);
+        if (!nested_scanner_has_room(this)) {
+          this->context_depth--;
+          return false;
+        }
         lexer->result_symbol = PCAL_START;
         return true;
-      } else if (valid_symbols[PCAL_END] && this->enclosing_contexts.size > 0) {
-        // Exiting PlusCal block; rehydrate context then pop
-        CharArray* next = array_back(&this->enclosing_contexts);
-        scanner_deserialize(&this->current_context, next->contents, next->size);
-        array_delete(&array_pop(&this->enclosing_contexts));
+      } else if (valid_symbols[PCAL_END] && this->context_depth > 1) {
+        // Exiting PlusCal block; pop back to the enclosing context
+        this->context_depth--;
         lexer->result_symbol = PCAL_END;
         return true;
       } else {
-        return scan(&this->current_context, lexer, valid_symbols);
+        return nested_scanner_scan_context(this, lexer, valid_symbols);
       }
     }
 
   // Called once when language is set on a parser.
   // Allocates memory for storing scanner state.
   void* tree_sitter_tlaplus_external_scanner_create() {
-    struct NestedScanner* scanner = ts_malloc(sizeof(struct NestedScanner));
-    nested_scanner_init(scanner);
+    const struct ScannerAllocator allocator = thread_scanner_allocator;
+    struct NestedScanner* scanner = allocator.allocate(allocator.payload, sizeof(struct NestedScanner));
+    nested_scanner_init(scanner, allocator);
     return scanner;
   }
 
@@ -1923,8 +2713,9 @@
   // Frees memory storing scanner state.
   void tree_sitter_tlaplus_external_scanner_destroy(void* const payload) {
     struct NestedScanner* const scanner = (struct NestedScanner*)(payload);
+    const struct ScannerAllocator allocator = scanner->arena.allocator;
     nested_scanner_free(scanner);
-    ts_free(scanner);
+    allocator.deallocate(allocator.payload, scanner);
   }
 
   // Called whenever this scanner recognizes a token.
@@ -1933,8 +2724,11 @@
     void* const payload,
     char* const buffer
   ) {
-    const struct NestedScanner* const scanner = (struct NestedScanner*)(payload);
-    return nested_scanner_serialize(scanner, buffer);
+    struct NestedScanner* const scanner = (struct NestedScanner*)(payload);
+    const unsigned length = nested_scanner_serialize(scanner, buffer);
+    SCANNER_STATS(scanner_stats_add(ScannerStat_SERIALIZE_CALLS, 1));
+    SCANNER_STATS(scanner_stats_add(ScannerStat_SERIALIZED_BYTES, length));
+    return length;
   }
 
   // Called when handling edits and ambiguities.
@@ -1945,6 +2739,8 @@
     unsigned const length
   ) {
     struct NestedScanner* const scanner = (struct NestedScanner*)(payload);
+    SCANNER_STATS(scanner_stats_add(ScannerStat_DESERIALIZE_CALLS, 1));
+    SCANNER_STATS(scanner_stats_add(ScannerStat_DESERIALIZED_BYTES, length));
     nested_scanner_deserialize(scanner, buffer, length);
   }
 
@@ -1955,6 +2751,78 @@
     const bool* const valid_symbols
   ) {
     struct NestedScanner* const scanner = (struct NestedScanner*)(payload);
-    return nested_scan(scanner, lexer, valid_symbols);
+#ifdef TLAPLUS_SCANNER_STATS
+    struct CountingLexer counting_lexer = create_counting_lexer(lexer);
+    const bool result = nested_scan(scanner, &counting_lexer.base, valid_symbols);
+    lexer->result_symbol = counting_lexer.base.result_symbol;
+    const struct Scanner* const context = nested_scanner_current_context(scanner);
+    scanner_stats_add(ScannerStat_SCAN_CALLS, 1);
+    scanner_stats_add(ScannerStat_TOKENS_EMITTED, result);
+    scanner_stats_max(ScannerStat_MAX_JLIST_DEPTH, context->jlists.size);
+    scanner_stats_max(ScannerStat_MAX_PROOF_DEPTH, context->proofs.size);
+    scanner_stats_max(ScannerStat_MAX_CONTEXT_DEPTH, scanner->context_depth);
+#else
+    const bool result = nested_scan(scanner, lexer, valid_symbols);
+#endif
+    // State is only ever modified when a token is emitted
+    scanner->is_cached_state_stale |= result;
+    return result;
+  }
+
+  // Sets the allocator for the memory of scanners created on the calling
+  // thread from now on, which each keep theirs until destroyed; a NULL
+  // allocate function restores ts_malloc and ts_free.
+  void tree_sitter_tlaplus_scanner_set_allocator(
+    void* (*const allocate)(void* payload, size_t size),
+    void (*const deallocate)(void* payload, void* pointer),
+    void* const payload
+  ) {
+    if (NULL == allocate) {
+      thread_scanner_allocator.allocate = default_scanner_allocate;
+      thread_scanner_allocator.deallocate = default_scanner_deallocate;
+      thread_scanner_allocator.payload = NULL;
+    } else {
+      thread_scanner_allocator.allocate = allocate;
+      thread_scanner_allocator.deallocate = deallocate;
+      thread_scanner_allocator.payload = payload;
+    }
+  }
+
+  // Gets the number of scanner statistics counters; zero unless the
+  // scanner was built with TLAPLUS_SCANNER_STATS defined.
+  size_t tree_sitter_tlaplus_scanner_stat_count() {
+#ifdef TLAPLUS_SCANNER_STATS
+    return ScannerStat_COUNT;
+#else
+    return 0;
+#endif
+  }
+
+  // Gets the name of the scanner statistics counter at the given index.
+  const char* tree_sitter_tlaplus_scanner_stat_name(size_t const index) {
+#ifdef TLAPLUS_SCANNER_STATS
+    return index < ScannerStat_COUNT ? scanner_stat_names[index] : NULL;
+#else
+    (void)index;
+    return NULL;
+#endif
+  }
+
+  // Gets the calling thread's value of the scanner statistics counter at
+  // the given index.
+  uint64_t tree_sitter_tlaplus_scanner_stat_value(size_t const index) {
+#ifdef TLAPLUS_SCANNER_STATS
+    return index < ScannerStat_COUNT ? scanner_stats[index] : 0;
+#else
+    (void)index;
+    return 0;
+#endif
+  }
+
+  // Resets the calling thread's scanner statistics counters to zero.
+  void tree_sitter_tlaplus_scanner_stats_reset() {
+#ifdef TLAPLUS_SCANNER_STATS
+    memset(scanner_stats, 0, sizeof(scanner_stats));
+#endif
   }
 
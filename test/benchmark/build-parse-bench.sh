@@ -0,0 +1,73 @@
+#!/bin/bash
+set -e
+
+CC=${CC:-clang}
+CXX=${CXX:-clang++}
+
+CFLAGS=${CFLAGS:-"-O2"}
+CXXFLAGS=${CXXFLAGS:-"-O2"}
+
+export CC
+export CXX
+export CFLAGS
+export CXXFLAGS
+
+bench_dir=test/benchmark
+lang_name="tlaplus"
+ts_lang="tree_sitter_${lang_name}"
+dependencies_dir=test/dependencies
+ts_dir=$dependencies_dir/tree-sitter
+src_dir="src"
+out_dir="${bench_dir}/out"
+mkdir -p $out_dir
+parser_out="${out_dir}/parser.o"
+scanner_out="${out_dir}/scanner.o"
+outline_out="${out_dir}/outline.o"
+index_out="${out_dir}/index.o"
+pool_out="${out_dir}/pool.o"
+
+if [ ! -f $ts_dir/lib/include/tree_sitter/api.h ]; then
+  echo "The tree-sitter runtime is missing; run \`git submodule update --init $ts_dir\`" >&2
+  exit 1
+fi
+
+if [ -z "$1" ]; then
+  echo "Building tree-sitter..."
+  pushd $ts_dir
+  make clean
+  make
+  popd
+fi
+
+# Timings include the generated lexer, so the parser is built with the
+# same flags as everything else; add -D TSTLAPLUS_OPTIMIZED_PARSER to
+# CFLAGS to have them take effect on it.
+echo "Building parser..."
+$CC $CFLAGS -I $src_dir -c $src_dir/parser.c -o $parser_out
+
+echo "Building scanner..."
+$CC $CFLAGS -I $src_dir -c $src_dir/scanner.c -o $scanner_out
+
+echo "Building outline..."
+$CC $CFLAGS -I $src_dir -c $src_dir/outline.c -o $outline_out
+
+echo "Building index..."
+$CC $CFLAGS -I $ts_dir/lib/include -c bindings/c/tree-sitter-tlaplus-index.c -o $index_out
+
+echo "Building parser pool..."
+$CC $CFLAGS -I $ts_dir/lib/include -c bindings/c/tree-sitter-tlaplus-pool.c -o $pool_out
+
+# Each driver is built into bench_<driver>_tlaplus, linked against the
+# grammar, the C library sources and the runtime; run them through
+# run-bench.sh
+objects="$parser_out $scanner_out $outline_out $index_out $pool_out"
+for driver in parse reparse corpus outline index query scaling nesting pool; do
+  echo "Building $driver benchmark..."
+  $CXX $CXXFLAGS -std=c++11 -pthread \
+    -I $ts_dir/lib/include \
+    -I $src_dir \
+    -I bindings/c \
+    -D TS_LANG=$ts_lang \
+    $bench_dir/$driver.cc $objects $ts_dir/libtree-sitter.a \
+    -o $out_dir/bench_${driver}_${lang_name}
+done
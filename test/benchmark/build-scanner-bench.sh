@@ -0,0 +1,41 @@
+#!/bin/bash
+set -e
+
+CC=${CC:-clang}
+CXX=${CXX:-clang++}
+
+CFLAGS=${CFLAGS:-"-O2"}
+CXXFLAGS=${CXXFLAGS:-"-O2"}
+
+bench_dir=test/benchmark
+lang_name="tlaplus"
+ts_lang="tree_sitter_${lang_name}"
+src_dir="src"
+out_dir="${bench_dir}/out"
+mkdir -p $out_dir
+parser_out="${out_dir}/parser.o"
+scanner_out="${out_dir}/scanner.o"
+
+# The parser is only needed for its tables, so skip optimizing it unless
+# PARSER_CFLAGS are given for the lex mode, which runs its generated lexer
+PARSER_CFLAGS=${PARSER_CFLAGS:-"-O0"}
+echo "Building parser..."
+$CC $PARSER_CFLAGS -I $src_dir -c $src_dir/parser.c -o $parser_out
+
+echo "Building scanner..."
+$CC $CFLAGS -D TREE_SITTER_REUSE_ALLOCATOR -I $src_dir -c $src_dir/scanner.c -o $scanner_out
+
+echo "Building scanner benchmark..."
+$CXX $CXXFLAGS -std=c++11 \
+  -I $src_dir \
+  -D TS_LANG=$ts_lang \
+  $bench_dir/scanner.cc $parser_out $scanner_out \
+  -o $out_dir/bench_scanner_${lang_name}
+
+# The outline corpus check needs no runtime either, only the outline
+echo "Building outline corpus check..."
+$CC $CFLAGS -I $src_dir -c $src_dir/outline.c -o ${out_dir}/outline.o
+$CXX $CXXFLAGS -std=c++11 \
+  -I bindings/c \
+  $bench_dir/outline_corpus.cc ${out_dir}/outline.o \
+  -o $out_dir/outline_corpus_${lang_name}
@@ -0,0 +1,207 @@
+// Parallel corpus parser. The given .tla files, or all .tla files under
+// the given directories, are spread over a work-stealing pool of threads
+// each with its own parser; files that fail to parse are listed, and wall
+// time and per-thread utilization are printed as key=value lines.
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "tree_sitter/api.h"
+
+extern "C" const TSLanguage *TS_LANG();
+
+struct Spec {
+  std::string path;
+  size_t bytes;
+};
+
+// Adds the file at the path, or every .tla file beneath it if a directory.
+static void collect_specs(std::string const &path, std::vector<Spec> &specs) {
+  struct stat info;
+  if (0 != stat(path.c_str(), &info)) {
+    fprintf(stderr, "Cannot read %s\n", path.c_str());
+    return;
+  }
+
+  if (S_ISDIR(info.st_mode)) {
+    DIR *dir = opendir(path.c_str());
+    if (!dir) return;
+    std::vector<std::string> children;
+    while (struct dirent *entry = readdir(dir)) {
+      std::string const name = entry->d_name;
+      if (name != "." && name != "..") children.push_back(path + "/" + name);
+    }
+    closedir(dir);
+    std::sort(children.begin(), children.end());
+    for (auto const &child : children) {
+      struct stat child_info;
+      if (0 != stat(child.c_str(), &child_info)) continue;
+      bool const is_spec = child.size() > 4 && 0 == child.compare(child.size() - 4, 4, ".tla");
+      if (S_ISDIR(child_info.st_mode) || is_spec) collect_specs(child, specs);
+    }
+  } else {
+    specs.push_back({path, static_cast<size_t>(info.st_size)});
+  }
+}
+
+// Spec indices owned by one worker. The owner takes from the front and
+// thieves from the back, so they only contend when one spec remains.
+struct WorkQueue {
+  std::mutex mutex;
+  std::deque<size_t> specs;
+
+  bool pop_front(size_t &spec) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (specs.empty()) return false;
+    spec = specs.front();
+    specs.pop_front();
+    return true;
+  }
+
+  bool pop_back(size_t &spec) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (specs.empty()) return false;
+    spec = specs.back();
+    specs.pop_back();
+    return true;
+  }
+};
+
+struct WorkerResult {
+  size_t files = 0;
+  size_t bytes = 0;
+  size_t steals = 0;
+  double busy_seconds = 0;
+  std::vector<size_t> failures;
+};
+
+// Parses specs from the worker's own queue, then steals from the others
+// until no work is left anywhere; no specs are added once workers start.
+static void run_worker(
+  size_t const id,
+  std::vector<Spec> const &specs,
+  std::vector<WorkQueue> &queues,
+  WorkerResult &result
+) {
+  TSParser *parser = ts_parser_new();
+  ts_parser_set_language(parser, TS_LANG());
+  for (;;) {
+    size_t spec = 0;
+    bool found = queues[id].pop_front(spec);
+    for (size_t i = 1; !found && i < queues.size(); i++) {
+      found = queues[(id + i) % queues.size()].pop_back(spec);
+      if (found) result.steals++;
+    }
+    if (!found) break;
+
+    auto const start = std::chrono::steady_clock::now();
+    auto file = std::ifstream(specs[spec].path, std::ios::binary);
+    std::string const text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    TSTree *tree = ts_parser_parse_string(parser, NULL, text.c_str(), text.size());
+    if (!file || !tree || ts_node_has_error(ts_tree_root_node(tree))) result.failures.push_back(spec);
+    if (tree) ts_tree_delete(tree);
+    result.busy_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.files++;
+    result.bytes += text.size();
+  }
+  ts_parser_delete(parser);
+}
+
+// Parses a thread count given with -j, which must be a whole number of at
+// least 1.
+static bool parse_thread_count(char const *arg, unsigned &threads) {
+  char *end = NULL;
+  errno = 0;
+  long const value = strtol(arg, &end, 10);
+  if (end == arg || '\0' != *end || 0 != errno || value < 1 || value > static_cast<long>(UINT_MAX)) return false;
+  threads = static_cast<unsigned>(value);
+  return true;
+}
+
+int main(int const argc, char const *const argv[]) {
+  unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+  int first_path = 1;
+  if (argc > 2 && std::string(argv[1]) == "-j") {
+    if (!parse_thread_count(argv[2], threads)) {
+      fprintf(stderr, "Invalid thread count: %s\nUsage: %s [-j threads] [file or directory...]\n", argv[2], argv[0]);
+      return 2;
+    }
+    first_path = 3;
+  }
+
+  // Paths are read one per line from stdin if none are given
+  std::vector<std::string> paths(argv + first_path, argv + argc);
+  if (paths.empty()) {
+    std::string line;
+    while (std::getline(std::cin, line)) {
+      if (!line.empty()) paths.push_back(line);
+    }
+  }
+
+  std::vector<Spec> specs;
+  for (auto const &path : paths) collect_specs(path, specs);
+  if (specs.empty()) {
+    fprintf(stderr, "Usage: %s [-j threads] [file or directory...]\n", argv[0]);
+    return 2;
+  }
+
+  TSParser *parser = ts_parser_new();
+  bool const language_ok = ts_parser_set_language(parser, TS_LANG());
+  ts_parser_delete(parser);
+  if (!language_ok) {
+    fprintf(stderr, "Incompatible language version\n");
+    return 1;
+  }
+
+  // Deal specs out largest first so the biggest files start early and
+  // stealing near the end only moves small ones
+  std::vector<size_t> order(specs.size());
+  for (size_t i = 0; i < order.size(); i++) order[i] = i;
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return specs[a].bytes > specs[b].bytes; });
+  std::vector<WorkQueue> queues(threads);
+  for (size_t i = 0; i < order.size(); i++) queues[i % threads].specs.push_back(order[i]);
+
+  std::vector<WorkerResult> results(threads);
+  std::vector<std::thread> workers;
+  auto const start = std::chrono::steady_clock::now();
+  for (unsigned i = 0; i < threads; i++) {
+    workers.emplace_back(run_worker, i, std::cref(specs), std::ref(queues), std::ref(results[i]));
+  }
+  for (auto &worker : workers) worker.join();
+  double const wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::vector<size_t> failures;
+  size_t bytes = 0;
+  double busy_seconds = 0;
+  for (unsigned i = 0; i < threads; i++) {
+    auto const &result = results[i];
+    printf(
+      "thread=%u files=%zu bytes=%zu steals=%zu busy_ms=%.3f utilization=%.3f\n",
+      i, result.files, result.bytes, result.steals, result.busy_seconds * 1e3,
+      result.busy_seconds / wall_seconds);
+    failures.insert(failures.end(), result.failures.begin(), result.failures.end());
+    bytes += result.bytes;
+    busy_seconds += result.busy_seconds;
+  }
+
+  std::sort(failures.begin(), failures.end());
+  for (size_t spec : failures) printf("failure=%s\n", specs[spec].path.c_str());
+  printf(
+    "aggregate=%u files=%zu bytes=%zu failures=%zu wall_ms=%.3f mb_per_s=%.3f utilization=%.3f\n",
+    threads, specs.size(), bytes, failures.size(), wall_seconds * 1e3, bytes / wall_seconds / 1e6,
+    busy_seconds / (wall_seconds * threads));
+  return failures.empty() ? 0 : 1;
+}
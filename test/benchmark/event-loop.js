@@ -0,0 +1,89 @@
+// Event loop latency while parsing the largest specs in the tlaplus/examples
+// submodule. Each mode prints the delay of the event loop as sampled every
+// millisecond, as key=value lines; pass -n <count> to change how many of
+// the largest specs are parsed. Build the Node.js binding first.
+
+const fs = require("fs");
+const path = require("path");
+const { monitorEventLoopDelay, performance } = require("perf_hooks");
+const tlaplus = require("../../bindings/node");
+
+function collectSpecs(dir, specs) {
+  for (const entry of fs.readdirSync(dir, { withFileTypes: true })) {
+    const child = path.join(dir, entry.name);
+    if (entry.isDirectory()) {
+      collectSpecs(child, specs);
+    } else if (entry.name.endsWith(".tla")) {
+      specs.push({ path: child, text: fs.readFileSync(child, "utf8") });
+    }
+  }
+  return specs;
+}
+
+// Runs the workload while sampling event loop delay
+async function measure(mode, specs, workload) {
+  const histogram = monitorEventLoopDelay({ resolution: 1 });
+  histogram.enable();
+  const start = performance.now();
+  await workload();
+  const wall = performance.now() - start;
+  histogram.disable();
+  const bytes = specs.reduce((total, spec) => total + Buffer.byteLength(spec.text), 0);
+  console.log(
+    `mode=${mode} files=${specs.length} bytes=${bytes} wall_ms=${wall.toFixed(3)}` +
+    ` delay_p50_ms=${(histogram.percentile(50) / 1e6).toFixed(3)}` +
+    ` delay_p99_ms=${(histogram.percentile(99) / 1e6).toFixed(3)}` +
+    ` delay_max_ms=${(histogram.max / 1e6).toFixed(3)}`);
+  return wall;
+}
+
+async function main() {
+  const countIndex = process.argv.indexOf("-n");
+  const count = countIndex < 0 ? 10 : parseInt(process.argv[countIndex + 1], 10);
+  const specs = collectSpecs(path.join(__dirname, "..", "examples", "external"), [])
+    .sort((a, b) => b.text.length - a.text.length)
+    .slice(0, count);
+  if (specs.length === 0) {
+    console.error("No specs found; clone the repo with the --recurse-submodules parameter");
+    process.exit(2);
+  }
+
+  // Warm the shared parser pool so parser creation is not measured
+  await Promise.all(specs.slice(0, 4).map((spec) => tlaplus.parseAsync(spec.text)));
+
+  const wall = await measure("async", specs, async () => {
+    for (const spec of specs) await tlaplus.parseAsync(spec.text);
+  });
+  await measure("async_concurrent", specs, () => Promise.all(specs.map((spec) => tlaplus.parseAsync(spec.text))));
+  await measure("idle", specs, () => new Promise((resolve) => setTimeout(resolve, wall)));
+
+  // Synchronous parsing for comparison, if the tree-sitter package is present
+  let Parser = null;
+  try {
+    Parser = require("tree-sitter");
+  } catch (_) {
+    console.log("mode=sync skipped=1");
+  }
+  if (Parser) {
+    const parser = new Parser();
+    parser.setLanguage(tlaplus);
+    await measure("sync", specs, async () => {
+      for (const spec of specs) {
+        parser.parse(spec.text);
+        await new Promise(setImmediate);
+      }
+    });
+  }
+
+  // Time from aborting a parse of the largest spec to its promise settling
+  const controller = new AbortController();
+  const parse = tlaplus.parseAsync(specs[0].text, null, { signal: controller.signal });
+  await new Promise((resolve) => setTimeout(resolve, 1));
+  const abortStart = performance.now();
+  controller.abort();
+  const cancelled = await parse.then(() => 0, () => 1);
+  console.log(
+    `mode=cancel cancelled=${cancelled} settle_ms=${(performance.now() - abortStart).toFixed(3)}`);
+}
+
+main();
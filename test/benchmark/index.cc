@@ -0,0 +1,193 @@
+// Definition & reference index check & benchmark. A comment is typed one
+// character at a time at the end of a line halfway through each given file,
+// then the text of that line before the comment is backspaced over from its
+// end, so definitions are edited, renamed and removed; after every keystroke
+// the tree is reparsed and the index updated, and the definition found for
+// every byte must match that of an index built afresh. Update latency is
+// reported against rebuilding the index and against running
+// queries/locals.scm over the tree.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#define TREE_SITTER_TLAPLUS_INDEX
+#include "tree-sitter-tlaplus.h"
+
+extern "C" const TSLanguage *TS_LANG();
+
+static char const typed[] = " \\* Typed into the spec by the index benchmark";
+
+static TSPoint point_at(std::string const &text, size_t const offset) {
+  TSPoint point = {0, 0};
+  for (size_t i = 0; i < offset; i++) {
+    if ('\n' == text[i]) {
+      point.row++;
+      point.column = 0;
+    } else {
+      point.column++;
+    }
+  }
+  return point;
+}
+
+static double median(std::vector<double> samples) {
+  std::sort(samples.begin(), samples.end());
+  return samples[samples.size() / 2];
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point const start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Counts the bytes whose definition differs between the two indexes.
+static size_t count_mismatches(TSTlaplusIndex const *actual, TSTlaplusIndex const *expected, size_t const length) {
+  size_t mismatches = 0;
+  for (uint32_t byte = 0; byte < length; byte++) {
+    TSTlaplusIndexRange actual_range = {0, 0}, expected_range = {0, 0};
+    bool const has_actual = tree_sitter_tlaplus_index_find_definition(actual, byte, &actual_range);
+    bool const has_expected = tree_sitter_tlaplus_index_find_definition(expected, byte, &expected_range);
+    if (has_actual != has_expected || actual_range.start_byte != expected_range.start_byte
+        || actual_range.end_byte != expected_range.end_byte) {
+      mismatches++;
+    }
+  }
+  return mismatches;
+}
+
+static std::string read_file(std::string const &path) {
+  auto file = std::ifstream(path, std::ios::binary);
+  return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+int main(int const argc, char const *const argv[]) {
+  int iterations = 10;
+  int first_file = 1;
+  if (argc > 2 && std::string(argv[1]) == "-n") {
+    iterations = atoi(argv[2]);
+    first_file = 3;
+  }
+
+  std::vector<std::string> paths(argv + first_file, argv + argc);
+  if (paths.empty()) {
+    std::string line;
+    while (std::getline(std::cin, line)) {
+      if (!line.empty()) paths.push_back(line);
+    }
+  }
+
+  if (paths.empty() || iterations < 1) {
+    fprintf(stderr, "Usage: %s [-n keystrokes] [file...]\n", argv[0]);
+    return 2;
+  }
+
+  TSParser *parser = ts_parser_new();
+  if (!ts_parser_set_language(parser, TS_LANG())) {
+    fprintf(stderr, "Incompatible language version\n");
+    return 1;
+  }
+
+  std::string const locals = read_file("queries/locals.scm");
+  uint32_t error_offset = 0;
+  TSQueryError error_type = TSQueryErrorNone;
+  TSQuery *query = ts_query_new(TS_LANG(), locals.c_str(), locals.size(), &error_offset, &error_type);
+  if (NULL == query) {
+    fprintf(stderr, "Invalid queries/locals.scm at byte %u\n", error_offset);
+    return 1;
+  }
+  TSQueryCursor *query_cursor = ts_query_cursor_new();
+
+  size_t total_mismatches = 0;
+  for (auto const &path : paths) {
+    std::string text = read_file(path);
+    size_t const middle = text.find('\n', text.size() / 2);
+    if (middle == std::string::npos) continue;
+
+    TSTree *tree = ts_parser_parse_string(parser, NULL, text.c_str(), text.size());
+    TSTlaplusIndex *index = tree_sitter_tlaplus_index_new();
+    if (!tree_sitter_tlaplus_index_update(index, NULL, tree, text.c_str())) {
+      fprintf(stderr, "%s: out of memory building the index\n", path.c_str());
+      return 1;
+    }
+
+    std::vector<double> updates, rebuilds, queries;
+    size_t mismatches = 0, rebuilt_units = 0;
+    TSTlaplusIndexStats stats = tree_sitter_tlaplus_index_stats(index);
+
+    // Replaces the removed bytes at the offset with the inserted ones,
+    // updating the index and checking it against one built afresh
+    auto const keystroke = [&](size_t const at, size_t const removed, std::string const &inserted) {
+      std::string const edited = text.substr(0, at) + inserted + text.substr(at + removed);
+      TSInputEdit edit;
+      edit.start_byte = at;
+      edit.old_end_byte = at + removed;
+      edit.new_end_byte = at + inserted.size();
+      edit.start_point = point_at(text, at);
+      edit.old_end_point = point_at(text, at + removed);
+      edit.new_end_point = point_at(edited, at + inserted.size());
+      ts_tree_edit(tree, &edit);
+      tree_sitter_tlaplus_index_edit(index, &edit);
+      TSTree *new_tree = ts_parser_parse_string(parser, tree, edited.c_str(), edited.size());
+
+      auto start = std::chrono::steady_clock::now();
+      bool const updated = tree_sitter_tlaplus_index_update(index, tree, new_tree, edited.c_str());
+      updates.push_back(seconds_since(start));
+      ts_tree_delete(tree);
+      tree = new_tree;
+      text = edited;
+
+      start = std::chrono::steady_clock::now();
+      TSTlaplusIndex *fresh = tree_sitter_tlaplus_index_new();
+      bool const built = tree_sitter_tlaplus_index_update(fresh, NULL, tree, text.c_str());
+      rebuilds.push_back(seconds_since(start));
+      if (!updated || !built) {
+        fprintf(stderr, "%s: out of memory updating the index\n", path.c_str());
+        exit(1);
+      }
+
+      start = std::chrono::steady_clock::now();
+      ts_query_cursor_exec(query_cursor, query, ts_tree_root_node(tree));
+      TSQueryMatch match;
+      while (ts_query_cursor_next_match(query_cursor, &match)) {}
+      queries.push_back(seconds_since(start));
+
+      stats = tree_sitter_tlaplus_index_stats(index);
+      rebuilt_units += stats.rebuilt_units;
+      mismatches += count_mismatches(index, fresh, text.size());
+      tree_sitter_tlaplus_index_delete(fresh);
+    };
+
+    for (int i = 0; i < iterations; i++) {
+      keystroke(middle + i, 0, std::string(1, typed[i % (sizeof typed - 1)]));
+    }
+    size_t const line_start = text.rfind('\n', middle > 0 ? middle - 1 : 0);
+    size_t const backspaces = line_start == std::string::npos ? middle : middle - line_start - 1;
+    for (size_t i = 0; i < backspaces && i < static_cast<size_t>(iterations); i++) {
+      keystroke(middle - i - 1, 1, "");
+    }
+
+    size_t const keystrokes = updates.size();
+    double const update = median(updates);
+    double const rebuild = median(rebuilds);
+    printf(
+      "file=%s bytes=%zu keystrokes=%zu units=%u definitions=%u references=%u rebuilt_units=%.1f"
+      " update_ms=%.3f rebuild_ms=%.3f locals_query_ms=%.3f speedup=%.1f mismatches=%zu\n",
+      path.c_str(), text.size(), keystrokes, stats.units, stats.definitions, stats.references,
+      static_cast<double>(rebuilt_units) / keystrokes, update * 1e3, rebuild * 1e3,
+      median(queries) * 1e3, rebuild / update, mismatches);
+    if (mismatches > 0) fprintf(stderr, "%s: %zu bytes resolve differently after updates\n", path.c_str(), mismatches);
+    total_mismatches += mismatches;
+
+    tree_sitter_tlaplus_index_delete(index);
+    ts_tree_delete(tree);
+  }
+
+  ts_query_cursor_delete(query_cursor);
+  ts_query_delete(query);
+  ts_parser_delete(parser);
+  return 0 == total_mismatches ? 0 : 1;
+}
@@ -0,0 +1,202 @@
+// Deep nesting benchmark. Specs are generated nesting one construct ever
+// deeper, then parsed, reporting time, parse steps, peak memory, and the
+// largest serialized scanner state per depth. Nesting the scanner tracks
+// (jlists, proofs, PlusCal contexts) is bounded by the size of its state,
+// so past that depth specs parse with errors but must not slow down:
+// exits with an error if parse steps grow with depth faster than the
+// exponent limit, or the scanner state outgrows its buffer.
+//  * conjunction: jlists nested by following each bullet with another, on
+//    one line, so bullet columns also run past what the scanner can store
+//  * proof: proof steps nested to level <depth>, one step per line
+//  * pcal: PlusCal if statements nested in C syntax
+//  * parens: parenthesized expressions
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include "tree_sitter/api.h"
+#include "tree_sitter/parser.h"
+
+extern "C" const TSLanguage *TS_LANG();
+
+// The language is copied with its external scanner serializer wrapped so
+// the largest state written by the runtime can be tracked.
+static unsigned max_state_bytes = 0;
+static unsigned (*language_serialize)(void *, char *) = nullptr;
+static unsigned tracking_serialize(void *payload, char *buffer) {
+  unsigned const length = language_serialize(payload, buffer);
+  max_state_bytes = std::max(max_state_bytes, length);
+  return length;
+}
+
+static const TSLanguage *tracking_language() {
+  static TSLanguage language = *TS_LANG();
+  if (!language_serialize) {
+    language_serialize = language.external_scanner.serialize;
+    language.external_scanner.serialize = tracking_serialize;
+  }
+  return &language;
+}
+
+static size_t peak_rss_kb() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return static_cast<size_t>(usage.ru_maxrss) / 1024;
+#else
+  return static_cast<size_t>(usage.ru_maxrss);
+#endif
+}
+
+static void count_parse_step(void *payload, TSLogType type, const char *) {
+  if (TSLogTypeParse == type) (*static_cast<size_t *>(payload))++;
+}
+
+static double median(std::vector<double> samples) {
+  std::sort(samples.begin(), samples.end());
+  return samples[samples.size() / 2];
+}
+
+// Slope of the least squares line through the points on a log-log scale.
+static double fit_exponent(std::vector<double> const &sizes, std::vector<double> const &costs) {
+  double sum_x = 0, sum_y = 0, sum_xx = 0, sum_xy = 0;
+  size_t const n = sizes.size();
+  for (size_t i = 0; i < n; i++) {
+    double const x = std::log(sizes[i]);
+    double const y = std::log(std::max(costs[i], 1e-9));
+    sum_x += x;
+    sum_y += y;
+    sum_xx += x * x;
+    sum_xy += x * y;
+  }
+  double const denominator = n * sum_xx - sum_x * sum_x;
+  return 0 == denominator ? 0 : (n * sum_xy - sum_x * sum_y) / denominator;
+}
+
+static std::string conjunction(size_t const depth) {
+  std::string body;
+  for (size_t i = 0; i < depth; i++) body += "/\\ ";
+  return "---- MODULE Nest ----\nop == " + body + "TRUE\n====\n";
+}
+
+static std::string proof(size_t const depth) {
+  std::string steps;
+  for (size_t i = 1; i <= depth; i++) {
+    steps += "<" + std::to_string(i) + ">1. TRUE\n";
+  }
+  for (size_t i = depth; i >= 1; i--) {
+    steps += "<" + std::to_string(i) + ">2. QED\n";
+  }
+  return "---- MODULE Nest ----\nTHEOREM TRUE\n" + steps + "====\n";
+}
+
+static std::string pcal(size_t const depth) {
+  std::string body;
+  for (size_t i = 0; i < depth; i++) body += "if (TRUE) { ";
+  body += "skip;";
+  for (size_t i = 0; i < depth; i++) body += " }";
+  return "---- MODULE Nest ----\n(* --algorithm Nest { { " + body + " } } *)\n====\n";
+}
+
+static std::string parens(size_t const depth) {
+  return "---- MODULE Nest ----\nop == " + std::string(depth, '(') + "TRUE" + std::string(depth, ')') + "\n====\n";
+}
+
+struct Dimension {
+  char const *name;
+  std::string (*generate)(size_t);
+};
+
+static Dimension const dimensions[] = {
+  {"conjunction", conjunction}, {"proof", proof}, {"pcal", pcal}, {"parens", parens}
+};
+
+int main(int const argc, char const *const argv[]) {
+  int iterations = 5;
+  double limit = 1.5;
+  std::vector<size_t> depths;
+  std::vector<std::string> names;
+  for (int i = 1; i < argc; i++) {
+    std::string const arg = argv[i];
+    if (arg == "-n" && i + 1 < argc) {
+      iterations = atoi(argv[++i]);
+    } else if (arg == "-d" && i + 1 < argc) {
+      depths.push_back(strtoul(argv[++i], NULL, 10));
+    } else if (arg == "-e" && i + 1 < argc) {
+      limit = atof(argv[++i]);
+    } else {
+      names.push_back(arg);
+    }
+  }
+  if (depths.empty()) depths = {10, 100, 1000, 10000};
+  std::sort(depths.begin(), depths.end());
+
+  if (iterations < 1 || 0 == depths.front()) {
+    fprintf(stderr, "Usage: %s [-n iterations] [-d depth]... [-e exponent limit] [dimension...]\n", argv[0]);
+    return 2;
+  }
+
+  TSParser *parser = ts_parser_new();
+  if (!ts_parser_set_language(parser, tracking_language())) {
+    fprintf(stderr, "Incompatible language version\n");
+    return 1;
+  }
+
+  size_t failures = 0;
+  for (auto const &dimension : dimensions) {
+    if (!names.empty() && std::find(names.begin(), names.end(), dimension.name) == names.end()) continue;
+
+    std::vector<double> sizes, steps;
+    for (size_t const depth : depths) {
+      std::string const text = dimension.generate(depth);
+
+      size_t step_count = 0;
+      TSLogger logger = {&step_count, count_parse_step};
+      ts_parser_set_logger(parser, logger);
+      max_state_bytes = 0;
+      TSTree *tree = ts_parser_parse_string(parser, NULL, text.c_str(), text.size());
+      bool const has_error = ts_node_has_error(ts_tree_root_node(tree));
+      ts_tree_delete(tree);
+      ts_parser_set_logger(parser, TSLogger{NULL, NULL});
+
+      std::vector<double> samples;
+      for (int i = 0; i < iterations; i++) {
+        auto const start = std::chrono::steady_clock::now();
+        tree = ts_parser_parse_string(parser, NULL, text.c_str(), text.size());
+        samples.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        ts_tree_delete(tree);
+      }
+
+      double const seconds = median(samples);
+      printf(
+        "dimension=%s depth=%zu bytes=%zu errors=%d steps=%zu parse_ms=%.3f us_per_level=%.3f"
+        " max_state_bytes=%u peak_rss_kb=%zu\n",
+        dimension.name, depth, text.size(), has_error ? 1 : 0, step_count, seconds * 1e3,
+        seconds * 1e6 / depth, max_state_bytes, peak_rss_kb());
+      if (max_state_bytes > TREE_SITTER_SERIALIZATION_BUFFER_SIZE) {
+        fprintf(stderr, "%s: scanner state of %u bytes at depth %zu overflows its buffer\n",
+          dimension.name, max_state_bytes, depth);
+        failures++;
+      }
+      sizes.push_back(static_cast<double>(depth));
+      steps.push_back(static_cast<double>(step_count));
+    }
+
+    double const exponent = fit_exponent(sizes, steps);
+    printf("dimension=%s step_exponent=%.2f\n", dimension.name, exponent);
+    if (sizes.size() > 1 && exponent > limit) {
+      fprintf(stderr, "%s: parse steps grow with depth with exponent %.2f, over the limit of %.2f\n",
+        dimension.name, exponent, limit);
+      failures++;
+    }
+  }
+
+  ts_parser_delete(parser);
+  return 0 == failures ? 0 : 1;
+}
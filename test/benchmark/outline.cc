@@ -0,0 +1,237 @@
+// Outline check & benchmark. Every given file is outlined and also fully
+// parsed; the outline must match the one read off the parse tree, and
+// both are timed so the speedup of the outline can be tracked. Results
+// are printed as key=value lines and mismatches are listed on stderr.
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "tree_sitter/api.h"
+#include "tree-sitter-tlaplus.h"
+
+extern "C" const TSLanguage *TS_LANG();
+
+static char const *const kind_names[] = {
+  "module", "extends", "instance", "operator", "theorem", "constant", "variable"
+};
+
+struct Entry {
+  TSTlaplusOutlineKind kind;
+  uint32_t module_depth;
+  bool local;
+  std::string name;
+
+  bool operator==(Entry const &other) const {
+    return kind == other.kind && module_depth == other.module_depth
+      && local == other.local && name == other.name;
+  }
+};
+
+static std::string describe(std::vector<Entry> const &entries, size_t const index) {
+  if (index >= entries.size()) return "(none)";
+  Entry const &entry = entries[index];
+  return std::string(kind_names[entry.kind]) + " " + entry.name
+    + " depth=" + std::to_string(entry.module_depth) + (entry.local ? " local" : "");
+}
+
+struct Collector {
+  std::string const *text;
+  std::vector<Entry> entries;
+};
+
+static void collect(void *payload, TSTlaplusOutlineEntry const *entry) {
+  Collector *collector = static_cast<Collector *>(payload);
+  collector->entries.push_back(Entry{
+    entry->kind, entry->module_depth, entry->local,
+    collector->text->substr(entry->start_byte, entry->end_byte - entry->start_byte)});
+}
+
+// Reads the expected outline off the full parse tree.
+class TreeOutline {
+ public:
+  TreeOutline(std::string const &text, std::vector<Entry> &entries)
+    : text(text), entries(entries) {}
+
+  void root(TSNode const node) {
+    for (uint32_t i = 0; i < ts_node_named_child_count(node); i++) {
+      TSNode const child = ts_node_named_child(node, i);
+      if (is(child, "module")) module(child, 0);
+    }
+  }
+
+ private:
+  std::string const &text;
+  std::vector<Entry> &entries;
+
+  static bool is(TSNode const node, char const *type) {
+    return !ts_node_is_null(node) && 0 == strcmp(ts_node_type(node), type);
+  }
+
+  static TSNode field(TSNode const node, char const *name) {
+    return ts_node_child_by_field_name(node, name, static_cast<uint32_t>(strlen(name)));
+  }
+
+  static TSNode first_named_child(TSNode const node, char const *type) {
+    for (uint32_t i = 0; i < ts_node_named_child_count(node); i++) {
+      TSNode const child = ts_node_named_child(node, i);
+      if (is(child, type)) return child;
+    }
+    return TSNode{};
+  }
+
+  void add(TSTlaplusOutlineKind const kind, uint32_t const depth, bool const local, TSNode const name) {
+    if (ts_node_is_null(name)) return;
+    uint32_t const start = ts_node_start_byte(name);
+    entries.push_back(Entry{kind, depth, local, text.substr(start, ts_node_end_byte(name) - start)});
+  }
+
+  void module(TSNode const node, uint32_t const depth) {
+    add(TSTlaplusOutlineModule, depth, false, field(node, "name"));
+    for (uint32_t i = 0; i < ts_node_named_child_count(node); i++) {
+      TSNode const child = ts_node_named_child(node, i);
+      if (!ts_node_is_extra(child)) unit(child, depth, false);
+    }
+  }
+
+  void unit(TSNode const node, uint32_t const depth, bool const local) {
+    uint32_t const child_count = ts_node_named_child_count(node);
+    if (is(node, "extends")) {
+      for (uint32_t i = 0; i < child_count; i++) {
+        TSNode const child = ts_node_named_child(node, i);
+        if (is(child, "identifier_ref")) add(TSTlaplusOutlineExtends, depth, false, child);
+      }
+    } else if (is(node, "instance")) {
+      add(TSTlaplusOutlineInstance, depth, local, first_named_child(node, "identifier_ref"));
+    } else if (is(node, "module_definition")) {
+      add(TSTlaplusOutlineInstance, depth, local,
+        first_named_child(first_named_child(node, "instance"), "identifier_ref"));
+    } else if (is(node, "local_definition") && child_count > 0) {
+      unit(ts_node_named_child(node, 0), depth, true);
+    } else if (is(node, "operator_definition")) {
+      add(TSTlaplusOutlineOperator, depth, local, field(node, "name"));
+    } else if (is(node, "theorem")) {
+      add(TSTlaplusOutlineTheorem, depth, false, field(node, "name"));
+    } else if (is(node, "constant_declaration")) {
+      for (uint32_t i = 0; i < child_count; i++) {
+        TSNode const child = ts_node_named_child(node, i);
+        if (is(child, "identifier")) {
+          add(TSTlaplusOutlineConstant, depth, false, child);
+        } else if (is(child, "operator_declaration")) {
+          TSNode const name = field(child, "name");
+          add(TSTlaplusOutlineConstant, depth, false,
+            ts_node_is_null(name) ? first_named_child(child, "identifier") : name);
+        }
+      }
+    } else if (is(node, "variable_declaration")) {
+      for (uint32_t i = 0; i < child_count; i++) {
+        TSNode const child = ts_node_named_child(node, i);
+        if (is(child, "identifier")) add(TSTlaplusOutlineVariable, depth, false, child);
+      }
+    } else if (is(node, "module")) {
+      module(node, depth + 1);
+    }
+  }
+};
+
+struct Result {
+  size_t bytes = 0;
+  size_t entries = 0;
+  size_t mismatches = 0;
+  size_t errors = 0;
+  double parse_seconds = 0;
+  double outline_seconds = 0;
+};
+
+static void report(char const *label, std::string const &name, Result const &result) {
+  printf(
+    "%s=%s bytes=%zu entries=%zu mismatches=%zu errors=%zu"
+    " parse_mb_per_s=%.3f outline_mb_per_s=%.3f speedup=%.1f\n",
+    label, name.c_str(), result.bytes, result.entries, result.mismatches, result.errors,
+    result.bytes / result.parse_seconds / 1e6, result.bytes / result.outline_seconds / 1e6,
+    result.parse_seconds / result.outline_seconds);
+}
+
+int main(int const argc, char const *const argv[]) {
+  int iterations = 10;
+  int first_file = 1;
+  if (argc > 2 && std::string(argv[1]) == "-n") {
+    iterations = atoi(argv[2]);
+    first_file = 3;
+  }
+
+  // Paths are read one per line from stdin if none are given, since
+  // corpora like the tlaplus/examples repo exceed command line limits.
+  std::vector<std::string> paths(argv + first_file, argv + argc);
+  if (paths.empty()) {
+    std::string line;
+    while (std::getline(std::cin, line)) {
+      if (!line.empty()) paths.push_back(line);
+    }
+  }
+
+  if (paths.empty() || iterations < 1) {
+    fprintf(stderr, "Usage: %s [-n iterations] [file...]\n", argv[0]);
+    return 2;
+  }
+
+  TSParser *parser = ts_parser_new();
+  if (!ts_parser_set_language(parser, TS_LANG())) {
+    fprintf(stderr, "Incompatible language version\n");
+    return 1;
+  }
+
+  Result total;
+  for (auto const &path : paths) {
+    auto file = std::ifstream(path, std::ios::binary);
+    std::string const text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    uint32_t const length = static_cast<uint32_t>(text.size());
+    Result result;
+    std::vector<Entry> expected;
+    Collector collector{&text, {}};
+    for (int i = 0; i < iterations; i++) {
+      auto const parse_start = std::chrono::steady_clock::now();
+      TSTree *tree = ts_parser_parse_string(parser, NULL, text.c_str(), length);
+      auto const outline_start = std::chrono::steady_clock::now();
+      collector.entries.clear();
+      tree_sitter_tlaplus_outline(text.c_str(), length, collect, &collector);
+      auto const outline_end = std::chrono::steady_clock::now();
+      result.parse_seconds += std::chrono::duration<double>(outline_start - parse_start).count();
+      result.outline_seconds += std::chrono::duration<double>(outline_end - outline_start).count();
+      result.bytes += text.size();
+      if (0 == i) {
+        TSNode const root = ts_tree_root_node(tree);
+        result.errors = ts_node_has_error(root) ? 1 : 0;
+        TreeOutline(text, expected).root(root);
+      }
+      ts_tree_delete(tree);
+    }
+
+    // The outline of a tree with errors is not checked, since recovery
+    // decides which units survive
+    std::vector<Entry> const &actual = collector.entries;
+    result.entries = actual.size();
+    if (0 == result.errors && !(actual == expected)) {
+      result.mismatches = 1;
+      size_t index = 0;
+      while (index < actual.size() && index < expected.size() && actual[index] == expected[index]) index++;
+      fprintf(stderr, "%s: entry %zu is %s, expected %s\n",
+        path.c_str(), index, describe(actual, index).c_str(), describe(expected, index).c_str());
+    }
+
+    report("file", path, result);
+    total.bytes += result.bytes;
+    total.entries += result.entries;
+    total.mismatches += result.mismatches;
+    total.errors += result.errors;
+    total.parse_seconds += result.parse_seconds;
+    total.outline_seconds += result.outline_seconds;
+  }
+
+  report("aggregate", std::to_string(paths.size()), total);
+  ts_parser_delete(parser);
+  return 0 == total.mismatches ? 0 : 1;
+}
@@ -0,0 +1,293 @@
+// Outline corpus check. The outline of the source of every test in the
+// given tree-sitter corpus files must match the one read off the test's
+// expected tree. Expected trees hold no text, so entries are compared by
+// kind, module depth and whether they are LOCAL; tests expecting errors
+// are skipped. Needs no tree-sitter runtime, so it is built by
+// build-scanner-bench.sh. Results are printed as key=value lines and
+// mismatches are listed on stderr.
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "tree-sitter-tlaplus.h"
+
+static char const *const kind_names[] = {
+  "module", "extends", "instance", "operator", "theorem", "constant", "variable"
+};
+
+struct Entry {
+  TSTlaplusOutlineKind kind;
+  uint32_t module_depth;
+  bool local;
+
+  bool operator==(Entry const &other) const {
+    return kind == other.kind && module_depth == other.module_depth && local == other.local;
+  }
+};
+
+static std::string describe(std::vector<Entry> const &entries, size_t const index) {
+  if (index >= entries.size()) return "(none)";
+  Entry const &entry = entries[index];
+  return std::string(kind_names[entry.kind])
+    + " depth=" + std::to_string(entry.module_depth) + (entry.local ? " local" : "");
+}
+
+static void collect(void *payload, TSTlaplusOutlineEntry const *entry) {
+  static_cast<std::vector<Entry> *>(payload)->push_back(Entry{entry->kind, entry->module_depth, entry->local});
+}
+
+// A node of an expected tree, which lists named nodes only.
+struct Node {
+  std::string type;
+  std::vector<std::unique_ptr<Node>> children;
+};
+
+// Reads the S-expression of an expected tree, ignoring field names.
+static std::unique_ptr<Node> read_tree(std::string const &text, size_t &position) {
+  while (position < text.size() && '(' != text[position]) position++;
+  if (position >= text.size()) return nullptr;
+  position++;
+  auto node = std::unique_ptr<Node>(new Node());
+  while (position < text.size() && !isspace(static_cast<unsigned char>(text[position]))
+      && '(' != text[position] && ')' != text[position]) {
+    node->type += text[position++];
+  }
+  while (position < text.size()) {
+    char const c = text[position];
+    if (')' == c) {
+      position++;
+      break;
+    } else if ('(' == c) {
+      auto child = read_tree(text, position);
+      if (child) node->children.push_back(std::move(child));
+    } else {
+      position++;
+    }
+  }
+  return node;
+}
+
+// Reads the expected outline off an expected tree, the way outline.cc
+// reads it off a parse tree; names are found by position in place of the
+// fields the expected trees leave out.
+class TreeOutline {
+ public:
+  explicit TreeOutline(std::vector<Entry> &entries) : entries(entries) {}
+
+  void root(Node const &node) {
+    for (auto const &child : node.children) {
+      if (is(child.get(), "module")) module(*child, 0);
+    }
+  }
+
+ private:
+  std::vector<Entry> &entries;
+
+  static bool is(Node const *node, char const *type) {
+    return nullptr != node && node->type == type;
+  }
+
+  static bool is_op_symbol(Node const *node) {
+    return is(node, "prefix_op_symbol") || is(node, "infix_op_symbol") || is(node, "postfix_op_symbol");
+  }
+
+  static Node const *first_child(Node const *node, char const *type) {
+    if (nullptr == node) return nullptr;
+    for (auto const &child : node->children) {
+      if (is(child.get(), type)) return child.get();
+    }
+    return nullptr;
+  }
+
+  void add(TSTlaplusOutlineKind const kind, uint32_t const depth, bool const local, Node const *name) {
+    if (nullptr != name) entries.push_back(Entry{kind, depth, local});
+  }
+
+  void module(Node const &node, uint32_t const depth) {
+    add(TSTlaplusOutlineModule, depth, false, first_child(&node, "identifier"));
+    for (auto const &child : node.children) unit(*child, depth, false);
+  }
+
+  void unit(Node const &node, uint32_t const depth, bool const local) {
+    if (is(&node, "extends")) {
+      for (auto const &child : node.children) {
+        if (is(child.get(), "identifier_ref")) add(TSTlaplusOutlineExtends, depth, false, child.get());
+      }
+    } else if (is(&node, "instance")) {
+      add(TSTlaplusOutlineInstance, depth, local, first_child(&node, "identifier_ref"));
+    } else if (is(&node, "module_definition")) {
+      add(TSTlaplusOutlineInstance, depth, local, first_child(first_child(&node, "instance"), "identifier_ref"));
+    } else if (is(&node, "local_definition") && !node.children.empty()) {
+      unit(*node.children[0], depth, true);
+    } else if (is(&node, "operator_definition")) {
+      // Named by its first child, or by the operator symbol of a prefix,
+      // infix or postfix definition
+      Node const *name = node.children.empty() ? nullptr : node.children[0].get();
+      for (auto const &child : node.children) {
+        if (is(child.get(), "def_eq")) break;
+        if (is_op_symbol(child.get())) name = child.get();
+      }
+      add(TSTlaplusOutlineOperator, depth, local, name);
+    } else if (is(&node, "theorem")) {
+      // Named only if written NAME == statement
+      bool const named = node.children.size() > 1
+        && is(node.children[0].get(), "identifier") && is(node.children[1].get(), "def_eq");
+      add(TSTlaplusOutlineTheorem, depth, false, named ? node.children[0].get() : nullptr);
+    } else if (is(&node, "constant_declaration")) {
+      for (auto const &child : node.children) {
+        if (is(child.get(), "identifier")) {
+          add(TSTlaplusOutlineConstant, depth, false, child.get());
+        } else if (is(child.get(), "operator_declaration")) {
+          Node const *name = first_child(child.get(), "identifier");
+          for (auto const &part : child->children) {
+            if (is_op_symbol(part.get())) name = part.get();
+          }
+          add(TSTlaplusOutlineConstant, depth, false, name);
+        }
+      }
+    } else if (is(&node, "variable_declaration")) {
+      for (auto const &child : node.children) {
+        if (is(child.get(), "identifier")) add(TSTlaplusOutlineVariable, depth, false, child.get());
+      }
+    } else if (is(&node, "module")) {
+      module(node, depth + 1);
+    }
+  }
+};
+
+struct Test {
+  std::string name;
+  std::string source;
+  std::string expected;
+};
+
+// A header or divider line: a run of at least three c optionally followed
+// by the suffix tying it to its test, as in ===|||.
+static bool is_delimiter(std::string const &line, char const c, std::string &suffix) {
+  size_t length = 0;
+  while (length < line.size() && c == line[length]) length++;
+  if (length < 3) return false;
+  std::string const rest = line.substr(length);
+  if (rest.find_first_of(" \t") != std::string::npos) return false;
+  suffix = rest;
+  return true;
+}
+
+// Splits a corpus file into its tests: a header line, the test name and
+// another header line, then the source up to its divider line, then the
+// expected tree up to the next header.
+static std::vector<Test> read_tests(std::string const &path) {
+  std::ifstream file(path, std::ios::binary);
+  std::vector<std::string> lines;
+  std::string line;
+  while (std::getline(file, line)) {
+    if (!line.empty() && '\r' == line.back()) line.pop_back();
+    lines.push_back(line);
+  }
+
+  std::vector<Test> tests;
+  std::string suffix;
+  size_t i = 0;
+  while (i < lines.size()) {
+    if (!is_delimiter(lines[i], '=', suffix) || i + 2 >= lines.size()) {
+      i++;
+      continue;
+    }
+    Test test;
+    test.name = lines[i + 1];
+    i += 2;
+    std::string other;
+    while (i < lines.size() && !(is_delimiter(lines[i], '=', other) && other == suffix)) i++;
+    i++;
+    while (i < lines.size() && !(is_delimiter(lines[i], '-', other) && other == suffix)) {
+      test.source += lines[i++] + "\n";
+    }
+    i++;
+    while (i < lines.size() && !(is_delimiter(lines[i], '=', other) && other == suffix)) {
+      test.expected += lines[i++] + "\n";
+    }
+    tests.push_back(test);
+  }
+  return tests;
+}
+
+struct Result {
+  size_t tests = 0;
+  size_t skipped = 0;
+  size_t bytes = 0;
+  size_t entries = 0;
+  size_t mismatches = 0;
+  double seconds = 0;
+};
+
+static void report(char const *label, std::string const &name, Result const &result) {
+  printf(
+    "%s=%s tests=%zu skipped=%zu bytes=%zu entries=%zu mismatches=%zu outline_mb_per_s=%.3f\n",
+    label, name.c_str(), result.tests, result.skipped, result.bytes, result.entries, result.mismatches,
+    result.seconds > 0 ? result.bytes / result.seconds / 1e6 : 0.0);
+}
+
+int main(int const argc, char const *const argv[]) {
+  int iterations = 100;
+  int first_file = 1;
+  if (argc > 2 && std::string(argv[1]) == "-n") {
+    iterations = atoi(argv[2]);
+    first_file = 3;
+  }
+  if (first_file >= argc || iterations < 1) {
+    fprintf(stderr, "Usage: %s [-n iterations] corpus-file...\n", argv[0]);
+    return 2;
+  }
+
+  Result total;
+  for (int f = first_file; f < argc; f++) {
+    std::string const path = argv[f];
+    Result result;
+    for (Test const &test : read_tests(path)) {
+      result.tests++;
+      if (test.expected.find("(ERROR") != std::string::npos || test.expected.find("(MISSING") != std::string::npos) {
+        result.skipped++;
+        continue;
+      }
+
+      std::vector<Entry> expected;
+      size_t position = 0;
+      auto tree = read_tree(test.expected, position);
+      if (tree) TreeOutline(expected).root(*tree);
+
+      std::vector<Entry> actual;
+      uint32_t const length = static_cast<uint32_t>(test.source.size());
+      auto const start = std::chrono::steady_clock::now();
+      for (int i = 0; i < iterations; i++) {
+        actual.clear();
+        tree_sitter_tlaplus_outline(test.source.c_str(), length, collect, &actual);
+      }
+      result.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      result.bytes += static_cast<size_t>(length) * iterations;
+      result.entries += actual.size();
+
+      if (!(actual == expected)) {
+        result.mismatches++;
+        size_t index = 0;
+        while (index < actual.size() && index < expected.size() && actual[index] == expected[index]) index++;
+        fprintf(stderr, "%s: %s: entry %zu is %s, expected %s\n", path.c_str(), test.name.c_str(),
+          index, describe(actual, index).c_str(), describe(expected, index).c_str());
+      }
+    }
+
+    report("file", path, result);
+    total.tests += result.tests;
+    total.skipped += result.skipped;
+    total.bytes += result.bytes;
+    total.entries += result.entries;
+    total.mismatches += result.mismatches;
+    total.seconds += result.seconds;
+  }
+
+  report("aggregate", std::to_string(argc - first_file), total);
+  return 0 == total.mismatches ? 0 : 1;
+}
@@ -0,0 +1,151 @@
+// Parse throughput benchmark. Every given file is parsed repeatedly with
+// the full tree-sitter runtime; per-file and aggregate results are printed
+// as key=value lines so runs can be diffed when upgrading the grammar.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include "tree_sitter/api.h"
+#include "tree_sitter/parser.h"
+
+extern "C" const TSLanguage *TS_LANG();
+
+// The language is copied with its external scanner entry point wrapped so
+// calls made by the runtime can be counted.
+static size_t scanner_call_count = 0;
+static bool (*language_scan)(void *, TSLexer *, const bool *) = nullptr;
+static bool counting_scan(void *payload, TSLexer *lexer, const bool *valid_symbols) {
+  scanner_call_count++;
+  return language_scan(payload, lexer, valid_symbols);
+}
+
+static const TSLanguage *counting_language() {
+  static TSLanguage language = *TS_LANG();
+  if (!language_scan) {
+    language_scan = language.external_scanner.scan;
+    language.external_scanner.scan = counting_scan;
+  }
+  return &language;
+}
+
+static size_t peak_rss_kb() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return static_cast<size_t>(usage.ru_maxrss) / 1024;
+#else
+  return static_cast<size_t>(usage.ru_maxrss);
+#endif
+}
+
+// Number of leaf nodes in the tree, named or not; a proxy for token count.
+static size_t count_tokens(TSTree *tree) {
+  size_t tokens = 0;
+  TSTreeCursor cursor = ts_tree_cursor_new(ts_tree_root_node(tree));
+  for (;;) {
+    if (ts_tree_cursor_goto_first_child(&cursor)) continue;
+    tokens++;
+    while (!ts_tree_cursor_goto_next_sibling(&cursor)) {
+      if (!ts_tree_cursor_goto_parent(&cursor)) {
+        ts_tree_cursor_delete(&cursor);
+        return tokens;
+      }
+    }
+  }
+}
+
+static double percentile(std::vector<double> samples, double const fraction) {
+  if (samples.empty()) return 0;
+  std::sort(samples.begin(), samples.end());
+  size_t const index = static_cast<size_t>(fraction * (samples.size() - 1) + 0.5);
+  return samples[index];
+}
+
+struct Result {
+  size_t bytes = 0;
+  size_t tokens = 0;
+  size_t scanner_calls = 0;
+  size_t errors = 0;
+  double seconds = 0;
+  std::vector<double> latencies;
+};
+
+static void report(char const *label, std::string const &name, Result const &result, size_t const rss_kb) {
+  printf(
+    "%s=%s bytes=%zu tokens=%zu scanner_calls=%zu errors=%zu"
+    " mb_per_s=%.3f tokens_per_s=%.0f p50_ms=%.3f p99_ms=%.3f peak_rss_kb=%zu\n",
+    label, name.c_str(), result.bytes, result.tokens, result.scanner_calls, result.errors,
+    result.bytes / result.seconds / 1e6, result.tokens / result.seconds,
+    percentile(result.latencies, 0.5) * 1e3, percentile(result.latencies, 0.99) * 1e3,
+    rss_kb);
+}
+
+int main(int const argc, char const *const argv[]) {
+  int iterations = 10;
+  int first_file = 1;
+  if (argc > 2 && std::string(argv[1]) == "-n") {
+    iterations = atoi(argv[2]);
+    first_file = 3;
+  }
+
+  // Paths are read one per line from stdin if none are given, since
+  // corpora like the tlaplus/examples repo exceed command line limits.
+  std::vector<std::string> paths(argv + first_file, argv + argc);
+  if (paths.empty()) {
+    std::string line;
+    while (std::getline(std::cin, line)) {
+      if (!line.empty()) paths.push_back(line);
+    }
+  }
+
+  if (paths.empty() || iterations < 1) {
+    fprintf(stderr, "Usage: %s [-n iterations] [file...]\n", argv[0]);
+    return 2;
+  }
+
+  TSParser *parser = ts_parser_new();
+  bool const language_ok = ts_parser_set_language(parser, counting_language());
+  if (!language_ok) {
+    fprintf(stderr, "Incompatible language version\n");
+    return 1;
+  }
+
+  Result total;
+  for (auto const &path : paths) {
+    auto file = std::ifstream(path, std::ios::binary);
+    std::string const text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    Result result;
+    for (int i = 0; i < iterations; i++) {
+      size_t const scanner_calls = scanner_call_count;
+      auto const start = std::chrono::steady_clock::now();
+      TSTree *tree = ts_parser_parse_string(parser, NULL, text.c_str(), text.size());
+      double const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      result.bytes += text.size();
+      result.scanner_calls += scanner_call_count - scanner_calls;
+      result.seconds += seconds;
+      result.latencies.push_back(seconds);
+      if (0 == i) {
+        result.errors = ts_node_has_error(ts_tree_root_node(tree)) ? 1 : 0;
+        result.tokens = count_tokens(tree) * iterations;
+      }
+      ts_tree_delete(tree);
+    }
+
+    report("file", path, result, peak_rss_kb());
+    total.bytes += result.bytes;
+    total.tokens += result.tokens;
+    total.scanner_calls += result.scanner_calls;
+    total.errors += result.errors;
+    total.seconds += result.seconds;
+    total.latencies.insert(total.latencies.end(), result.latencies.begin(), result.latencies.end());
+  }
+
+  report("aggregate", std::to_string(paths.size()), total, peak_rss_kb());
+  ts_parser_delete(parser);
+  return 0;
+}
@@ -0,0 +1,130 @@
+// Parser pool benchmark. Each given spec is parsed many times over, as a
+// service parsing one spec per request would: first creating and deleting
+// a parser for every parse, then acquiring one from a parser pool and
+// releasing it afterward. Parses are spread over the given number of
+// threads, and results are printed as key=value lines.
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#define TREE_SITTER_TLAPLUS_POOL
+#include "tree-sitter-tlaplus.h"
+
+extern "C" const TSLanguage *TS_LANG();
+
+struct Mode {
+  char const *name;
+  TSParser *(*acquire)(TSTlaplusParserPool *);
+  void (*release)(TSTlaplusParserPool *, TSParser *);
+};
+
+static TSParser *new_parser(TSTlaplusParserPool *) {
+  TSParser *parser = ts_parser_new();
+  ts_parser_set_language(parser, TS_LANG());
+  return parser;
+}
+
+static void delete_parser(TSTlaplusParserPool *, TSParser *parser) {
+  ts_parser_delete(parser);
+}
+
+static Mode const modes[] = {
+  {"fresh", new_parser, delete_parser},
+  {"pooled", tree_sitter_tlaplus_parser_pool_acquire, tree_sitter_tlaplus_parser_pool_release}
+};
+
+// Parses a thread count given with -j, which must be a whole number of at
+// least 1.
+static bool parse_thread_count(char const *arg, unsigned &threads) {
+  char *end = NULL;
+  errno = 0;
+  long const value = strtol(arg, &end, 10);
+  if (end == arg || '\0' != *end || 0 != errno || value < 1 || value > static_cast<long>(UINT_MAX)) return false;
+  threads = static_cast<unsigned>(value);
+  return true;
+}
+
+int main(int const argc, char const *const argv[]) {
+  int iterations = 200;
+  unsigned threads = 1;
+  std::vector<std::string> paths;
+  for (int i = 1; i < argc; i++) {
+    std::string const arg = argv[i];
+    if (arg == "-n" && i + 1 < argc) {
+      iterations = atoi(argv[++i]);
+    } else if (arg == "-j" && i + 1 < argc) {
+      if (!parse_thread_count(argv[++i], threads)) {
+        fprintf(stderr, "Invalid thread count: %s\nUsage: %s [-n iterations] [-j threads] [file...]\n", argv[i], argv[0]);
+        return 2;
+      }
+    } else {
+      paths.push_back(arg);
+    }
+  }
+
+  if (paths.empty()) {
+    std::string line;
+    while (std::getline(std::cin, line)) {
+      if (!line.empty()) paths.push_back(line);
+    }
+  }
+
+  if (paths.empty() || iterations < 1) {
+    fprintf(stderr, "Usage: %s [-n iterations] [-j threads] [file...]\n", argv[0]);
+    return 2;
+  }
+
+  std::vector<std::string> texts;
+  size_t bytes = 0;
+  for (auto const &path : paths) {
+    auto file = std::ifstream(path, std::ios::binary);
+    texts.emplace_back((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    bytes += texts.back().size();
+  }
+
+  double fresh_rate = 0;
+  for (auto const &mode : modes) {
+    TSTlaplusParserPool *pool = tree_sitter_tlaplus_parser_pool_new(threads, threads);
+    std::atomic<size_t> errors(0);
+    auto const start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; t++) {
+      workers.emplace_back([&]() {
+        for (int i = 0; i < iterations; i++) {
+          for (auto const &text : texts) {
+            TSParser *parser = mode.acquire(pool);
+            TSTree *tree = ts_parser_parse_string(parser, NULL, text.c_str(), text.size());
+            if (ts_node_has_error(ts_tree_root_node(tree))) errors++;
+            ts_tree_delete(tree);
+            mode.release(pool, parser);
+          }
+        }
+      });
+    }
+    for (auto &worker : workers) worker.join();
+    double const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    size_t const parses = static_cast<size_t>(iterations) * texts.size() * threads;
+    double const rate = parses / seconds;
+    if (0 == fresh_rate) fresh_rate = rate;
+    // Without the pool, every parse creates a parser
+    size_t const created = mode.release == delete_parser ? parses : tree_sitter_tlaplus_parser_pool_stats(pool).created;
+    printf(
+      "mode=%s threads=%u files=%zu parses=%zu errors=%zu parses_per_s=%.0f mean_us=%.1f"
+      " bytes=%zu parsers_created=%zu speedup=%.2f\n",
+      mode.name, threads, texts.size(), parses, errors.load(), rate, seconds * 1e6 * threads / parses,
+      bytes * iterations * threads, created, rate / fresh_rate);
+    tree_sitter_tlaplus_parser_pool_delete(pool);
+  }
+
+  return 0;
+}
@@ -0,0 +1,176 @@
+// Highlight query benchmark. The given query files are concatenated and
+// compiled with ts_query_new, then each given spec is parsed and its
+// captures run as a highlighter would: once over the whole tree, and for
+// viewports of a fixed number of lines spread over the spec, restricted
+// with ts_query_cursor_set_byte_range. Results are printed as key=value
+// lines, with viewport latencies in microseconds.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "tree_sitter/api.h"
+
+extern "C" const TSLanguage *TS_LANG();
+
+static char const *const default_queries[] = {"queries/highlights.scm"};
+
+// Viewports per spec, and lines per viewport.
+static size_t const viewport_count = 16;
+static size_t const viewport_lines = 60;
+
+static std::string read_file(std::string const &path) {
+  auto file = std::ifstream(path, std::ios::binary);
+  return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point const start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static double percentile(std::vector<double> samples, double const fraction) {
+  if (samples.empty()) return 0;
+  std::sort(samples.begin(), samples.end());
+  return samples[static_cast<size_t>(fraction * (samples.size() - 1))];
+}
+
+// Runs the query over the byte range, counting its captures.
+static size_t count_captures(TSQueryCursor *cursor, TSQuery const *query, TSNode const root,
+                             uint32_t const start, uint32_t const end) {
+  ts_query_cursor_set_byte_range(cursor, start, end);
+  ts_query_cursor_exec(cursor, query, root);
+  size_t captures = 0;
+  TSQueryMatch match;
+  uint32_t capture_index;
+  while (ts_query_cursor_next_capture(cursor, &match, &capture_index)) captures++;
+  return captures;
+}
+
+struct Result {
+  size_t bytes = 0;
+  size_t captures = 0;
+  size_t viewport_captures = 0;
+  std::vector<double> full;
+  std::vector<double> viewports;
+};
+
+static void report(char const *label, std::string const &name, Result const &result) {
+  printf(
+    "%s=%s bytes=%zu captures=%zu viewport_captures=%zu full_ms=%.3f"
+    " viewport_p50_us=%.1f viewport_p99_us=%.1f\n",
+    label, name.c_str(), result.bytes, result.captures, result.viewport_captures,
+    percentile(result.full, 0.5) * 1e3, percentile(result.viewports, 0.5) * 1e6,
+    percentile(result.viewports, 0.99) * 1e6);
+}
+
+int main(int const argc, char const *const argv[]) {
+  int iterations = 10;
+  std::vector<std::string> query_paths, paths;
+  for (int i = 1; i < argc; i++) {
+    std::string const arg = argv[i];
+    if (arg == "-n" && i + 1 < argc) {
+      iterations = atoi(argv[++i]);
+    } else if (arg == "-q" && i + 1 < argc) {
+      query_paths.push_back(argv[++i]);
+    } else {
+      paths.push_back(arg);
+    }
+  }
+  if (query_paths.empty()) query_paths.assign(std::begin(default_queries), std::end(default_queries));
+
+  if (paths.empty()) {
+    std::string line;
+    while (std::getline(std::cin, line)) {
+      if (!line.empty()) paths.push_back(line);
+    }
+  }
+
+  if (paths.empty() || iterations < 1) {
+    fprintf(stderr, "Usage: %s [-n iterations] [-q query.scm]... [file...]\n", argv[0]);
+    return 2;
+  }
+
+  std::string source;
+  for (auto const &path : query_paths) source += read_file(path);
+
+  TSQuery *query = NULL;
+  std::vector<double> compiles;
+  for (int i = 0; i < iterations; i++) {
+    uint32_t error_offset = 0;
+    TSQueryError error_type = TSQueryErrorNone;
+    auto const start = std::chrono::steady_clock::now();
+    TSQuery *compiled = ts_query_new(TS_LANG(), source.c_str(), source.size(), &error_offset, &error_type);
+    compiles.push_back(seconds_since(start));
+    if (NULL == compiled) {
+      fprintf(stderr, "Invalid query at byte %u, error %d\n", error_offset, static_cast<int>(error_type));
+      return 1;
+    }
+    if (NULL != query) ts_query_delete(query);
+    query = compiled;
+  }
+  printf("query_bytes=%zu patterns=%u captures=%u compile_ms=%.3f\n",
+    source.size(), ts_query_pattern_count(query), ts_query_capture_count(query),
+    percentile(compiles, 0.5) * 1e3);
+
+  TSParser *parser = ts_parser_new();
+  if (!ts_parser_set_language(parser, TS_LANG())) {
+    fprintf(stderr, "Incompatible language version\n");
+    return 1;
+  }
+  TSQueryCursor *cursor = ts_query_cursor_new();
+
+  Result total;
+  for (auto const &path : paths) {
+    std::string const text = read_file(path);
+    TSTree *tree = ts_parser_parse_string(parser, NULL, text.c_str(), text.size());
+    TSNode const root = ts_tree_root_node(tree);
+
+    // Viewports start at evenly spaced lines
+    std::vector<uint32_t> line_starts(1, 0);
+    for (size_t i = 0; i < text.size(); i++) {
+      if ('\n' == text[i]) line_starts.push_back(static_cast<uint32_t>(i + 1));
+    }
+    std::vector<std::pair<uint32_t, uint32_t>> viewports;
+    size_t const line_count = line_starts.size();
+    for (size_t i = 0; i < viewport_count && i * line_count / viewport_count < line_count; i++) {
+      size_t const first = i * line_count / viewport_count;
+      size_t const last = first + viewport_lines;
+      uint32_t const end = last < line_count ? line_starts[last] : static_cast<uint32_t>(text.size());
+      viewports.push_back(std::make_pair(line_starts[first], end));
+      if (last >= line_count) break;
+    }
+
+    Result result;
+    for (int i = 0; i < iterations; i++) {
+      auto start = std::chrono::steady_clock::now();
+      result.captures = count_captures(cursor, query, root, 0, UINT32_MAX);
+      result.full.push_back(seconds_since(start));
+
+      result.viewport_captures = 0;
+      for (auto const &viewport : viewports) {
+        start = std::chrono::steady_clock::now();
+        result.viewport_captures += count_captures(cursor, query, root, viewport.first, viewport.second);
+        result.viewports.push_back(seconds_since(start));
+      }
+      result.bytes += text.size();
+    }
+
+    report("file", path, result);
+    total.bytes += result.bytes;
+    total.captures += result.captures;
+    total.viewport_captures += result.viewport_captures;
+    total.full.insert(total.full.end(), result.full.begin(), result.full.end());
+    total.viewports.insert(total.viewports.end(), result.viewports.begin(), result.viewports.end());
+    ts_tree_delete(tree);
+  }
+
+  report("aggregate", std::to_string(paths.size()), total);
+  ts_query_cursor_delete(cursor);
+  ts_query_delete(query);
+  ts_parser_delete(parser);
+  return 0;
+}
@@ -0,0 +1,260 @@
+// Incremental reparse benchmark. Scripted edits are applied to each given
+// file and the edited text is reparsed with the old tree, reporting reparse
+// latency against a full parse and how much of the old tree was reused;
+// it exits with an error if any reparse gives a different tree.
+// Edits are located by pattern, so files lacking a pattern skip that edit:
+//  * conjunct: inserts a conjunct after that of the most deeply indented
+//    /\ bullet, below any lines continuing it
+//  * proof_step: renumbers the first <2> proof step
+//  * pcal_comment: turns a PlusCal algorithm into an ordinary comment
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "tree_sitter/api.h"
+
+extern "C" const TSLanguage *TS_LANG();
+
+struct Edit {
+  char const *kind;
+  size_t start;
+  size_t old_length;
+  std::string replacement;
+};
+
+static TSPoint point_at(std::string const &text, size_t const offset) {
+  TSPoint point = {0, 0};
+  for (size_t i = 0; i < offset; i++) {
+    if ('\n' == text[i]) {
+      point.row++;
+      point.column = 0;
+    } else {
+      point.column++;
+    }
+  }
+  return point;
+}
+
+static size_t line_start(std::string const &text, size_t const offset) {
+  if (0 == offset) return 0;
+  size_t const newline = text.rfind('\n', offset - 1);
+  return newline == std::string::npos ? 0 : newline + 1;
+}
+
+// Offset just past the end of the line containing the offset, or the end
+// of the text if it has no newline after the offset.
+static size_t next_line_start(std::string const &text, size_t const offset) {
+  size_t const newline = text.find('\n', offset);
+  return newline == std::string::npos ? text.size() : newline + 1;
+}
+
+static bool find_conjunct_edit(std::string const &text, Edit &edit) {
+  size_t best = std::string::npos;
+  size_t best_column = 0;
+  for (size_t at = text.find("/\\"); at != std::string::npos; at = text.find("/\\", at + 2)) {
+    size_t const start = line_start(text, at);
+    if (text.find_first_not_of(" \t", start) != at) continue;
+    if (best == std::string::npos || at - start > best_column) {
+      best = at;
+      best_column = at - start;
+    }
+  }
+
+  if (best == std::string::npos) return false;
+  edit.kind = "conjunct";
+  // Lines indented past the bullet continue its conjunct, so the new one
+  // goes after them
+  size_t end = next_line_start(text, best);
+  for (size_t line = end; line < text.size(); line = next_line_start(text, line)) {
+    size_t const indent = text.find_first_not_of(" \t", line);
+    if (indent == std::string::npos || '\n' == text[indent]) continue;
+    if (indent - line <= best_column) break;
+    end = next_line_start(text, line);
+  }
+  edit.start = end;
+  edit.old_length = 0;
+  edit.replacement = std::string(best_column, ' ') + "/\\ TRUE\n";
+  if ('\n' != text[end - 1]) {
+    edit.replacement = "\n" + edit.replacement;
+  }
+  return true;
+}
+
+static bool find_proof_step_edit(std::string const &text, Edit &edit) {
+  for (size_t at = text.find("<2>"); at != std::string::npos; at = text.find("<2>", at + 3)) {
+    size_t const digits = at + 3;
+    size_t const end = text.find_first_not_of("0123456789", digits);
+    if (end == std::string::npos || end == digits) continue;
+    edit.kind = "proof_step";
+    edit.start = digits;
+    edit.old_length = end - digits;
+    edit.replacement = "99";
+    return true;
+  }
+  return false;
+}
+
+static bool find_pcal_comment_edit(std::string const &text, Edit &edit) {
+  size_t const at = text.find("--algorithm");
+  if (at == std::string::npos) return false;
+  edit.kind = "pcal_comment";
+  edit.start = at;
+  edit.old_length = 2;
+  edit.replacement = "  ";
+  return true;
+}
+
+static std::vector<Edit> find_edits(std::string const &text) {
+  std::vector<Edit> edits;
+  Edit edit;
+  if (find_conjunct_edit(text, edit)) edits.push_back(edit);
+  if (find_proof_step_edit(text, edit)) edits.push_back(edit);
+  if (find_pcal_comment_edit(text, edit)) edits.push_back(edit);
+  return edits;
+}
+
+// Calls the given function with the id of every node in the tree.
+template <typename Visit>
+static void visit_nodes(TSTree const *tree, Visit visit) {
+  TSTreeCursor cursor = ts_tree_cursor_new(ts_tree_root_node(tree));
+  for (;;) {
+    visit(ts_tree_cursor_current_node(&cursor).id);
+    if (ts_tree_cursor_goto_first_child(&cursor)) continue;
+    while (!ts_tree_cursor_goto_next_sibling(&cursor)) {
+      if (!ts_tree_cursor_goto_parent(&cursor)) {
+        ts_tree_cursor_delete(&cursor);
+        return;
+      }
+    }
+  }
+}
+
+// Fraction of nodes in the new tree shared with the old tree; subtrees
+// untouched by an edit keep their identity across an incremental parse.
+static double reused_fraction(TSTree const *old_tree, TSTree const *new_tree) {
+  std::unordered_set<void const *> old_ids;
+  visit_nodes(old_tree, [&](void const *id) { old_ids.insert(id); });
+  size_t total = 0, reused = 0;
+  visit_nodes(new_tree, [&](void const *id) {
+    total++;
+    if (old_ids.count(id)) reused++;
+  });
+  return static_cast<double>(reused) / total;
+}
+
+static double median(std::vector<double> samples) {
+  std::sort(samples.begin(), samples.end());
+  return samples[samples.size() / 2];
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point const start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int const argc, char const *const argv[]) {
+  int iterations = 10;
+  int first_file = 1;
+  if (argc > 2 && std::string(argv[1]) == "-n") {
+    iterations = atoi(argv[2]);
+    first_file = 3;
+  }
+
+  std::vector<std::string> paths(argv + first_file, argv + argc);
+  if (paths.empty()) {
+    std::string line;
+    while (std::getline(std::cin, line)) {
+      if (!line.empty()) paths.push_back(line);
+    }
+  }
+
+  if (paths.empty() || iterations < 1) {
+    fprintf(stderr, "Usage: %s [-n iterations] [file...]\n", argv[0]);
+    return 2;
+  }
+
+  TSParser *parser = ts_parser_new();
+  if (!ts_parser_set_language(parser, TS_LANG())) {
+    fprintf(stderr, "Incompatible language version\n");
+    return 1;
+  }
+
+  size_t mismatches = 0;
+  for (auto const &path : paths) {
+    auto file = std::ifstream(path, std::ios::binary);
+    std::string const text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    auto const edits = find_edits(text);
+    if (edits.empty()) continue;
+    TSTree *old_tree = ts_parser_parse_string(parser, NULL, text.c_str(), text.size());
+
+    for (auto const &edit : edits) {
+      std::string edited = text;
+      edited.replace(edit.start, edit.old_length, edit.replacement);
+      TSInputEdit input_edit;
+      input_edit.start_byte = edit.start;
+      input_edit.old_end_byte = edit.start + edit.old_length;
+      input_edit.new_end_byte = edit.start + edit.replacement.size();
+      input_edit.start_point = point_at(text, input_edit.start_byte);
+      input_edit.old_end_point = point_at(text, input_edit.old_end_byte);
+      input_edit.new_end_point = point_at(edited, input_edit.new_end_byte);
+
+      std::vector<double> full_parses, reparses;
+      double reused = 0;
+      size_t changed_bytes = 0;
+      for (int i = 0; i < iterations; i++) {
+        auto start = std::chrono::steady_clock::now();
+        TSTree *full_tree = ts_parser_parse_string(parser, NULL, edited.c_str(), edited.size());
+        full_parses.push_back(seconds_since(start));
+
+        TSTree *edited_tree = ts_tree_copy(old_tree);
+        ts_tree_edit(edited_tree, &input_edit);
+        start = std::chrono::steady_clock::now();
+        TSTree *new_tree = ts_parser_parse_string(parser, edited_tree, edited.c_str(), edited.size());
+        reparses.push_back(seconds_since(start));
+
+        if (0 == i) {
+          // The reparse must give the same tree as parsing from scratch
+          char *full_sexp = ts_node_string(ts_tree_root_node(full_tree));
+          char *new_sexp = ts_node_string(ts_tree_root_node(new_tree));
+          if (0 != strcmp(full_sexp, new_sexp)) {
+            fprintf(stderr, "%s: %s reparse differs from a full parse\n", path.c_str(), edit.kind);
+            mismatches++;
+          }
+          free(full_sexp);
+          free(new_sexp);
+
+          reused = reused_fraction(edited_tree, new_tree);
+          uint32_t range_count = 0;
+          TSRange *ranges = ts_tree_get_changed_ranges(edited_tree, new_tree, &range_count);
+          for (uint32_t j = 0; j < range_count; j++) {
+            changed_bytes += ranges[j].end_byte - ranges[j].start_byte;
+          }
+          free(ranges);
+        }
+
+        ts_tree_delete(new_tree);
+        ts_tree_delete(edited_tree);
+        ts_tree_delete(full_tree);
+      }
+
+      double const full_parse = median(full_parses);
+      double const reparse = median(reparses);
+      printf(
+        "file=%s edit=%s bytes=%zu full_parse_ms=%.3f reparse_ms=%.3f speedup=%.2f"
+        " reused_nodes=%.4f changed_bytes=%zu\n",
+        path.c_str(), edit.kind, edited.size(), full_parse * 1e3, reparse * 1e3,
+        full_parse / reparse, reused, changed_bytes);
+    }
+
+    ts_tree_delete(old_tree);
+  }
+
+  ts_parser_delete(parser);
+  return mismatches > 0 ? 1 : 0;
+}
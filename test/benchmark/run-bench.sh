@@ -0,0 +1,76 @@
+#! /bin/sh
+# Runs one of the benchmarks built by build-parse-bench.sh, over the specs
+# of test/examples: Highlight.tla and the tlaplus/examples submodule.
+# Arguments after the mode are passed to its driver, such as -n <count>
+# to change how many times each file is measured.
+#
+#   parse    Parses every spec.
+#   reparse  Replays scripted edits against every spec.
+#   corpus   Parses every spec in-process with 1, 2, 4, ... up to all
+#            available threads, printing the aggregate of each run.
+#   outline  Checks the outline of every spec against a full parse.
+#   index    Types into every spec, checking the incrementally updated
+#            definition index against one built afresh.
+#   query    Runs the highlight queries over every spec, with the
+#            GitHub/tree-sitter queries and then the nvim ones.
+#   pool     Parses the specs under 4 KiB with a parser created per parse,
+#            then with pooled parsers.
+#   nesting  Parses generated specs nesting constructs 10 to 10000 deep.
+#   scaling  Replays the inputs saved by the performance fuzzer, along with
+#            the crash regressions, as they are repeated.
+#
+# Exits with an error if the driver reports a failure.
+bench_dir=test/benchmark
+out_dir=$bench_dir/out
+mode=$1
+if [ $# -gt 0 ]; then shift; fi
+
+# Warns if only the specs committed to this repo are there to measure
+check_corpus() {
+  if [ -z "$(find test/examples/external -name '*.tla' 2>/dev/null | head -n 1)" ]; then
+    echo "The tlaplus/examples corpus is missing, so only test/examples/Highlight.tla is measured;" \
+      "run \`git submodule update --init test/examples/external\`" >&2
+  fi
+}
+
+specs() {
+  check_corpus
+  find "test/examples" -type f -name "*.tla" "$@" | sort
+}
+
+case "$mode" in
+  parse | reparse | outline | index)
+    specs | $out_dir/bench_${mode}_tlaplus "$@"
+    ;;
+  corpus)
+    check_corpus
+    EXITCODE=0
+    ncpu=$(command -v nproc > /dev/null && nproc || echo 1)
+    threads=1
+    while :; do
+      output=$($out_dir/bench_corpus_tlaplus -j $threads "$@" "test/examples") || EXITCODE=1
+      echo "$output" | grep -E "^(failure|aggregate)="
+      test $threads -ge $ncpu && break
+      threads=$((threads * 2 > ncpu ? ncpu : threads * 2))
+    done
+    exit $EXITCODE
+    ;;
+  query)
+    specs > $out_dir/query-files.txt
+    $out_dir/bench_query_tlaplus "$@" < $out_dir/query-files.txt &&
+      $out_dir/bench_query_tlaplus "$@" -q integrations/nvim/queries/tlaplus/highlights.scm < $out_dir/query-files.txt
+    ;;
+  pool)
+    specs -size -4k | $out_dir/bench_pool_tlaplus "$@"
+    ;;
+  nesting)
+    $out_dir/bench_nesting_tlaplus "$@"
+    ;;
+  scaling)
+    find "test/performance_regressions" "test/crash_regressions" -type f | sort | $out_dir/bench_scaling_tlaplus "$@"
+    ;;
+  *)
+    echo "Usage: $0 parse|reparse|corpus|outline|index|query|pool|nesting|scaling [args...]" >&2
+    exit 2
+    ;;
+esac
@@ -0,0 +1,127 @@
+// Parse scaling replay. Each given input is parsed repeated 1, 2, 4, ...
+// times, counting parse steps through the parser's log and timing parses
+// without it, and the exponents of steps & time against size are fitted
+// on a log-log scale; an exponent near 1 is linear. Results are printed as
+// key=value lines, and inputs whose step exponent exceeds the limit are
+// listed on stderr.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "tree_sitter/api.h"
+
+extern "C" const TSLanguage *TS_LANG();
+
+static void count_parse_step(void *payload, TSLogType type, const char *) {
+  if (TSLogTypeParse == type) (*static_cast<size_t *>(payload))++;
+}
+
+static double median(std::vector<double> samples) {
+  std::sort(samples.begin(), samples.end());
+  return samples[samples.size() / 2];
+}
+
+// Slope of the least squares line through the points on a log-log scale.
+static double fit_exponent(std::vector<double> const &sizes, std::vector<double> const &costs) {
+  double sum_x = 0, sum_y = 0, sum_xx = 0, sum_xy = 0;
+  size_t const n = sizes.size();
+  for (size_t i = 0; i < n; i++) {
+    double const x = std::log(sizes[i]);
+    double const y = std::log(std::max(costs[i], 1e-9));
+    sum_x += x;
+    sum_y += y;
+    sum_xx += x * x;
+    sum_xy += x * y;
+  }
+  double const denominator = n * sum_xx - sum_x * sum_x;
+  return 0 == denominator ? 0 : (n * sum_xy - sum_x * sum_y) / denominator;
+}
+
+int main(int const argc, char const *const argv[]) {
+  int iterations = 5;
+  size_t max_copies = 32;
+  double limit = 1.5;
+  std::vector<std::string> paths;
+  for (int i = 1; i < argc; i++) {
+    std::string const arg = argv[i];
+    if (arg == "-n" && i + 1 < argc) {
+      iterations = atoi(argv[++i]);
+    } else if (arg == "-c" && i + 1 < argc) {
+      max_copies = strtoul(argv[++i], NULL, 10);
+    } else if (arg == "-e" && i + 1 < argc) {
+      limit = atof(argv[++i]);
+    } else {
+      paths.push_back(arg);
+    }
+  }
+
+  if (paths.empty()) {
+    std::string line;
+    while (std::getline(std::cin, line)) {
+      if (!line.empty()) paths.push_back(line);
+    }
+  }
+
+  if (paths.empty() || iterations < 1 || max_copies < 2) {
+    fprintf(stderr, "Usage: %s [-n iterations] [-c max copies] [-e exponent limit] [file...]\n", argv[0]);
+    return 2;
+  }
+
+  TSParser *parser = ts_parser_new();
+  if (!ts_parser_set_language(parser, TS_LANG())) {
+    fprintf(stderr, "Incompatible language version\n");
+    return 1;
+  }
+
+  size_t superlinear = 0;
+  for (auto const &path : paths) {
+    auto file = std::ifstream(path, std::ios::binary);
+    std::string const input((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (input.empty()) continue;
+
+    std::vector<double> sizes, steps, seconds;
+    std::string text;
+    for (size_t copies = 1; copies <= max_copies; copies *= 2) {
+      while (text.size() < copies * (input.size() + 1)) text += input + "\n";
+
+      size_t step_count = 0;
+      TSLogger logger = {&step_count, count_parse_step};
+      ts_parser_set_logger(parser, logger);
+      ts_tree_delete(ts_parser_parse_string(parser, NULL, text.c_str(), text.size()));
+      ts_parser_set_logger(parser, TSLogger{NULL, NULL});
+
+      std::vector<double> samples;
+      for (int i = 0; i < iterations; i++) {
+        auto const start = std::chrono::steady_clock::now();
+        TSTree *tree = ts_parser_parse_string(parser, NULL, text.c_str(), text.size());
+        samples.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        ts_tree_delete(tree);
+      }
+
+      sizes.push_back(static_cast<double>(text.size()));
+      steps.push_back(static_cast<double>(step_count));
+      seconds.push_back(median(samples));
+      printf("file=%s copies=%zu bytes=%zu steps=%zu steps_per_byte=%.2f parse_ms=%.3f\n",
+        path.c_str(), copies, text.size(), step_count,
+        static_cast<double>(step_count) / text.size(), seconds.back() * 1e3);
+    }
+
+    double const step_exponent = fit_exponent(sizes, steps);
+    double const time_exponent = fit_exponent(sizes, seconds);
+    printf("file=%s step_exponent=%.2f time_exponent=%.2f\n", path.c_str(), step_exponent, time_exponent);
+    if (step_exponent > limit) {
+      fprintf(stderr, "%s: parse steps grow with exponent %.2f, over the limit of %.2f\n",
+        path.c_str(), step_exponent, limit);
+      superlinear++;
+    }
+  }
+
+  ts_parser_delete(parser);
+  return 0 == superlinear ? 0 : 1;
+}
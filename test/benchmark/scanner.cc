@@ -0,0 +1,700 @@
+// Microbenchmark driving the external scanner directly, without the
+// tree-sitter runtime. The scanner is fed every whitespace-separated
+// position of the given files under each valid symbol set the generated
+// parser can request, mimicking the calls made during a real parse.
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#include "tree_sitter/parser.h"
+
+extern "C" const TSLanguage *TS_LANG();
+extern "C" void tree_sitter_tlaplus_scanner_set_allocator(
+  void *(*allocate)(void *, size_t), void (*deallocate)(void *, void *), void *payload);
+
+// Allocator hooks used by the scanner when built with
+// TREE_SITTER_REUSE_ALLOCATOR; they count scanner heap traffic of the
+// calling thread.
+static thread_local size_t allocation_count = 0;
+static void *counting_malloc(size_t size) { allocation_count++; return malloc(size); }
+static void *counting_calloc(size_t count, size_t size) { allocation_count++; return calloc(count, size); }
+static void *counting_realloc(void *ptr, size_t size) { allocation_count++; return realloc(ptr, size); }
+extern "C" {
+void *(*ts_current_malloc)(size_t) = counting_malloc;
+void *(*ts_current_calloc)(size_t, size_t) = counting_calloc;
+void *(*ts_current_realloc)(void *, size_t) = counting_realloc;
+void (*ts_current_free)(void *) = free;
+}
+
+// Lexer over a decoded file; get_column walks back to the start of the
+// line the same way the tree-sitter runtime does.
+struct Lexer {
+  TSLexer base;
+  const std::vector<int32_t> *codepoints;
+  size_t position;
+  size_t end;
+};
+
+static void set_lookahead(Lexer *lexer) {
+  auto const &codepoints = *lexer->codepoints;
+  lexer->base.lookahead = lexer->position < codepoints.size() ? codepoints[lexer->position] : 0;
+}
+
+static void lexer_advance(TSLexer *base, bool) {
+  auto lexer = reinterpret_cast<Lexer *>(base);
+  if (lexer->position < lexer->codepoints->size()) lexer->position++;
+  set_lookahead(lexer);
+}
+
+static void lexer_mark_end(TSLexer *base) {
+  auto lexer = reinterpret_cast<Lexer *>(base);
+  lexer->end = lexer->position;
+}
+
+static thread_local size_t get_column_count = 0;
+
+static uint32_t lexer_get_column(TSLexer *base) {
+  get_column_count++;
+  auto lexer = reinterpret_cast<Lexer *>(base);
+  auto const &codepoints = *lexer->codepoints;
+  size_t line_start = lexer->position;
+  while (line_start > 0 && codepoints[line_start - 1] != '\n') line_start--;
+  return static_cast<uint32_t>(lexer->position - line_start);
+}
+
+static bool lexer_is_at_included_range_start(const TSLexer *) { return false; }
+
+static bool lexer_eof(const TSLexer *base) {
+  auto lexer = reinterpret_cast<const Lexer *>(base);
+  return lexer->position >= lexer->codepoints->size();
+}
+
+static Lexer lexer_new(const std::vector<int32_t> &codepoints) {
+  Lexer lexer = {};
+  lexer.base.advance = lexer_advance;
+  lexer.base.mark_end = lexer_mark_end;
+  lexer.base.get_column = lexer_get_column;
+  lexer.base.is_at_included_range_start = lexer_is_at_included_range_start;
+  lexer.base.eof = lexer_eof;
+  lexer.codepoints = &codepoints;
+  return lexer;
+}
+
+static std::vector<int32_t> decode_utf8(std::string const &text) {
+  std::vector<int32_t> codepoints;
+  codepoints.reserve(text.size());
+  for (size_t i = 0; i < text.size();) {
+    auto const byte = static_cast<unsigned char>(text[i]);
+    size_t const length = byte < 0x80 ? 1 : (byte >> 5) == 0x6 ? 2 : (byte >> 4) == 0xE ? 3 : 4;
+    int32_t codepoint = length == 1 ? byte : byte & (0x7F >> length);
+    for (size_t j = 1; j < length && i + j < text.size(); j++) {
+      codepoint = (codepoint << 6) | (text[i + j] & 0x3F);
+    }
+    codepoints.push_back(codepoint);
+    i += length;
+  }
+  return codepoints;
+}
+
+// Ends of whitespace-separated runs; as in the runtime, the scanner is
+// invoked directly after the previous token, before any whitespace.
+static std::vector<size_t> token_positions(const std::vector<int32_t> &codepoints) {
+  std::vector<size_t> positions = {0};
+  bool in_whitespace = true;
+  for (size_t i = 0; i < codepoints.size(); i++) {
+    bool const is_whitespace = codepoints[i] == ' ' || codepoints[i] == '\t' || codepoints[i] == '\n' || codepoints[i] == '\r';
+    if (!in_whitespace && is_whitespace) positions.push_back(i);
+    in_whitespace = is_whitespace;
+  }
+  if (!in_whitespace) positions.push_back(codepoints.size());
+  return positions;
+}
+
+// Valid symbol sets from the parse table, excluding error recovery.
+static std::vector<const bool *> valid_symbol_sets(const TSLanguage *language) {
+  unsigned external_state_count = 0;
+  for (unsigned state = 0; state < language->state_count; state++) {
+    unsigned const external_state = language->lex_modes[state].external_lex_state;
+    if (external_state >= external_state_count) external_state_count = external_state + 1;
+  }
+
+  std::vector<const bool *> sets;
+  auto const token_count = language->external_token_count;
+  for (unsigned state = 1; state < external_state_count; state++) {
+    const bool *valid_symbols = &language->external_scanner.states[state * token_count];
+    if (!valid_symbols[token_count - 1]) sets.push_back(valid_symbols);
+  }
+  return sets;
+}
+
+struct File {
+  std::string path;
+  std::vector<int32_t> codepoints;
+  std::vector<size_t> positions;
+};
+
+struct Result {
+  size_t operations = 0;
+  size_t allocations = 0;
+  size_t get_column_calls = 0;
+  size_t bytes = 0;
+  uint64_t cache_misses = 0;
+  double seconds = 0;
+};
+
+// Counts cache misses of this thread where the hardware counter can be
+// opened (Linux with access to performance counters); otherwise reads 0.
+struct CacheMissCounter {
+  int fd = -1;
+
+  CacheMissCounter() {
+#ifdef __linux__
+    perf_event_attr attr = {};
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+  }
+
+  ~CacheMissCounter() {
+#ifdef __linux__
+    if (fd >= 0) close(fd);
+#endif
+  }
+
+  uint64_t read() const {
+    uint64_t count = 0;
+#ifdef __linux__
+    if (fd >= 0 && sizeof(count) != ::read(fd, &count, sizeof(count))) count = 0;
+#endif
+    return count;
+  }
+};
+
+static CacheMissCounter cache_misses;
+
+static void report(char const *mode, Result const &result, char const *unit) {
+  printf(
+    "mode=%s %s=%zu ns_per_%s=%.2f allocations_per_%s=%.4f",
+    mode, unit, result.operations,
+    unit, result.seconds * 1e9 / result.operations,
+    unit, static_cast<double>(result.allocations) / result.operations);
+  if (result.bytes > 0) {
+    printf(" bytes_per_%s=%.2f", unit, static_cast<double>(result.bytes) / result.operations);
+  }
+  if (result.get_column_calls > 0) {
+    printf(" get_column_per_%s=%.4f", unit, static_cast<double>(result.get_column_calls) / result.operations);
+  }
+  if (cache_misses.fd >= 0) {
+    printf(" cache_misses_per_%s=%.4f", unit, static_cast<double>(result.cache_misses) / result.operations);
+  }
+  printf("\n");
+}
+
+// Runs the scanner at every position of the file with every valid symbol
+// set, recording the serialized state after each emitted token. Sets for
+// extramodular text scan to the next module and so can be left out.
+static void scan_file(
+  const TSLanguage *language,
+  File const &file,
+  Result &result,
+  std::vector<std::string> *states,
+  bool const include_extramodular_text = true
+) {
+  auto const &scanner = language->external_scanner;
+  auto sets = valid_symbol_sets(language);
+  if (!include_extramodular_text) {
+    // LEADING_ and TRAILING_EXTRAMODULAR_TEXT are the first external tokens
+    auto const is_extramodular = [](const bool *valid_symbols) { return valid_symbols[0] || valid_symbols[1]; };
+    sets.erase(std::remove_if(sets.begin(), sets.end(), is_extramodular), sets.end());
+  }
+  void *payload = scanner.create();
+  Lexer lexer = lexer_new(file.codepoints);
+  char buffer[TREE_SITTER_SERIALIZATION_BUFFER_SIZE];
+  auto const start = std::chrono::steady_clock::now();
+  size_t const allocations = allocation_count;
+  size_t const get_column_calls = get_column_count;
+  for (size_t position : file.positions) {
+    for (const bool *valid_symbols : sets) {
+      lexer.position = position;
+      set_lookahead(&lexer);
+      if (scanner.scan(payload, &lexer.base, valid_symbols) && states) {
+        unsigned const length = scanner.serialize(payload, buffer);
+        states->emplace_back(buffer, length);
+      }
+      result.operations++;
+    }
+  }
+  result.allocations += allocation_count - allocations;
+  result.get_column_calls += get_column_count - get_column_calls;
+  result.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  scanner.destroy(payload);
+}
+
+static void bench_scan(const TSLanguage *language, std::vector<File> const &files, int iterations) {
+  Result result;
+  for (int i = 0; i < iterations; i++) {
+    for (auto const &file : files) scan_file(language, file, result, nullptr);
+  }
+  report("scan", result, "call");
+}
+
+static std::vector<std::string> collect_states(const TSLanguage *language, std::vector<File> const &files) {
+  std::vector<std::string> states;
+  Result ignored;
+  for (auto const &file : files) scan_file(language, file, ignored, &states);
+  return states;
+}
+
+static void bench_state(const TSLanguage *language, std::vector<File> const &files, int iterations) {
+  auto const &scanner = language->external_scanner;
+  auto const states = collect_states(language, files);
+  void *payload = scanner.create();
+  char buffer[TREE_SITTER_SERIALIZATION_BUFFER_SIZE];
+  Result serialize, deserialize;
+  for (int i = 0; i < iterations; i++) {
+    for (auto const &state : states) {
+      size_t allocations = allocation_count;
+      uint64_t misses = cache_misses.read();
+      auto start = std::chrono::steady_clock::now();
+      scanner.deserialize(payload, state.data(), state.size());
+      auto middle = std::chrono::steady_clock::now();
+      deserialize.cache_misses += cache_misses.read() - misses;
+      deserialize.allocations += allocation_count - allocations;
+      allocations = allocation_count;
+      misses = cache_misses.read();
+      serialize.bytes += scanner.serialize(payload, buffer);
+      auto end = std::chrono::steady_clock::now();
+      serialize.cache_misses += cache_misses.read() - misses;
+      serialize.allocations += allocation_count - allocations;
+      deserialize.seconds += std::chrono::duration<double>(middle - start).count();
+      serialize.seconds += std::chrono::duration<double>(end - middle).count();
+      serialize.operations++;
+      deserialize.operations++;
+    }
+  }
+  scanner.destroy(payload);
+  report("serialize", serialize, "state");
+  report("deserialize", deserialize, "state");
+}
+
+// Creates a fresh scanner for every recorded state and restores the state
+// into it, as the runtime does for each new parser or scanner clone.
+static void bench_create(const TSLanguage *language, std::vector<File> const &files, int iterations) {
+  auto const &scanner = language->external_scanner;
+  auto const states = collect_states(language, files);
+  Result result;
+  for (int i = 0; i < iterations; i++) {
+    for (auto const &state : states) {
+      size_t const allocations = allocation_count;
+      uint64_t const misses = cache_misses.read();
+      auto const start = std::chrono::steady_clock::now();
+      void *payload = scanner.create();
+      scanner.deserialize(payload, state.data(), state.size());
+      scanner.destroy(payload);
+      result.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      result.cache_misses += cache_misses.read() - misses;
+      result.allocations += allocation_count - allocations;
+      result.operations++;
+    }
+  }
+  report("create", result, "state");
+}
+
+static void bench_pcal(const TSLanguage *language, std::vector<File> const &files, int iterations) {
+  auto const &scanner = language->external_scanner;
+  auto const token_count = language->external_token_count;
+  auto const states = collect_states(language, files);
+  // PCAL_START and PCAL_END are the second- and third-last external tokens
+  bool start_symbols[64] = {}, end_symbols[64] = {};
+  start_symbols[token_count - 3] = true;
+  end_symbols[token_count - 2] = true;
+  std::vector<int32_t> empty;
+  Lexer lexer = lexer_new(empty);
+  void *payload = scanner.create();
+  Result result;
+  for (auto const &state : states) {
+    scanner.deserialize(payload, state.data(), state.size());
+    size_t const allocations = allocation_count;
+    auto const start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+      scanner.scan(payload, &lexer.base, start_symbols);
+      scanner.scan(payload, &lexer.base, end_symbols);
+      result.operations++;
+    }
+    result.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.allocations += allocation_count - allocations;
+  }
+  scanner.destroy(payload);
+  report("pcal", result, "block");
+}
+
+// Mimics an incremental reparse after an edit in the middle of each file:
+// scanning resumes from the state recorded there, and as in the runtime the
+// last emitted state is deserialized before every call to the scanner.
+static void bench_replay(const TSLanguage *language, std::vector<File> const &files, int iterations) {
+  auto const &scanner = language->external_scanner;
+  auto const sets = valid_symbol_sets(language);
+  char buffer[TREE_SITTER_SERIALIZATION_BUFFER_SIZE];
+  Result result;
+  for (auto const &file : files) {
+    // Find the scanner state in effect at the middle of the file
+    size_t const middle = file.positions.size() / 2;
+    void *payload = scanner.create();
+    Lexer lexer = lexer_new(file.codepoints);
+    for (size_t i = 0; i < middle; i++) {
+      for (const bool *valid_symbols : sets) {
+        lexer.position = file.positions[i];
+        set_lookahead(&lexer);
+        scanner.scan(payload, &lexer.base, valid_symbols);
+      }
+    }
+    std::string const edit_state(buffer, scanner.serialize(payload, buffer));
+
+    for (int iteration = 0; iteration < iterations; iteration++) {
+      std::string state = edit_state;
+      size_t const allocations = allocation_count;
+      auto const start = std::chrono::steady_clock::now();
+      for (size_t i = middle; i < file.positions.size(); i++) {
+        for (const bool *valid_symbols : sets) {
+          lexer.position = file.positions[i];
+          set_lookahead(&lexer);
+          scanner.deserialize(payload, state.data(), state.size());
+          if (scanner.scan(payload, &lexer.base, valid_symbols)) {
+            state.assign(buffer, scanner.serialize(payload, buffer));
+          }
+          result.operations++;
+        }
+      }
+      result.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      result.allocations += allocation_count - allocations;
+    }
+    scanner.destroy(payload);
+  }
+  report("replay", result, "call");
+}
+
+// Scans the extramodular text following the first module of each file, or
+// the whole file if it has no module end.
+static void bench_emt(const TSLanguage *language, std::vector<File> const &files, int iterations) {
+  auto const &scanner = language->external_scanner;
+  // TRAILING_EXTRAMODULAR_TEXT is the second external token
+  bool valid_symbols[64] = {};
+  valid_symbols[1] = true;
+  void *payload = scanner.create();
+  Result result;
+  for (auto const &file : files) {
+    auto const &codepoints = file.codepoints;
+    size_t start_position = 0;
+    for (size_t i = 0; i + 4 <= codepoints.size(); i++) {
+      if ((0 == i || '\n' == codepoints[i - 1]) && codepoints[i] == '=' && codepoints[i + 1] == '='
+          && codepoints[i + 2] == '=' && codepoints[i + 3] == '=') {
+        while (i < codepoints.size() && '\n' != codepoints[i]) i++;
+        start_position = i;
+        break;
+      }
+    }
+
+    Lexer lexer = lexer_new(codepoints);
+    auto const start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+      lexer.position = start_position;
+      set_lookahead(&lexer);
+      scanner.scan(payload, &lexer.base, valid_symbols);
+      result.operations += lexer.position - start_position;
+    }
+    result.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+  scanner.destroy(payload);
+  report("emt", result, "codepoint");
+}
+
+// Per-thread cache of freed blocks, handed to the scanner through
+// tree_sitter_tlaplus_scanner_set_allocator as a worker would, so that
+// scanners created and destroyed on a thread reuse its own memory.
+struct ThreadCache {
+  std::vector<std::pair<size_t, void *>> blocks;
+
+  ~ThreadCache() {
+    for (auto const &block : blocks) free(block.second);
+  }
+};
+
+static size_t const cache_header_size = 16;
+
+static void *cache_allocate(void *payload, size_t size) {
+  auto cache = static_cast<ThreadCache *>(payload);
+  for (size_t i = cache->blocks.size(); i-- > 0;) {
+    if (cache->blocks[i].first == size) {
+      char *block = static_cast<char *>(cache->blocks[i].second);
+      cache->blocks.erase(cache->blocks.begin() + i);
+      return block + cache_header_size;
+    }
+  }
+  allocation_count++;
+  char *block = static_cast<char *>(malloc(cache_header_size + size));
+  *reinterpret_cast<size_t *>(block) = size;
+  return block + cache_header_size;
+}
+
+static void cache_deallocate(void *payload, void *pointer) {
+  char *block = static_cast<char *>(pointer) - cache_header_size;
+  static_cast<ThreadCache *>(payload)->blocks.emplace_back(*reinterpret_cast<size_t *>(block), block);
+}
+
+// Runs create mode on 1, 2, 4, ... up to the given number of threads at
+// once, with every scanner allocating from the shared heap and then from
+// a cache owned by its thread, reporting the rate of all threads together.
+static void bench_threads(const TSLanguage *language, std::vector<File> const &files, int iterations, unsigned max_threads) {
+  auto const &scanner = language->external_scanner;
+  auto const states = collect_states(language, files);
+  if (states.empty()) return;
+  for (bool const cached : {false, true}) {
+    for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+      std::vector<Result> results(threads);
+      std::vector<std::thread> workers;
+      auto const start = std::chrono::steady_clock::now();
+      for (unsigned t = 0; t < threads; t++) {
+        workers.emplace_back([&, t]() {
+          ThreadCache cache;
+          if (cached) tree_sitter_tlaplus_scanner_set_allocator(cache_allocate, cache_deallocate, &cache);
+          Result &result = results[t];
+          for (int i = 0; i < iterations; i++) {
+            for (auto const &state : states) {
+              void *payload = scanner.create();
+              scanner.deserialize(payload, state.data(), state.size());
+              scanner.destroy(payload);
+              result.operations++;
+            }
+          }
+          result.allocations = allocation_count;
+          tree_sitter_tlaplus_scanner_set_allocator(NULL, NULL, NULL);
+        });
+      }
+      for (auto &worker : workers) worker.join();
+      double const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+      Result total;
+      for (auto const &result : results) {
+        total.operations += result.operations;
+        total.allocations += result.allocations;
+      }
+      total.seconds = seconds * threads;
+      printf("allocator=%s threads=%u states_per_s=%.0f ", cached ? "thread_cache" : "heap", threads, total.operations / seconds);
+      report("threads", total, "state");
+    }
+  }
+}
+
+// Runs the generated lexer, in every lex mode the parse table uses, and
+// then the keyword lexer at every position of the file; this measures the
+// code tree-sitter generates in src/parser.c rather than the scanner.
+static void bench_lex(const TSLanguage *language, std::vector<File> const &files, int iterations) {
+  std::vector<TSStateId> lex_states;
+  for (unsigned state = 0; state < language->state_count; state++) {
+    TSStateId const lex_state = language->lex_modes[state].lex_state;
+    if (std::find(lex_states.begin(), lex_states.end(), lex_state) == lex_states.end()) lex_states.push_back(lex_state);
+  }
+
+  Result result;
+  for (auto const &file : files) {
+    Lexer lexer = lexer_new(file.codepoints);
+    auto const start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+      for (size_t position : file.positions) {
+        for (TSStateId const lex_state : lex_states) {
+          lexer.position = position;
+          set_lookahead(&lexer);
+          language->lex_fn(&lexer.base, lex_state);
+          result.operations++;
+        }
+        if (language->keyword_lex_fn) {
+          lexer.position = position;
+          set_lookahead(&lexer);
+          language->keyword_lex_fn(&lexer.base, 0);
+          result.operations++;
+        }
+      }
+    }
+    result.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+  report("lex", result, "call");
+}
+
+static File make_file(std::string const &path, std::string const &text) {
+  File file;
+  file.path = path;
+  file.codepoints = decode_utf8(text);
+  file.positions = token_positions(file.codepoints);
+  return file;
+}
+
+// Runs scan mode, without extramodular text, over generated specs with lines
+// of 10k+ codepoints where the cost of finding lexeme columns can dominate.
+static void bench_lines(const TSLanguage *language, int iterations) {
+  std::string record, join;
+  for (int i = 0; i < 1000; i++) {
+    record += (i > 0 ? ", f" : "f") + std::to_string(i) + " |-> " + std::to_string(i);
+    join += (i > 0 ? " /\\ x" : "x") + std::to_string(i) + " = " + std::to_string(i);
+  }
+
+  std::vector<File> const files = {
+    make_file("record", "---- MODULE Record ----\nOp == [" + record + "]\n===="),
+    make_file("join", "---- MODULE Join ----\nOp == " + join + "\n===="),
+    make_file("jlist", "---- MODULE Jlist ----\nOp ==\n  /\\ r = [" + record + "]\n  /\\ " + join + "\n===="),
+  };
+
+  for (auto const &file : files) {
+    Result result;
+    for (int i = 0; i < iterations; i++) scan_file(language, file, result, nullptr, false);
+    report(("lines_" + file.path).c_str(), result, "call");
+  }
+}
+
+// Scans identifier-heavy lines inside a jlist, so every lexeme goes through
+// the keyword lexer, and checks each word is lexed as the right token.
+static bool bench_keywords(const TSLanguage *language, int iterations) {
+  // External token indices, from the externals list in grammar.js
+  int const INDENT = 2, BULLET = 3, DEDENT = 4, QED = 11, WF = 12, SF = 13;
+  struct Word {
+    char const *text;
+    int symbol; // Token emitted, or -1 if none
+  };
+
+  // Keywords ending the jlist emit DEDENT; near misses emit nothing
+  std::vector<Word> const words = {
+    {"ASSUME", DEDENT}, {"ASSUMPTION", DEDENT}, {"AXIOM", DEDENT}, {"BY", DEDENT},
+    {"CONSTANT", DEDENT}, {"CONSTANTS", DEDENT}, {"COROLLARY", DEDENT}, {"ELSE", DEDENT},
+    {"IN", DEDENT}, {"LEMMA", DEDENT}, {"LOCAL", DEDENT}, {"OBVIOUS", DEDENT},
+    {"OMITTED", DEDENT}, {"PROOF", DEDENT}, {"PROPOSITION", DEDENT}, {"QED", QED},
+    {"THEN", DEDENT}, {"THEOREM", DEDENT}, {"VARIABLE", DEDENT}, {"VARIABLES", DEDENT},
+    {"WF_vars", WF}, {"SF_vars", SF}, {"WF_", WF}, {"SF_", SF},
+    {"ASSUMES", -1}, {"ASSUM", -1}, {"AXIOMS", -1}, {"BYE", -1}, {"CONSTANTSX", -1},
+    {"CONSTAN", -1}, {"In", -1}, {"INIT", -1}, {"Init", -1}, {"Next", -1},
+    {"TypeOK", -1}, {"THENCE", -1}, {"QEDX", -1}, {"VARIABLESS", -1}, {"PROPOSITIONS", -1},
+    {"WF", -1}, {"W_", -1}, {"Spec", -1}, {"LEMMA2", -1}, {"BY_x", -1},
+    {"x", -1}, {"counter", -1}, {"ABCDEFGHIJKLMNOP", -1},
+  };
+
+  // Each word is on its own line, indented past the jlist at column 0
+  std::string text = "/\\ x";
+  std::vector<size_t> positions;
+  for (int i = 0; i < 100; i++) {
+    for (auto const &word : words) {
+      positions.push_back(decode_utf8(text).size());
+      text += std::string("\n  ") + word.text;
+    }
+  }
+  auto const codepoints = decode_utf8(text);
+
+  auto const &scanner = language->external_scanner;
+  void *payload = scanner.create();
+  Lexer lexer = lexer_new(codepoints);
+  bool valid_symbols[64] = {};
+  valid_symbols[INDENT] = true;
+  set_lookahead(&lexer);
+  scanner.scan(payload, &lexer.base, valid_symbols);
+  char buffer[TREE_SITTER_SERIALIZATION_BUFFER_SIZE];
+  std::string const jlist_state(buffer, scanner.serialize(payload, buffer));
+
+  valid_symbols[INDENT] = false;
+  valid_symbols[BULLET] = true;
+  valid_symbols[DEDENT] = true;
+  bool ok = true;
+  Result result;
+  for (int iteration = 0; iteration < iterations; iteration++) {
+    auto const start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < positions.size(); i++) {
+      lexer.position = positions[i];
+      set_lookahead(&lexer);
+      lexer.end = lexer.position;
+      bool const emitted = scanner.scan(payload, &lexer.base, valid_symbols);
+      if (0 == iteration) {
+        auto const &word = words[i % words.size()];
+        int const symbol = emitted ? static_cast<int>(lexer.base.result_symbol) : -1;
+        // Zero-width DEDENTs end at the start of the word, after "\n  "
+        size_t const length = symbol == QED || symbol == WF || symbol == SF ? 3 : 0;
+        if (symbol != word.symbol || (emitted && lexer.end != positions[i] + 3 + length)) {
+          fprintf(stderr, "keywords: %s lexed as %d, expected %d\n", word.text, symbol, word.symbol);
+          ok = false;
+        }
+      }
+      if (emitted) scanner.deserialize(payload, jlist_state.data(), jlist_state.size());
+      result.operations++;
+    }
+    result.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+  scanner.destroy(payload);
+  report("keywords", result, "call");
+  return ok;
+}
+
+// Parses a thread count given with -j, which must be a whole number of at
+// least 1.
+static bool parse_thread_count(char const *arg, unsigned &threads) {
+  char *end = NULL;
+  errno = 0;
+  long const value = strtol(arg, &end, 10);
+  if (end == arg || '\0' != *end || 0 != errno || value < 1 || value > static_cast<long>(UINT_MAX)) return false;
+  threads = static_cast<unsigned>(value);
+  return true;
+}
+
+int main(int const argc, char const *const argv[]) {
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s <scan|state|create|threads|pcal|replay|emt|lines|keywords|lex|all> [-n iterations] [-j max threads] [file...]\n", argv[0]);
+    return 2;
+  }
+
+  std::string const mode = argv[1];
+  int iterations = 10;
+  unsigned max_threads = 64;
+  int first_file = 2;
+  while (argc > first_file + 1 && (std::string(argv[first_file]) == "-n" || std::string(argv[first_file]) == "-j")) {
+    if (std::string(argv[first_file]) == "-n") {
+      iterations = atoi(argv[first_file + 1]);
+    } else {
+      if (!parse_thread_count(argv[first_file + 1], max_threads)) {
+        fprintf(stderr, "Invalid thread count: %s\n", argv[first_file + 1]);
+        return 2;
+      }
+    }
+    first_file += 2;
+  }
+
+  std::vector<File> files;
+  for (int i = first_file; i < argc; i++) {
+    auto file = std::ifstream(argv[i], std::ios::binary);
+    std::string const text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    files.push_back(make_file(argv[i], text));
+  }
+
+  const TSLanguage *language = TS_LANG();
+  if (mode == "scan" || mode == "all") bench_scan(language, files, iterations);
+  if (mode == "state" || mode == "all") bench_state(language, files, iterations);
+  if (mode == "create" || mode == "all") bench_create(language, files, iterations);
+  if (mode == "threads") bench_threads(language, files, iterations, max_threads);
+  if (mode == "pcal" || mode == "all") bench_pcal(language, files, iterations * 100);
+  if (mode == "replay" || mode == "all") bench_replay(language, files, iterations);
+  if (mode == "emt" || mode == "all") bench_emt(language, files, iterations);
+  if (mode == "lines" || mode == "all") bench_lines(language, iterations);
+  if (mode == "lex") bench_lex(language, files, iterations);
+  bool const keywords_ok = (mode != "keywords" && mode != "all") || bench_keywords(language, iterations * 100);
+  return keywords_ok ? 0 : 1;
+}
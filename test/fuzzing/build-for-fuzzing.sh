@@ -63,6 +63,18 @@ $CXX $CXXFLAGS -std=c++11 \
   $fuzz_dir/fuzzer.cc $parser_out $scanner_out $ts_dir/libtree-sitter.a \
   -o $out_dir/${ts_lang}_fuzzer
 
+# Performance mode budgets parses on the scanner's call counter, so its
+# scanner is built with statistics; set TS_FUZZ_FLAGS to e.g.
+# "-D TS_FUZZ_MIN_SCANS=1000" to change the compiled in fallbacks
+echo "Building ${ts_lang} performance fuzzer..."
+stats_scanner_out="${out_dir}/${scanner}_stats.o"
+$CC $CFLAGS -g -O0 -I $src_dir -D TLAPLUS_SCANNER_STATS -c $scanner_in -o $stats_scanner_out
+$CXX $CXXFLAGS -std=c++11 \
+  -I $ts_dir/lib/include -I bindings/c \
+  -D TS_LANG=$ts_lang -D TS_FUZZ_PERFORMANCE $TS_FUZZ_FLAGS \
+  $fuzz_dir/fuzzer.cc $parser_out $stats_scanner_out $ts_dir/libtree-sitter.a \
+  -o $out_dir/${ts_lang}_performance_fuzzer
+
 echo "Generating token dictionary"
 python "${fuzz_dir}/gen-dict.py" "${src_dir}/grammar.json" > "${out_dir}/${ts_lang}.dict"
 
@@ -2,6 +2,9 @@
 // MIT License Copyright (c) 2018-2021 Max Brunsfeld
 
 #include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
 #include <fstream>
 #include "tree_sitter/api.h"
 
@@ -13,7 +16,62 @@ static TSQuery *lang_query;
 #define TS_LANG_QUERY_FILENAME ""
 #endif
 
+// Performance mode: inputs whose parse exceeds a budget proportional to
+// their size abort, so libFuzzer saves them as artifacts. The budget is on
+// external scanner calls, read from the scanner's statistics counters so
+// counting costs an increment per call; they are deterministic, so budgets
+// hold under sanitizers, and a wall clock budget can be set as well. The
+// compiled in budgets are only fallbacks: run-performance-fuzzer.sh sets
+// TS_FUZZ_SCANS_PER_BYTE from the most scanner calls per byte any of the
+// example specs take, found by running with TS_FUZZ_CALIBRATE set, which
+// prints each input's counts and never aborts.
+#ifdef TS_FUZZ_PERFORMANCE
+
+#include <cstring>
+#include "tree-sitter-tlaplus.h"
+
+#ifndef TS_FUZZ_SCANS_PER_BYTE
+#define TS_FUZZ_SCANS_PER_BYTE 64
+#endif
+
+#ifndef TS_FUZZ_MIN_SCANS
+#define TS_FUZZ_MIN_SCANS 10000
+#endif
+
+// Zero disables the wall clock budget
+#ifndef TS_FUZZ_MICROS_PER_BYTE
+#define TS_FUZZ_MICROS_PER_BYTE 0
+#endif
+
+#ifndef TS_FUZZ_MIN_MICROS
+#define TS_FUZZ_MIN_MICROS 100000
+#endif
+
+static size_t scan_calls_stat;
+static bool calibrating;
+static size_t scans_per_byte = TS_FUZZ_SCANS_PER_BYTE;
+static size_t micros_per_byte = TS_FUZZ_MICROS_PER_BYTE;
+
+static size_t budget_from_env(const char *name, size_t fallback) {
+  const char *value = getenv(name);
+  return value && value[0] ? strtoul(value, NULL, 10) : fallback;
+}
+
+#endif
+
 extern "C" int LLVMFuzzerInitialize(int *argc, char ***argv) {
+#ifdef TS_FUZZ_PERFORMANCE
+  scan_calls_stat = tree_sitter_tlaplus_scanner_stat_count();
+  for (size_t i = 0; i < tree_sitter_tlaplus_scanner_stat_count(); i++) {
+    if (0 == strcmp("scan_calls", tree_sitter_tlaplus_scanner_stat_name(i))) scan_calls_stat = i;
+  }
+  // The scanner must be built with TLAPLUS_SCANNER_STATS defined
+  assert(scan_calls_stat < tree_sitter_tlaplus_scanner_stat_count());
+  calibrating = NULL != getenv("TS_FUZZ_CALIBRATE");
+  scans_per_byte = budget_from_env("TS_FUZZ_SCANS_PER_BYTE", scans_per_byte);
+  micros_per_byte = budget_from_env("TS_FUZZ_MICROS_PER_BYTE", micros_per_byte);
+#endif
+
   if(TS_LANG_QUERY_FILENAME[0]) {
     // The query filename is relative to the fuzzing binary. Convert it
     // to an absolute path first
@@ -51,7 +109,33 @@ extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
   bool language_ok = ts_parser_set_language(parser, TS_LANG());
   assert(language_ok);
 
+#ifdef TS_FUZZ_PERFORMANCE
+  tree_sitter_tlaplus_scanner_stats_reset();
+  auto const start = std::chrono::steady_clock::now();
+#endif
+
   TSTree *tree = ts_parser_parse_string(parser, NULL, str, size);
+
+#ifdef TS_FUZZ_PERFORMANCE
+  auto const micros = std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now() - start).count();
+  uint64_t const scans = tree_sitter_tlaplus_scanner_stat_value(scan_calls_stat);
+  size_t const scan_budget = TS_FUZZ_MIN_SCANS + scans_per_byte * size;
+  size_t const micros_budget = TS_FUZZ_MIN_MICROS + micros_per_byte * size;
+  if (calibrating) {
+    printf("bytes=%zu scan_calls=%llu micros=%lld\n",
+      size, static_cast<unsigned long long>(scans), static_cast<long long>(micros));
+  } else if (scans > scan_budget) {
+    fprintf(stderr, "Parse of %zu bytes took %llu scanner calls, over the budget of %zu\n",
+      size, static_cast<unsigned long long>(scans), scan_budget);
+    abort();
+  } else if (micros_per_byte > 0 && static_cast<size_t>(micros) > micros_budget) {
+    fprintf(stderr, "Parse of %zu bytes took %lld us, over the budget of %zu\n",
+      size, static_cast<long long>(micros), micros_budget);
+    abort();
+  }
+#endif
+
   TSNode root_node = ts_tree_root_node(tree);
 
   if (lang_query) {
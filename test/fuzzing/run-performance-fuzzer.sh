@@ -0,0 +1,34 @@
+#! /bin/sh
+# Fuzzes for inputs that parse in time superlinear in their size, saving
+# them to test/performance_regressions; replay them with
+# `test/benchmark/run-bench.sh scaling`. Extra arguments go to libFuzzer.
+#
+# The budget is calibrated first: each spec of the tlaplus/examples corpus
+# in test/examples/external is parsed once, and inputs may then take up to
+# TS_FUZZ_HEADROOM (default 4) times the most scanner calls per byte of
+# any of them. A handful of specs gives no meaningful budget, so this
+# fails if the corpus is missing; set TS_FUZZ_SCANS_PER_BYTE to skip
+# calibrating instead. Saved
+# regressions seed the fuzzer, which keeps its own corpus in
+# test/fuzzing/out/performance_corpus.
+fuzzer=./test/fuzzing/out/tree_sitter_tlaplus_performance_fuzzer
+if [ -z "$TS_FUZZ_SCANS_PER_BYTE" ]; then
+  if [ -z "$(find test/examples/external -name '*.tla' 2>/dev/null | head -n 1)" ]; then
+    echo "Calibrating needs the tlaplus/examples corpus; run \`git submodule update --init test/examples/external\` or set TS_FUZZ_SCANS_PER_BYTE" >&2
+    exit 1
+  fi
+  TS_FUZZ_SCANS_PER_BYTE=$(
+    find test/examples/external -name '*.tla' |
+      TS_FUZZ_CALIBRATE=1 xargs "$fuzzer" 2>/dev/null |
+      awk -F '[= ]' -v headroom="${TS_FUZZ_HEADROOM:-4}" '
+        /^bytes=/ && $2 > 0 { ratio = $4 / $2; if (ratio > max) max = ratio }
+        END { printf "%d\n", max * headroom + 1 }')
+  echo "Calibrated budget: TS_FUZZ_SCANS_PER_BYTE=$TS_FUZZ_SCANS_PER_BYTE"
+fi
+export TS_FUZZ_SCANS_PER_BYTE
+mkdir -p test/performance_regressions test/fuzzing/out/performance_corpus
+"$fuzzer" \
+  -dict=test/fuzzing/out/tree_sitter_tlaplus.dict \
+  -artifact_prefix=test/performance_regressions/ \
+  -max_len=4096 -timeout=10 \
+  "$@" test/fuzzing/out/performance_corpus test/performance_regressions
@@ -0,0 +1,28 @@
+---- MODULE NestedProofs ----
+THEOREM TRUE
+<1>1. TRUE
+  <2>1. TRUE
+    <3>1. TRUE
+      <4>1. TRUE
+        <5>1. TRUE
+          <6>1. TRUE
+            <7>1. TRUE
+              <8>1. TRUE
+                <9>1. TRUE
+                  <10>1. TRUE
+                    <11>1. TRUE
+                      <12>1. TRUE
+                        OBVIOUS
+                      <12> QED
+                    <11> QED
+                  <10> QED
+                <9> QED
+              <8> QED
+            <7> QED
+          <6> QED
+        <5> QED
+      <4> QED
+    <3> QED
+  <2> QED
+<1> QED
+====
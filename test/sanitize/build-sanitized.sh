@@ -49,6 +49,7 @@ $CC $CFLAGS -g -O0 -I $src_dir -c $scanner_in -o $scanner_out
 echo "Building runner..."
 $CXX $CXXFLAGS \
   -I $ts_dir/lib/include \
+  -I bindings/c \
   -D TS_LANG=$ts_lang \
   $sanitize_dir/runner.cc $parser_out $scanner_out $ts_dir/libtree-sitter.a \
   -o $out_dir/parse_${lang_name}
@@ -1,26 +1,30 @@
 #include <cassert>
-#include <fstream>
+#include <cstdio>
 #include <stdlib.h>
-#include "tree_sitter/api.h"
+#include <string>
+#define TREE_SITTER_TLAPLUS_MMAP_INPUT
+#include "tree-sitter-tlaplus.h"
 
 extern "C" const TSLanguage *TS_LANG();
 
 int main(int const argc, char const* const argv[]) {
   bool quiet = argc == 3;
 
+  // The spec is parsed straight from the mapped file rather than copied
   auto const file_path = std::string(argv[1]);
-  auto file = std::ifstream(file_path);
-  std::string const text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  TSTlaplusMappedFile file;
+  bool file_ok = tree_sitter_tlaplus_mapped_file_open(&file, file_path.c_str());
+  assert(file_ok);
 
   if (!quiet) {
-    printf("%s", text.c_str());
+    fwrite(file.data, 1, file.length, stdout);
   }
 
   TSParser *parser = ts_parser_new();
   bool language_ok = ts_parser_set_language(parser, TS_LANG());
   assert(language_ok);
 
-  TSTree *tree = ts_parser_parse_string(parser, NULL, text.c_str(), text.size());
+  TSTree *tree = ts_parser_parse(parser, NULL, tree_sitter_tlaplus_mapped_file_input(&file));
   TSNode root_node = ts_tree_root_node(tree);
 
   if (!quiet) {
@@ -31,7 +35,7 @@ int main(int const argc, char const* const argv[]) {
 
   ts_tree_delete(tree);
   ts_parser_delete(parser);
+  tree_sitter_tlaplus_mapped_file_close(&file);
 
   return 0;
 }
-